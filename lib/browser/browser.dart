@@ -7,9 +7,11 @@ import '../components/window_shell.dart';
 import '../model/favorites.dart';
 import '../model/history.dart';
 import '../model/menu_actions.dart';
+import '../model/preferences.dart';
 import '../model/selection.dart';
 import '../utils/database.dart';
 import '../utils/paths.dart';
+import '../utils/thumbnail_prefetcher.dart';
 import 'content.dart';
 import 'sidebar.dart';
 
@@ -34,7 +36,10 @@ class BrowserState extends State<Browser> {
   final FocusNode _galleryFocusNode = FocusNode(debugLabel: 'browser gallery');
   final ScrollController _sidebarScrollController = ScrollController();
   final Map<String, List<String>> _selectionsByPath = {};
+  final ThumbnailPrefetcher _prefetcher = ThumbnailPrefetcher();
   late HistoryModel _history;
+  late Preferences _preferences;
+  String? _prefetchFolder;
   List<String>? _initialSelection;
   bool _showSidebar = true;
 
@@ -42,12 +47,16 @@ class BrowserState extends State<Browser> {
   void initState() {
     _history = HistoryModel.of(context);
     _history.addListener(_onHistoryChange);
+    _preferences = Preferences.of(context);
+    _preferences.addListener(_updatePrefetch);
     super.initState();
   }
 
   @override
   void dispose() {
     _history.removeListener(_onHistoryChange);
+    _preferences.removeListener(_updatePrefetch);
+    _prefetcher.dispose();
     _galleryFocusNode.dispose();
     _sidebarScrollController.dispose();
     super.dispose();
@@ -57,6 +66,7 @@ class BrowserState extends State<Browser> {
   Widget build(BuildContext context) {
     // we need a path
     _initLocation(context);
+    _updatePrefetch();
 
     return FotoWindowShell(
       showSidebar: _showSidebar,
@@ -113,6 +123,25 @@ class BrowserState extends State<Browser> {
     if (mounted) setState(() {});
   }
 
+  void _updatePrefetch() {
+    if (!_preferences.prefetchThumbnails) {
+      if (_prefetchFolder != null) {
+        _prefetchFolder = null;
+        _prefetcher.cancel();
+      }
+      return;
+    }
+
+    final folder = _history.top;
+    if (folder == _prefetchFolder) return;
+    _prefetchFolder = folder;
+    _prefetcher.folderShown(
+      folder,
+      recent: _history.get.reversed.toList(growable: false),
+      favorites: FavoritesModel.of(context).get.toList(growable: false),
+    );
+  }
+
   void _rememberCurrentSelection() {
     _selectionsByPath[_history.top] =
         SelectionModel.of(context).get.toList(growable: false);
@@ -73,6 +73,7 @@ class ImageGalleryState extends State<ImageGallery> with MenuHandler {
 
   final ScrollController _galleryScrollController = ScrollController();
   JustifiedGalleryLayout? _galleryLayout;
+  final ThumbnailView _thumbnailView = ThumbnailView();
   Timer? _aspectRelayoutDebounce;
   final GlobalKey _gallerySurfaceKey = GlobalKey();
   final GalleryLoupeController _loupeController = GalleryLoupeController();
@@ -192,6 +193,10 @@ class ImageGalleryState extends State<ImageGallery> with MenuHandler {
     _preferences.removeListener(_onPrefsChange);
     _galleryScrollController.dispose();
     _loupeController.dispose();
+    PlatformUtils.cancelThumbnailRequests(_thumbnailView).onError(
+      (error, stackTrace) =>
+          debugPrint('Unable to cancel thumbnail requests: $error'),
+    );
     _similaritySession?.cancel();
     super.dispose();
   }
@@ -395,8 +400,10 @@ class ImageGalleryState extends State<ImageGallery> with MenuHandler {
                       controller: _galleryScrollController,
                       layout: layout,
                       spacing: spacing,
-                      itemBuilder: (context, itemIndex) =>
-                          _buildGalleryItem(items[itemIndex]),
+                      itemBuilder: (context, itemIndex) => _buildGalleryItem(
+                        items[itemIndex],
+                        _thumbnailPriority(itemIndex, constraints.maxHeight),
+                      ),
                     );
                   },
                 );
@@ -420,7 +427,21 @@ class ImageGalleryState extends State<ImageGallery> with MenuHandler {
     );
   }
 
-  Widget _buildGalleryItem(MediaItem media) {
+  /// Rows on screen are requested first, rows the list builds ahead of
+  /// them next.
+  ThumbnailPriority _thumbnailPriority(int index, double viewportHeight) {
+    final row = _galleryLayout?.rowForItem(index);
+    if (row == null) return ThumbnailPriority.visible;
+    final scrollOffset = _galleryScrollController.hasClients
+        ? _galleryScrollController.offset
+        : 0.0;
+    final top = 16 + row.offset;
+    final onScreen = top < scrollOffset + viewportHeight &&
+        top + row.height > scrollOffset;
+    return onScreen ? ThumbnailPriority.visible : ThumbnailPriority.nearVisible;
+  }
+
+  Widget _buildGalleryItem(MediaItem media, ThumbnailPriority priority) {
     return Selector<SelectionModel, bool>(
       selector: (_, selectionModel) => selectionModel.contains(media.path),
       builder: (context, selected, child) {
@@ -469,6 +490,8 @@ class ImageGalleryState extends State<ImageGallery> with MenuHandler {
                           onRenamed: _onFileRenamed,
                           onAspectRatioChanged: (_) =>
                               _scheduleAspectRelayout(),
+                          thumbnailView: _thumbnailView,
+                          thumbnailPriority: priority,
                         ),
                       ),
                     ),
@@ -948,14 +971,15 @@ class ImageGalleryState extends State<ImageGallery> with MenuHandler {
     var changed = false;
     _stopWatchDir();
     try {
-      for (var filepath in paths) {
-        bool rc = await ImageUtils.transformImage(filepath, transformation);
+      final results = await ImageUtils.transformImages(paths, transformation);
+      for (var index = 0; index < paths.length; index += 1) {
+        final rc = results[index];
         if (rc) {
           changed = true;
         }
         if (rc && _items != null) {
           for (var item in _items!) {
-            if (item.path == filepath) {
+            if (item.path == paths[index]) {
               await item.refresh();
               break;
             }
@@ -82,8 +82,17 @@ class JustifiedGalleryLayout {
   }
 
   JustifiedGalleryRow? rowForItem(int index) {
-    for (final row in rows) {
-      if (row.items.first.index <= index && row.items.last.index >= index) {
+    // Rows hold consecutive items: search by first index.
+    var low = 0;
+    var high = rows.length - 1;
+    while (low <= high) {
+      final middle = (low + high) >> 1;
+      final row = rows[middle];
+      if (index < row.items.first.index) {
+        high = middle - 1;
+      } else if (index > row.items.last.index) {
+        low = middle + 1;
+      } else {
         return row;
       }
     }
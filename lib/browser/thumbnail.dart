@@ -5,6 +5,8 @@ import 'package:flutter/services.dart';
 import '../components/theme.dart';
 import '../model/media.dart';
 import '../utils/platform_keyboard.dart';
+import '../utils/platform_utils.dart';
+import '../utils/thumb_hash.dart';
 import '../utils/utils.dart';
 
 class Thumbnail extends StatefulWidget {
@@ -15,6 +17,8 @@ class Thumbnail extends StatefulWidget {
     required this.rename,
     required this.onRenamed,
     this.onAspectRatioChanged,
+    this.thumbnailView = ThumbnailView.shared,
+    this.thumbnailPriority = ThumbnailPriority.visible,
   });
 
   final MediaItem media;
@@ -23,6 +27,10 @@ class Thumbnail extends StatefulWidget {
   final Function onRenamed;
   final ValueChanged<double>? onAspectRatioChanged;
 
+  /// How the native thumbnail request is scheduled.
+  final ThumbnailView thumbnailView;
+  final ThumbnailPriority thumbnailPriority;
+
   @override
   State<Thumbnail> createState() => _ThumbnailState();
 }
@@ -33,6 +41,7 @@ class _ThumbnailState extends State<Thumbnail> {
   ImageStream? _imageStream;
   ImageStreamListener? _imageStreamListener;
   ImageProvider? _resolvedProvider;
+  bool _previewLoaded = false;
 
   @override
   void initState() {
@@ -81,6 +90,11 @@ class _ThumbnailState extends State<Thumbnail> {
 
   @override
   void dispose() {
+    // A request still pending may be cancelled with the view: its error
+    // must not stay in the image cache.
+    if (_resolvedProvider case final provider? when !_previewLoaded) {
+      provider.evict();
+    }
     _removeImageListener();
     _focusNode.dispose();
     _editController.dispose();
@@ -182,11 +196,24 @@ class _ThumbnailState extends State<Thumbnail> {
         ),
       );
     }
+    // The stored placeholder paints until the first frame, without decode.
+    final placeholder = widget.media.placeholder;
     return Image(
-      image: thumbnail.image,
+      image: _scheduledImage() ?? thumbnail.image,
       fit: BoxFit.cover,
       filterQuality: FilterQuality.medium,
       gaplessPlayback: true,
+      frameBuilder: placeholder == null
+          ? null
+          : (context, child, frame, wasSynchronouslyLoaded) {
+              if (frame != null || wasSynchronouslyLoaded) return child;
+              return Image(
+                image: ThumbHashImageProvider(placeholder),
+                fit: BoxFit.cover,
+                filterQuality: FilterQuality.medium,
+                excludeFromSemantics: true,
+              );
+            },
       errorBuilder: (context, error, stackTrace) => ColoredBox(
         color: palette.chromeSurface,
         child: Icon(
@@ -250,8 +277,11 @@ class _ThumbnailState extends State<Thumbnail> {
     if (provider == null || identical(provider, _resolvedProvider)) return;
     _removeImageListener();
     _resolvedProvider = provider;
-    final stream = provider.resolve(createLocalImageConfiguration(context));
+    _previewLoaded = false;
+    final stream = (_scheduledImage() ?? provider)
+        .resolve(createLocalImageConfiguration(context));
     final listener = ImageStreamListener((imageInfo, synchronousCall) {
+      _previewLoaded = true;
       final width = imageInfo.image.width;
       final height = imageInfo.image.height;
       if (width <= 0 || height <= 0) return;
@@ -266,6 +296,11 @@ class _ThumbnailState extends State<Thumbnail> {
     stream.addListener(listener);
   }
 
+  ImageProvider? _scheduledImage() => widget.media.thumbnailImage(
+        view: widget.thumbnailView,
+        priority: widget.thumbnailPriority,
+      );
+
   void _removeImageListener() {
     final stream = _imageStream;
     final listener = _imageStreamListener;
@@ -298,16 +298,7 @@ class _BrowserTreeState extends State<BrowserTree> {
     }
 
     try {
-      final entities = await Directory(path)
-          .list(recursive: false, followLinks: false)
-          .toList();
-      final folders = entities
-          .whereType<Directory>()
-          .where((folder) => !MediaUtils.shouldExcludeFileOrDir(folder.path))
-          .toList();
-      folders.sort(
-        (a, b) => a.path.toLowerCase().compareTo(b.path.toLowerCase()),
-      );
+      final folders = await MediaUtils.listFolders(path);
       if (!mounted) return;
       _folderCache[path] = folders;
       if (_isEffectivelyExpanded(path)) {
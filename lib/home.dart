@@ -111,6 +111,12 @@ class _HomeState extends State<Home> with WindowListener {
             label: t.menuClearThumbnailCache,
             onSelected: _clearThumbnailCache,
           ),
+          PlatformMenuItem(
+            label: Preferences.of(context).prefetchThumbnails
+                ? '✓ ${t.menuPrefetchThumbnails}'
+                : t.menuPrefetchThumbnails,
+            onSelected: _togglePrefetchThumbnails,
+          ),
           const PlatformProvidedMenuItem(
             type: PlatformProvidedMenuItemType.quit,
           ),
@@ -283,6 +289,13 @@ class _HomeState extends State<Home> with WindowListener {
     }
   }
 
+  void _togglePrefetchThumbnails() {
+    final preferences = Preferences.of(context);
+    setState(() {
+      preferences.prefetchThumbnails = !preferences.prefetchThumbnails;
+    });
+  }
+
   Future<void> viewImage(String image) async {
     final int requestGeneration = ++_openRequestGeneration;
     try {
@@ -146,6 +146,12 @@ abstract class AppLocalizations {
   /// **'Clear Thumbnail Cache'**
   String get menuClearThumbnailCache;
 
+  /// No description provided for @menuPrefetchThumbnails.
+  ///
+  /// In en, this message translates to:
+  /// **'Prefetch Nearby Folders'**
+  String get menuPrefetchThumbnails;
+
   /// No description provided for @menuEdit.
   ///
   /// In en, this message translates to:
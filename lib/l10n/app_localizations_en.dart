@@ -32,6 +32,9 @@ class AppLocalizationsEn extends AppLocalizations {
   @override
   String get menuClearThumbnailCache => 'Clear Thumbnail Cache';
 
+  @override
+  String get menuPrefetchThumbnails => 'Prefetch Nearby Folders';
+
   @override
   String get menuEdit => 'Edit';
 
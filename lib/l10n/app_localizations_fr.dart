@@ -32,6 +32,9 @@ class AppLocalizationsFr extends AppLocalizations {
   @override
   String get menuClearThumbnailCache => 'Vider le cache des miniatures';
 
+  @override
+  String get menuPrefetchThumbnails => 'Précharger les dossiers voisins';
+
   @override
   String get menuEdit => 'Edition';
 
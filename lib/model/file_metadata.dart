@@ -1,4 +1,7 @@
 import 'dart:io';
+import 'dart:typed_data';
+
+import '../utils/utils.dart';
 
 class FileMetadata {
   final String path;
@@ -7,12 +10,22 @@ class FileMetadata {
   final DateTime modificationDate;
   final int? size;
 
+  /// Placeholder hash stored with the cached thumbnail (see `thumb_hash.h`).
+  final Uint8List? placeholder;
+
+  /// Read from the file header by local scans only.
+  final DateTime? captureDate;
+  final SizeInt? imageSize;
+
   const FileMetadata({
     required this.path,
     required this.entityType,
     required this.creationDate,
     required this.modificationDate,
     this.size,
+    this.placeholder,
+    this.captureDate,
+    this.imageSize,
   });
 
   factory FileMetadata.fromPlatformMap(Map<Object?, Object?> map) {
@@ -21,11 +34,19 @@ class FileMetadata {
     final creationDate = map['creationDate'];
     final modificationDate = map['modificationDate'];
     final size = map['size'];
+    final placeholder = map['placeholder'];
+    final captureDate = map['captureDate'];
+    final width = map['width'];
+    final height = map['height'];
     if (path is! String ||
         (type != 'file' && type != 'directory') ||
         creationDate is! num ||
         modificationDate is! num ||
-        (size != null && size is! num)) {
+        (size != null && size is! num) ||
+        (placeholder != null && placeholder is! Uint8List) ||
+        (captureDate != null && captureDate is! num) ||
+        (width != null && width is! int) ||
+        (height != null && height is! int)) {
       throw const FormatException('Invalid directory scan entry.');
     }
     return FileMetadata(
@@ -36,6 +57,13 @@ class FileMetadata {
       creationDate: _dateFromEpochSeconds(creationDate),
       modificationDate: _dateFromEpochSeconds(modificationDate),
       size: type == 'file' ? (size as num?)?.toInt() : null,
+      placeholder: type == 'file' ? placeholder as Uint8List? : null,
+      captureDate: type == 'file' && captureDate is num
+          ? _dateFromEpochSeconds(captureDate)
+          : null,
+      imageSize: type == 'file' && width is int && height is int
+          ? SizeInt(width, height)
+          : null,
     );
   }
 
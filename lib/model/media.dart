@@ -1,5 +1,6 @@
 import 'dart:io';
 import 'dart:isolate';
+import 'dart:typed_data';
 
 import 'package:flutter/material.dart';
 
@@ -7,10 +8,16 @@ import '../utils/file_utils.dart';
 import '../utils/cached_thumbnail_image_provider.dart';
 import '../utils/image_utils.dart';
 import '../utils/paths.dart';
+import '../utils/platform_utils.dart';
 import '../utils/utils.dart';
 import 'file_metadata.dart';
 
 class MediaItem {
+  /// Sizes requested for gallery thumbnails: raw pixels bypass the resize,
+  /// so 720 covers a 3:2 photo in a 480 px row.
+  static const int thumbnailPixelSize = 960;
+  static const int thumbnailDisplaySize = 720;
+
   final String path;
   final FileSystemEntityType entityType;
   bool mediaInfoParsed;
@@ -20,6 +27,7 @@ class MediaItem {
   SizeInt? imageSize;
   double? previewAspectRatio;
   int? fileSize;
+  Uint8List? placeholder;
   Image? thumbnail;
   final ValueNotifier<int> updateCounter = ValueNotifier<int>(0);
   int _metadataGeneration = 0;
@@ -65,11 +73,13 @@ class MediaItem {
     return MediaItem(
       path: metadata.path,
       entityType: metadata.entityType,
-      creationDate: metadata.creationDate,
+      creationDate: metadata.captureDate ?? metadata.creationDate,
       modificationDate: metadata.modificationDate,
-      mediaInfoParsed: !isFile,
-      captureDateParsed: !isFile,
+      mediaInfoParsed: !isFile || metadata.imageSize != null,
+      captureDateParsed: !isFile || metadata.captureDate != null,
       fileSize: isFile ? metadata.size : null,
+      placeholder: metadata.placeholder,
+      imageSize: metadata.imageSize,
       thumbnail: isFile
           ? _fileThumbnail(
               metadata.path,
@@ -88,6 +98,7 @@ class MediaItem {
     required this.creationDate,
     this.captureDateParsed = false,
     this.fileSize,
+    this.placeholder,
     this.imageSize,
     this.thumbnail,
   });
@@ -153,6 +164,28 @@ class MediaItem {
     }
   }
 
+  /// [thumbnail]'s image with its native request scheduled for [view] at
+  /// [priority]. It shares the decoded image of [thumbnail].
+  ImageProvider? thumbnailImage({
+    required ThumbnailView view,
+    required ThumbnailPriority priority,
+  }) {
+    final image = thumbnail?.image;
+    if (image is ResizeImage) {
+      final provider = image.imageProvider;
+      if (provider is CachedThumbnailImageProvider) {
+        return ResizeImage(
+          provider.scheduled(priority: priority, view: view),
+          width: image.width,
+          height: image.height,
+          policy: image.policy,
+          allowUpscaling: image.allowUpscaling,
+        );
+      }
+    }
+    return image;
+  }
+
   Future<void> refresh() async {
     final file = File(path);
     final stats = await file.stat();
@@ -212,6 +245,7 @@ class MediaItem {
     captureDateParsed = false;
     mediaInfoParsed = false;
     fileSize = null;
+    placeholder = null;
     imageSize = null;
   }
 
@@ -228,6 +262,8 @@ class MediaItem {
           path: path,
           modificationDate: modificationDate,
           fileSize: fileSize,
+          pixelSize: thumbnailPixelSize,
+          displaySize: thumbnailDisplaySize,
         ),
       ),
     );
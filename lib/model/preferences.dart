@@ -39,6 +39,10 @@ class Preferences extends ChangeNotifier {
     return false;
   }
 
+  static bool get defaultPrefetchThumbnails {
+    return false;
+  }
+
   static int get defaultSlideshowDurationMs {
     return 3000;
   }
@@ -128,6 +132,17 @@ class Preferences extends ChangeNotifier {
     notifyListeners();
   }
 
+  bool get prefetchThumbnails {
+    return _prefs.getBool('browser.prefetch_thumbnails') ??
+        Preferences.defaultPrefetchThumbnails;
+  }
+
+  set prefetchThumbnails(bool prefetch) {
+    if (prefetchThumbnails == prefetch) return;
+    _prefs.setBool('browser.prefetch_thumbnails', prefetch);
+    notifyListeners();
+  }
+
   int get slideshowDurationMs {
     final duration = _prefs.getInt('viewer.slideshow_duration');
     return duration != null && duration > 0
@@ -3,14 +3,27 @@ import 'dart:ui' as ui;
 
 import 'package:flutter/foundation.dart';
 import 'package:flutter/painting.dart';
+import 'package:flutter/services.dart';
 
 import 'platform_utils.dart';
 
-typedef ThumbnailPathResolver = Future<String> Function({
+typedef CachedThumbnailResolver = Future<CachedThumbnail> Function({
   required String path,
   required DateTime modificationDate,
   required int? fileSize,
   required int pixelSize,
+  required ThumbnailPriority priority,
+  required ThumbnailView view,
+});
+
+typedef ThumbnailPixelsLoader = Future<ThumbnailPixels> Function({
+  required String path,
+  required DateTime modificationDate,
+  required int? fileSize,
+  required int pixelSize,
+  required int displaySize,
+  required ThumbnailPriority priority,
+  required ThumbnailView view,
 });
 
 /// Loads a locally cached thumbnail while preserving the original file as a
@@ -18,6 +31,14 @@ typedef ThumbnailPathResolver = Future<String> Function({
 ///
 /// Source metadata is part of the provider identity, so Flutter's decoded
 /// image cache invalidates at the same time as the native disk cache.
+///
+/// With a [displaySize], the native texture-ready tier is tried first: its
+/// premultiplied RGBA pixels are wrapped without any codec pass and are not
+/// resized further. The encoded thumbnail stays the fallback.
+///
+/// [priority] and [view] only schedule the native request: they are not
+/// part of the identity, so the first resolve of an image decides them.
+/// A request cancelled with its view fails without decoding the source.
 @immutable
 class CachedThumbnailImageProvider
     extends ImageProvider<CachedThumbnailImageProvider> {
@@ -26,16 +47,44 @@ class CachedThumbnailImageProvider
     required this.modificationDate,
     required this.fileSize,
     this.pixelSize = 960,
+    this.displaySize,
+    this.priority = ThumbnailPriority.visible,
+    this.view = ThumbnailView.shared,
     this.resolver,
+    this.pixelsLoader,
   });
 
   final String path;
   final DateTime modificationDate;
   final int? fileSize;
   final int pixelSize;
+  final int? displaySize;
+  final ThumbnailPriority priority;
+  final ThumbnailView view;
+
+  @visibleForTesting
+  final CachedThumbnailResolver? resolver;
 
   @visibleForTesting
-  final ThumbnailPathResolver? resolver;
+  final ThumbnailPixelsLoader? pixelsLoader;
+
+  /// The same image, requested at [priority] for [view].
+  CachedThumbnailImageProvider scheduled({
+    required ThumbnailPriority priority,
+    required ThumbnailView view,
+  }) {
+    return CachedThumbnailImageProvider(
+      path: path,
+      modificationDate: modificationDate,
+      fileSize: fileSize,
+      pixelSize: pixelSize,
+      displaySize: displaySize,
+      priority: priority,
+      view: view,
+      resolver: resolver,
+      pixelsLoader: pixelsLoader,
+    );
+  }
 
   @override
   Future<CachedThumbnailImageProvider> obtainKey(
@@ -62,51 +111,128 @@ class CachedThumbnailImageProvider
   Future<ui.Codec> _loadAsync(
     CachedThumbnailImageProvider key,
     ImageDecoderCallback decode,
+  ) async {
+    try {
+      return await _load(key, decode);
+    } catch (error) {
+      // Cancelled with its view: a later request must start over.
+      if (_isCancellation(error)) {
+        PaintingBinding.instance.imageCache.evict(key);
+      }
+      rethrow;
+    }
+  }
+
+  Future<ui.Codec> _load(
+    CachedThumbnailImageProvider key,
+    ImageDecoderCallback decode,
   ) async {
     assert(key == this);
-    final resolvedPath = await _resolvePath();
+    final displaySize = key.displaySize;
+    if (displaySize != null) {
+      final codec = await _loadPixels(displaySize);
+      if (codec != null) return codec;
+    }
+    final thumbnail = await _resolve();
     try {
-      return await _decodePath(resolvedPath, key, decode);
+      return await _decode(thumbnail, key, decode);
     } catch (_) {
-      if (resolvedPath == path) rethrow;
-      return _decodePath(path, key, decode);
+      if (thumbnail.path == path) rethrow;
+      return _decode(CachedThumbnail(path: path), key, decode);
     }
   }
 
-  Future<ui.Codec> _decodePath(
-    String resolvedPath,
+  Future<ui.Codec> _decode(
+    CachedThumbnail thumbnail,
     CachedThumbnailImageProvider key,
     ImageDecoderCallback decode,
   ) async {
-    final file = File(resolvedPath);
-    if (await file.length() == 0) {
-      PaintingBinding.instance.imageCache.evict(key);
-      throw StateError('$file is empty and cannot be loaded as an image.');
+    final file = File(thumbnail.path);
+    final length = thumbnail.length;
+    if (length == null) {
+      if (await file.length() == 0) {
+        PaintingBinding.instance.imageCache.evict(key);
+        throw StateError('$file is empty and cannot be loaded as an image.');
+      }
+      return await decode(await ui.ImmutableBuffer.fromFilePath(file.path));
+    }
+
+    // One level of a pyramid: only its bytes are read.
+    final handle = await file.open();
+    try {
+      await handle.setPosition(thumbnail.offset);
+      final bytes = await handle.read(length);
+      if (bytes.length != length) {
+        throw StateError(
+          '$file is truncated and cannot be loaded as an image.',
+        );
+      }
+      return await decode(await ui.ImmutableBuffer.fromUint8List(bytes));
+    } finally {
+      await handle.close();
     }
-    return await decode(await ui.ImmutableBuffer.fromFilePath(resolvedPath));
   }
 
-  Future<String> _resolvePath() async {
+  Future<ui.Codec?> _loadPixels(int displaySize) async {
+    try {
+      final thumbnail =
+          await (pixelsLoader ?? PlatformUtils.loadCachedThumbnailPixels)(
+        path: path,
+        modificationDate: modificationDate,
+        fileSize: fileSize,
+        pixelSize: pixelSize,
+        displaySize: displaySize,
+        priority: priority,
+        view: view,
+      );
+      final buffer = await ui.ImmutableBuffer.fromUint8List(thumbnail.pixels);
+      try {
+        final descriptor = ui.ImageDescriptor.raw(
+          buffer,
+          width: thumbnail.width,
+          height: thumbnail.height,
+          pixelFormat: ui.PixelFormat.rgba8888,
+        );
+        return await descriptor.instantiateCodec();
+      } finally {
+        buffer.dispose();
+      }
+    } catch (error) {
+      if (_isCancellation(error)) rethrow;
+      // The encoded thumbnail and the source remain available.
+      return null;
+    }
+  }
+
+  Future<CachedThumbnail> _resolve() async {
     try {
       return await (resolver ?? PlatformUtils.resolveCachedThumbnail)(
         path: path,
         modificationDate: modificationDate,
         fileSize: fileSize,
         pixelSize: pixelSize,
+        priority: priority,
+        view: view,
       );
-    } catch (_) {
+    } catch (error) {
+      if (_isCancellation(error)) rethrow;
       // A cache failure must never make a source image disappear.
-      return path;
+      return CachedThumbnail(path: path);
     }
   }
 
+  static bool _isCancellation(Object error) =>
+      error is PlatformException &&
+      error.code == PlatformUtils.thumbnailCancelled;
+
   @override
   bool operator ==(Object other) {
     return other is CachedThumbnailImageProvider &&
         other.path == path &&
         other.modificationDate == modificationDate &&
         other.fileSize == fileSize &&
-        other.pixelSize == pixelSize;
+        other.pixelSize == pixelSize &&
+        other.displaySize == displaySize;
   }
 
   @override
@@ -115,11 +241,12 @@ class CachedThumbnailImageProvider
         modificationDate,
         fileSize,
         pixelSize,
+        displaySize,
       );
 
   @override
   String toString() =>
       '${objectRuntimeType(this, 'CachedThumbnailImageProvider')}'
       '("$path", modified: $modificationDate, size: $fileSize, '
-      'pixels: $pixelSize)';
+      'pixels: $pixelSize, display: $displaySize)';
 }
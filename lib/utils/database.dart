@@ -39,6 +39,12 @@ class MediaDb {
         cached.modificationDate == metadata.modificationDate &&
         sizeMatches) {
       cached.fileSize ??= metadata.size;
+      cached.placeholder ??= metadata.placeholder;
+      cached.imageSize ??= metadata.imageSize;
+      if (!cached.captureDateParsed && metadata.captureDate != null) {
+        cached.creationDate = metadata.captureDate!;
+        cached.captureDateParsed = true;
+      }
       return cached;
     }
 
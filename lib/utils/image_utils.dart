@@ -31,6 +31,26 @@ class ImageUtils {
     return data;
   }
 
+  /// Transforms [filepaths] in one native call: JPEGs are transformed
+  /// losslessly in parallel. Returns whether each file was transformed.
+  static Future<List<bool>> transformImages(
+      List<String> filepaths, ImageTransformation transformation,
+      {double jpegCompression = 90}) async {
+    final results = await _mChannel.invokeListMethod<bool>('transformImages', {
+      'filepaths': filepaths,
+      'transformation': transformation.index,
+      'jpegCompression': jpegCompression,
+    });
+    if (results == null || results.length != filepaths.length) {
+      throw PlatformException(
+        code: 'transform_failed',
+        message: 'The images could not be transformed.',
+        details: filepaths,
+      );
+    }
+    return results;
+  }
+
   static Future<bool> losslessRotate(String filepath) async {
     var data = await _mChannel.invokeMethod('losslessRotate', filepath);
     return data;
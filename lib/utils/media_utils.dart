@@ -41,6 +41,21 @@ class MediaUtils {
         p.isWithin(normalizedRoot, normalizedPath);
   }
 
+  /// Subfolders of [path] in the order the sidebar tree shows them.
+  static Future<List<Directory>> listFolders(String path) async {
+    final entities = await Directory(path)
+        .list(recursive: false, followLinks: false)
+        .toList();
+    final folders = entities
+        .whereType<Directory>()
+        .where((folder) => !MediaUtils.shouldExcludeFileOrDir(folder.path))
+        .toList();
+    folders.sort(
+      (a, b) => a.path.toLowerCase().compareTo(b.path.toLowerCase()),
+    );
+    return folders;
+  }
+
   static String? deepestContainingRoot(String path, Iterable<String> roots) {
     final matches = roots.where((root) => isPathAtOrBelow(path, root)).toList();
     matches.sort((a, b) => p
@@ -76,29 +76,109 @@ class PlatformUtils {
     });
   }
 
-  static Future<String> resolveCachedThumbnail({
+  /// Error code of thumbnail requests dropped with their view (see
+  /// [cancelThumbnailRequests]): the source must not be decoded instead.
+  static const String thumbnailCancelled = 'thumbnail_cancelled';
+
+  static Future<CachedThumbnail> resolveCachedThumbnail({
     required String path,
     required DateTime modificationDate,
     required int? fileSize,
     int pixelSize = 960,
+    ThumbnailPriority priority = ThumbnailPriority.visible,
+    ThumbnailView view = ThumbnailView.shared,
   }) async {
-    final cachedPath = await _mChannel.invokeMethod<String>(
+    final thumbnail = await _mChannel.invokeMapMethod<String, Object?>(
       'resolveCachedThumbnail',
       {
         'path': path,
         'modificationMicros': modificationDate.microsecondsSinceEpoch,
         'fileSize': fileSize ?? -1,
         'pixelSize': pixelSize,
+        'priority': priority.index,
+        'view': view.id,
       },
     );
-    if (cachedPath == null || cachedPath.isEmpty) {
+    final cachedPath = thumbnail?['path'];
+    final offset = thumbnail?['offset'];
+    final length = thumbnail?['length'];
+    if (cachedPath is! String ||
+        cachedPath.isEmpty ||
+        offset is! int ||
+        length is! int) {
       throw PlatformException(
         code: 'thumbnail_cache_failed',
         message: 'The thumbnail cache returned no file.',
         details: path,
       );
     }
-    return cachedPath;
+    return CachedThumbnail(path: cachedPath, offset: offset, length: length);
+  }
+
+  static Future<ThumbnailPixels> loadCachedThumbnailPixels({
+    required String path,
+    required DateTime modificationDate,
+    required int? fileSize,
+    required int pixelSize,
+    required int displaySize,
+    ThumbnailPriority priority = ThumbnailPriority.visible,
+    ThumbnailView view = ThumbnailView.shared,
+  }) async {
+    final thumbnail = await _mChannel.invokeMapMethod<String, Object?>(
+      'loadCachedThumbnailPixels',
+      {
+        'path': path,
+        'modificationMicros': modificationDate.microsecondsSinceEpoch,
+        'fileSize': fileSize ?? -1,
+        'pixelSize': pixelSize,
+        'displaySize': displaySize,
+        'priority': priority.index,
+        'view': view.id,
+      },
+    );
+    final width = thumbnail?['width'];
+    final height = thumbnail?['height'];
+    final pixels = thumbnail?['pixels'];
+    if (width is! int || height is! int || pixels is! Uint8List) {
+      throw PlatformException(
+        code: 'thumbnail_cache_failed',
+        message: 'The thumbnail cache returned no pixels.',
+        details: path,
+      );
+    }
+    return ThumbnailPixels(width: width, height: height, pixels: pixels);
+  }
+
+  /// Starts generating thumbnails of [folders] (most likely first) in the
+  /// background, replacing any prefetch in progress. It only runs while the
+  /// user is idle and stops at the first thumbnail request.
+  static Future<void> prefetchThumbnails({
+    required List<String> folders,
+    required Iterable<String> extensions,
+    required int pixelSize,
+    required int displaySize,
+    required int maxSourceBytes,
+    required int maxCacheBytes,
+  }) async {
+    await _mChannel.invokeMethod<bool>('prefetchThumbnails', {
+      'folders': folders,
+      'extensions': extensions.toList(growable: false),
+      'pixelSize': pixelSize,
+      'displaySize': displaySize,
+      'maxSourceBytes': maxSourceBytes,
+      'maxCacheBytes': maxCacheBytes,
+    });
+  }
+
+  static Future<void> cancelThumbnailPrefetch() async {
+    await _mChannel.invokeMethod<bool>('cancelThumbnailPrefetch');
+  }
+
+  /// Pending thumbnail requests of [view] fail with [thumbnailCancelled]
+  /// instead of running. Requests sent afterwards are not affected.
+  static Future<void> cancelThumbnailRequests(ThumbnailView view) async {
+    if (view.id == ThumbnailView.shared.id) return;
+    await _mChannel.invokeMethod<bool>('cancelThumbnailRequests', view.id);
   }
 
   static Future<void> clearThumbnailCache() async {
@@ -188,3 +268,59 @@ class PlatformUtils {
     }
   }
 }
+
+/// Native priority class of a thumbnail request, in the order of the
+/// libimage job scheduler (`job_scheduler.h`).
+enum ThumbnailPriority {
+  /// On screen.
+  visible,
+
+  /// Built ahead of the viewport.
+  nearVisible,
+}
+
+/// Thumbnail requests of one view (a gallery), cancelled together when
+/// the view goes away. Requests of [shared] are never cancelled.
+@immutable
+class ThumbnailView {
+  ThumbnailView() : id = (_nextId = _nextId % maxViews + 1);
+
+  const ThumbnailView._(this.id);
+
+  static const ThumbnailView shared = ThumbnailView._(0);
+
+  /// Views take ids 1 to [maxViews] in turn: the native side has one
+  /// cancellable group for each.
+  static const int maxViews = 31;
+
+  static int _nextId = 0;
+
+  final int id;
+}
+
+/// An encoded thumbnail: a whole file, or the byte range of one level of a
+/// cached thumbnail pyramid.
+@immutable
+class CachedThumbnail {
+  const CachedThumbnail({required this.path, this.offset = 0, this.length});
+
+  final String path;
+  final int offset;
+
+  /// Null for the whole file.
+  final int? length;
+}
+
+/// Premultiplied RGBA8 pixels of a cached thumbnail, tightly packed.
+@immutable
+class ThumbnailPixels {
+  const ThumbnailPixels({
+    required this.width,
+    required this.height,
+    required this.pixels,
+  });
+
+  final int width;
+  final int height;
+  final Uint8List pixels;
+}
@@ -0,0 +1,194 @@
+import 'dart:math' as math;
+import 'dart:typed_data';
+import 'dart:ui' as ui;
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter/painting.dart';
+
+/// Premultiplied RGBA8 pixels, tightly packed.
+class ThumbHashPixels {
+  const ThumbHashPixels({
+    required this.width,
+    required this.height,
+    required this.pixels,
+  });
+
+  final int width;
+  final int height;
+  final Uint8List pixels;
+}
+
+/// Decodes the placeholder hashes produced by `thumb_hash.h` (ThumbHash
+/// format) into a tiny image meant to be stretched under a thumbnail.
+class ThumbHash {
+  const ThumbHash._();
+
+  static const int maxSide = 32;
+
+  static double aspectRatio(Uint8List hash) {
+    final hasAlpha = hash[2] & 0x80 != 0;
+    final isLandscape = hash[4] & 0x80 != 0;
+    final lx = isLandscape ? (hasAlpha ? 5 : 7) : hash[3] & 7;
+    final ly = isLandscape ? hash[3] & 7 : (hasAlpha ? 5 : 7);
+    return lx / ly;
+  }
+
+  /// Returns null when [hash] is not a valid placeholder.
+  static ThumbHashPixels? decode(Uint8List hash) {
+    if (hash.length < 5) return null;
+
+    // constants
+    final header24 = hash[0] | (hash[1] << 8) | (hash[2] << 16);
+    final header16 = hash[3] | (hash[4] << 8);
+    final lDc = (header24 & 63) / 63;
+    final pDc = ((header24 >> 6) & 63) / 31.5 - 1;
+    final qDc = ((header24 >> 12) & 63) / 31.5 - 1;
+    final lScale = ((header24 >> 18) & 31) / 31;
+    final hasAlpha = header24 >> 23 != 0;
+    final pScale = ((header16 >> 3) & 63) / 63;
+    final qScale = ((header16 >> 9) & 63) / 63;
+    final isLandscape = header16 >> 15 != 0;
+    if (header16 & 7 == 0) return null;
+    final lx = math.max(3, isLandscape ? (hasAlpha ? 5 : 7) : header16 & 7);
+    final ly = math.max(3, isLandscape ? header16 & 7 : (hasAlpha ? 5 : 7));
+    if (hasAlpha && hash.length < 6) return null;
+    final aDc = hasAlpha ? (hash[5] & 15) / 15 : 1.0;
+    final aScale = hasAlpha ? (hash[5] >> 4) / 15 : 0.0;
+
+    // varying terms, saturation boosted to make up for quantization
+    final acStart = hasAlpha ? 6 : 5;
+    var acIndex = 0;
+    List<double>? decodeChannel(int nx, int ny, double scale) {
+      final ac = <double>[];
+      for (var cy = 0; cy < ny; cy++) {
+        for (var cx = cy > 0 ? 0 : 1; cx * ny < nx * (ny - cy); cx++) {
+          final offset = acStart + (acIndex >> 1);
+          if (offset >= hash.length) return null;
+          final nibble = (hash[offset] >> ((acIndex & 1) << 2)) & 15;
+          ac.add((nibble / 7.5 - 1) * scale);
+          acIndex++;
+        }
+      }
+      return ac;
+    }
+
+    final lAc = decodeChannel(lx, ly, lScale);
+    final pAc = decodeChannel(3, 3, pScale * 1.25);
+    final qAc = decodeChannel(3, 3, qScale * 1.25);
+    final aAc = hasAlpha ? decodeChannel(5, 5, aScale) : const <double>[];
+    if (lAc == null || pAc == null || qAc == null || aAc == null) return null;
+
+    // inverse DCT
+    final ratio = aspectRatio(hash);
+    final width =
+        math.max(1, (ratio > 1 ? maxSide : maxSide * ratio).round());
+    final height =
+        math.max(1, (ratio > 1 ? maxSide / ratio : maxSide).round());
+    final pixels = Uint8List(width * height * 4);
+    final fx = List<double>.filled(math.max(lx, hasAlpha ? 5 : 3), 0);
+    final fy = List<double>.filled(math.max(ly, hasAlpha ? 5 : 3), 0);
+    var i = 0;
+    for (var y = 0; y < height; y++) {
+      for (var cy = 0; cy < fy.length; cy++) {
+        fy[cy] = math.cos(math.pi / height * (y + 0.5) * cy);
+      }
+      for (var x = 0; x < width; x++, i += 4) {
+        for (var cx = 0; cx < fx.length; cx++) {
+          fx[cx] = math.cos(math.pi / width * (x + 0.5) * cx);
+        }
+
+        var l = lDc, p = pDc, q = qDc, a = aDc;
+        for (var cy = 0, j = 0; cy < ly; cy++) {
+          final fy2 = fy[cy] * 2;
+          for (var cx = cy > 0 ? 0 : 1;
+              cx * ly < lx * (ly - cy);
+              cx++, j++) {
+            l += lAc[j] * fx[cx] * fy2;
+          }
+        }
+        for (var cy = 0, j = 0; cy < 3; cy++) {
+          final fy2 = fy[cy] * 2;
+          for (var cx = cy > 0 ? 0 : 1; cx < 3 - cy; cx++, j++) {
+            final f = fx[cx] * fy2;
+            p += pAc[j] * f;
+            q += qAc[j] * f;
+          }
+        }
+        if (hasAlpha) {
+          for (var cy = 0, j = 0; cy < 5; cy++) {
+            final fy2 = fy[cy] * 2;
+            for (var cx = cy > 0 ? 0 : 1; cx < 5 - cy; cx++, j++) {
+              a += aAc[j] * fx[cx] * fy2;
+            }
+          }
+        }
+
+        final b = l - 2 / 3 * p;
+        final r = (3 * l - b + q) / 2;
+        final g = r - q;
+        final alpha = a.clamp(0.0, 1.0);
+        pixels[i] = (255 * r.clamp(0.0, 1.0) * alpha).round();
+        pixels[i + 1] = (255 * g.clamp(0.0, 1.0) * alpha).round();
+        pixels[i + 2] = (255 * b.clamp(0.0, 1.0) * alpha).round();
+        pixels[i + 3] = (255 * alpha).round();
+      }
+    }
+    return ThumbHashPixels(width: width, height: height, pixels: pixels);
+  }
+}
+
+/// Paints a placeholder hash: the pixels are wrapped without any codec.
+@immutable
+class ThumbHashImageProvider extends ImageProvider<ThumbHashImageProvider> {
+  const ThumbHashImageProvider(this.hash);
+
+  final Uint8List hash;
+
+  @override
+  Future<ThumbHashImageProvider> obtainKey(ImageConfiguration configuration) {
+    return SynchronousFuture<ThumbHashImageProvider>(this);
+  }
+
+  @override
+  ImageStreamCompleter loadImage(
+    ThumbHashImageProvider key,
+    ImageDecoderCallback decode,
+  ) {
+    return OneFrameImageStreamCompleter(_loadAsync());
+  }
+
+  Future<ImageInfo> _loadAsync() async {
+    final decoded = ThumbHash.decode(hash);
+    if (decoded == null) {
+      throw StateError('Invalid placeholder hash.');
+    }
+    final buffer = await ui.ImmutableBuffer.fromUint8List(decoded.pixels);
+    try {
+      final descriptor = ui.ImageDescriptor.raw(
+        buffer,
+        width: decoded.width,
+        height: decoded.height,
+        pixelFormat: ui.PixelFormat.rgba8888,
+      );
+      final codec = await descriptor.instantiateCodec();
+      final frame = await codec.getNextFrame();
+      codec.dispose();
+      return ImageInfo(image: frame.image);
+    } finally {
+      buffer.dispose();
+    }
+  }
+
+  @override
+  bool operator ==(Object other) {
+    return other is ThumbHashImageProvider && listEquals(other.hash, hash);
+  }
+
+  @override
+  int get hashCode => Object.hashAll(hash);
+
+  @override
+  String toString() =>
+      '${objectRuntimeType(this, 'ThumbHashImageProvider')}'
+      '(${hash.length} bytes)';
+}
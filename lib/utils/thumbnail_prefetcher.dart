@@ -0,0 +1,118 @@
+import 'dart:async';
+import 'dart:io';
+
+import 'package:flutter/foundation.dart';
+import 'package:path/path.dart' as p;
+
+import '../model/media.dart';
+import 'media_utils.dart';
+import 'platform_utils.dart';
+
+typedef ThumbnailPrefetch = Future<void> Function(List<String> folders);
+
+/// Warms the thumbnail cache for the folders the user is likely to open
+/// next. Native code does the work at background priority, only while the
+/// user is idle, and gives way to any foreground thumbnail request.
+class ThumbnailPrefetcher {
+  static const Duration idleDelay = Duration(seconds: 3);
+  static const int maxRecentFolders = 4;
+  static const int maxSourceBytes = 512 * 1024 * 1024;
+  static const int maxCacheBytes = 96 * 1024 * 1024;
+
+  ThumbnailPrefetcher({@visibleForTesting ThumbnailPrefetch? prefetch})
+      : _prefetch = prefetch ?? _prefetchNatively;
+
+  final ThumbnailPrefetch _prefetch;
+  Timer? _timer;
+  int _generation = 0;
+  bool _active = false;
+
+  /// Schedules a prefetch around [folder] once the browser has settled on
+  /// it. [recent] is ordered most recent first.
+  void folderShown(
+    String folder, {
+    Iterable<String> recent = const [],
+    Iterable<String> favorites = const [],
+  }) {
+    cancel();
+    final generation = _generation;
+    _timer = Timer(idleDelay, () async {
+      final folders = await candidateFolders(
+        folder,
+        recent: recent,
+        favorites: favorites,
+      );
+      if (generation != _generation || folders.isEmpty) return;
+      _active = true;
+      try {
+        await _prefetch(folders);
+      } catch (error) {
+        debugPrint('Unable to prefetch thumbnails: $error');
+      }
+    });
+  }
+
+  void cancel() {
+    _generation += 1;
+    _timer?.cancel();
+    _timer = null;
+    if (_active) {
+      _active = false;
+      unawaited(PlatformUtils.cancelThumbnailPrefetch().catchError(
+        (Object error) => debugPrint('Unable to cancel prefetch: $error'),
+      ));
+    }
+  }
+
+  void dispose() {
+    cancel();
+  }
+
+  /// Folders to prefetch, most likely first: the next and previous siblings
+  /// of [folder] in sidebar order, then recent folders, then favorites.
+  @visibleForTesting
+  static Future<List<String>> candidateFolders(
+    String folder, {
+    Iterable<String> recent = const [],
+    Iterable<String> favorites = const [],
+  }) async {
+    final candidates = <String>[];
+    final parent = p.dirname(folder);
+    if (parent != folder) {
+      try {
+        final siblings = (await MediaUtils.listFolders(parent))
+            .map((sibling) => sibling.path)
+            .toList(growable: false);
+        final index = siblings.indexOf(folder);
+        if (index >= 0) {
+          if (index + 1 < siblings.length) candidates.add(siblings[index + 1]);
+          if (index > 0) candidates.add(siblings[index - 1]);
+        }
+      } catch (error) {
+        debugPrint('Unable to list $parent: $error');
+      }
+    }
+    candidates.addAll(recent.take(maxRecentFolders));
+    candidates.addAll(favorites);
+
+    final seen = <String>{folder};
+    final folders = <String>[];
+    for (final candidate in candidates) {
+      if (seen.add(candidate) && await Directory(candidate).exists()) {
+        folders.add(candidate);
+      }
+    }
+    return folders;
+  }
+
+  static Future<void> _prefetchNatively(List<String> folders) {
+    return PlatformUtils.prefetchThumbnails(
+      folders: folders,
+      extensions: MediaUtils.imageExtensions,
+      pixelSize: MediaItem.thumbnailPixelSize,
+      displaySize: MediaItem.thumbnailDisplaySize,
+      maxSourceBytes: maxSourceBytes,
+      maxCacheBytes: maxCacheBytes,
+    );
+  }
+}
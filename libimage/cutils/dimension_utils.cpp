@@ -0,0 +1,315 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <vector>
+
+#include "cutils.h"
+#include "dimension_utils.h"
+#include "jpeg_index.h"
+#include "job_scheduler.h"
+#include "tiff_utils.h"
+
+// tiff directories further than this are not worth a probe
+#define DIMENSIONS_MAX_TIFF_READ (256 * 1024)
+
+// probing is mostly waiting for the disk (or the network)
+#define DIMENSIONS_MAX_WORKERS 8
+
+static uint32_t be16(const unsigned char* p) { return (p[0] << 8) | p[1]; }
+static uint32_t be32(const unsigned char* p) { return ((uint32_t) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+static uint32_t le16(const unsigned char* p) { return p[0] | (p[1] << 8); }
+static uint32_t le24(const unsigned char* p) { return p[0] | (p[1] << 8) | (p[2] << 16); }
+static uint32_t le32(const unsigned char* p) { return le24(p) | ((uint32_t) p[3] << 24); }
+
+static bool readAt(int fd, std::vector<unsigned char>& buffer, size_t size, off_t offset) {
+	buffer.resize(size);
+	size_t done = 0;
+	while (done < size) {
+		ssize_t count = pread(fd, &buffer[done], size - done, offset + (off_t) done);
+		if (count <= 0) {
+			break;
+		}
+		done += (size_t) count;
+	}
+	buffer.resize(done);
+	return done == size;
+}
+
+// orientation (and size if asked) from IFD0
+static bool probeTiffIfd0(const unsigned char* data, size_t size, bool with_size, ImageDimensions* dimensions) {
+
+	TiffData tiff;
+	if (tiff.open(data, size) == false) {
+		return false;
+	}
+	TiffIfd ifd0(tiff, tiff.ifd0());
+	if (ifd0.valid() == false) {
+		return false;
+	}
+
+	TiffEntry entry;
+	uint32_t value;
+	if (ifd0.find(TIFF_TAG_ORIENTATION, &entry) && tiff.value(entry, &value) && value >= 1 && value <= 8) {
+		dimensions->orientation = (uint16_t) value;
+	}
+	if (with_size) {
+		if (ifd0.find(TIFF_TAG_IMAGE_WIDTH, &entry) && tiff.value(entry, &value)) {
+			dimensions->width = value;
+		}
+		if (ifd0.find(TIFF_TAG_IMAGE_LENGTH, &entry) && tiff.value(entry, &value)) {
+			dimensions->height = value;
+		}
+	}
+	return true;
+}
+
+static bool isSOF(unsigned char marker) {
+	return marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+}
+
+static void probeJpegData(const unsigned char* data, size_t size, ImageDimensions* dimensions) {
+
+	size_t offset = 2;
+	while (offset + 4 <= size) {
+
+		if (data[offset] != 0xFF) {
+			break;
+		}
+		unsigned char marker = data[offset + 1];
+		if (marker == 0xFF) {
+			offset++;
+			continue;
+		}
+		if (marker == 0xDA || marker == 0xD9) {
+			break;
+		}
+
+		size_t length = be16(data + offset + 2);
+		if (length < 2) {
+			break;
+		}
+
+		// a segment may run past data: parse what we have
+		size_t available = min(length - 2, size - offset - 4);
+		const unsigned char* payload = data + offset + 4;
+
+		if (marker == 0xE1 && available >= 6 + 8 && memcmp(payload, "Exif\0\0", 6) == 0) {
+			probeTiffIfd0(payload + 6, available - 6, false, dimensions);
+		} else if (isSOF(marker) && available >= 5) {
+			dimensions->height = be16(payload + 1);
+			dimensions->width = be16(payload + 3);
+			break;
+		}
+
+		offset += 2 + length;
+	}
+}
+
+static void probeWebpData(const unsigned char* data, size_t size, ImageDimensions* dimensions) {
+
+	const unsigned char* chunk = data + 12;
+	const unsigned char* payload = data + 20;
+	if (memcmp(chunk, "VP8 ", 4) == 0) {
+		// lossy: key frame start code then 14-bit sizes
+		if (size >= 30 && payload[3] == 0x9D && payload[4] == 0x01 && payload[5] == 0x2A) {
+			dimensions->width = le16(payload + 6) & 0x3FFF;
+			dimensions->height = le16(payload + 8) & 0x3FFF;
+		}
+	} else if (memcmp(chunk, "VP8L", 4) == 0) {
+		// lossless: signature then 14-bit sizes minus one
+		if (size >= 25 && payload[0] == 0x2F) {
+			uint32_t bits = le32(payload + 1);
+			dimensions->width = (bits & 0x3FFF) + 1;
+			dimensions->height = ((bits >> 14) & 0x3FFF) + 1;
+		}
+	} else if (memcmp(chunk, "VP8X", 4) == 0) {
+		// extended: 24-bit canvas sizes minus one
+		if (size >= 30) {
+			dimensions->width = le24(payload + 4) + 1;
+			dimensions->height = le24(payload + 7) + 1;
+		}
+	}
+}
+
+bool probeDimensionsData(const unsigned char* data, size_t size, ImageDimensions* dimensions) {
+
+	if (dimensions == NULL) {
+		return false;
+	}
+	memset(dimensions, 0, sizeof(ImageDimensions));
+	dimensions->orientation = 1;
+	if (data == NULL || size < 10) {
+		return false;
+	}
+
+	if (data[0] == 0xFF && data[1] == 0xD8) {
+		dimensions->format = IMAGE_FORMAT_JPEG;
+		probeJpegData(data, size, dimensions);
+	} else if (size >= 24 && memcmp(data, "\x89PNG\r\n\x1A\n", 8) == 0 && memcmp(data + 12, "IHDR", 4) == 0) {
+		dimensions->format = IMAGE_FORMAT_PNG;
+		dimensions->width = be32(data + 16);
+		dimensions->height = be32(data + 20);
+	} else if (memcmp(data, "GIF87a", 6) == 0 || memcmp(data, "GIF89a", 6) == 0) {
+		dimensions->format = IMAGE_FORMAT_GIF;
+		dimensions->width = le16(data + 6);
+		dimensions->height = le16(data + 8);
+	} else if (size >= 20 && memcmp(data, "RIFF", 4) == 0 && memcmp(data + 8, "WEBP", 4) == 0) {
+		dimensions->format = IMAGE_FORMAT_WEBP;
+		probeWebpData(data, size, dimensions);
+	} else if ((data[0] == 0x49 && data[1] == 0x49) || (data[0] == 0x4D && data[1] == 0x4D)) {
+		dimensions->format = IMAGE_FORMAT_TIFF;
+		probeTiffIfd0(data, size, true, dimensions);
+	}
+
+	return dimensions->width != 0 && dimensions->height != 0;
+}
+
+// exif orientation of a jpeg: only the start of the exif block is read
+static void probeJpegOrientation(int fd, const JpegIndex* index, const std::vector<unsigned char>& head, ImageDimensions* dimensions) {
+
+	const JpegSegment* segment = jpegIndexFind(index, 0xE1, "Exif");
+	if (segment == NULL || segment->length < 2 + 6 + 8) {
+		return;
+	}
+
+	// IFD0 is at the start of the block, the thumbnail at the end
+	size_t tiff_offset = segment->offset + 4 + 6;
+	size_t tiff_size = min((size_t) segment->length - 2 - 6, (size_t) DIMENSIONS_HEAD_READ);
+	if (tiff_offset + tiff_size <= head.size()) {
+		probeTiffIfd0(&head[tiff_offset], tiff_size, false, dimensions);
+		return;
+	}
+
+	std::vector<unsigned char> tiff;
+	if (readAt(fd, tiff, tiff_size, (off_t) tiff_offset)) {
+		probeTiffIfd0(&tiff[0], tiff.size(), false, dimensions);
+	}
+}
+
+// webp orientation lives in an EXIF chunk, usually after the image data
+// chunk headers are read one by one to skip it
+static void probeWebpOrientation(int fd, size_t file_size, const std::vector<unsigned char>& head, ImageDimensions* dimensions) {
+
+	// VP8X exif flag
+	if (head.size() < 21 || memcmp(&head[12], "VP8X", 4) != 0 || (head[20] & 0x08) == 0) {
+		return;
+	}
+
+	size_t offset = 12;
+	std::vector<unsigned char> header;
+	while (offset + 8 <= file_size && readAt(fd, header, 8, (off_t) offset)) {
+		size_t size = le32(&header[4]);
+		if (memcmp(&header[0], "EXIF", 4) == 0) {
+			std::vector<unsigned char> exif;
+			if (size >= 8 && readAt(fd, exif, min(size, (size_t) DIMENSIONS_HEAD_READ), (off_t) (offset + 8))) {
+				// some writers keep the jpeg "Exif\0\0" prefix
+				size_t skip = (exif.size() >= 6 && memcmp(&exif[0], "Exif\0\0", 6) == 0) ? 6 : 0;
+				probeTiffIfd0(&exif[skip], exif.size() - skip, false, dimensions);
+			}
+			return;
+		}
+		offset += 8 + size + (size & 1);
+	}
+}
+
+bool probeDimensions(const char* file, ImageDimensions* dimensions) {
+
+	if (dimensions == NULL) {
+		return false;
+	}
+	memset(dimensions, 0, sizeof(ImageDimensions));
+	if (file == NULL) {
+		return false;
+	}
+
+	int fd = open(file, O_RDONLY);
+	if (fd == -1) {
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return false;
+	}
+	size_t file_size = (size_t) st.st_size;
+
+	// one small read for the common case
+	std::vector<unsigned char> head;
+	readAt(fd, head, min(file_size, (size_t) DIMENSIONS_HEAD_READ), 0);
+	bool rc = probeDimensionsData(head.empty() ? NULL : &head[0], head.size(), dimensions);
+
+	switch (dimensions->format) {
+
+		case IMAGE_FORMAT_JPEG: {
+			// SOF is often past the exif block
+			JpegIndex index;
+			if (rc == false && jpegIndexFile(file, &index) && index.width != 0 && index.height != 0) {
+				dimensions->width = index.width;
+				dimensions->height = index.height;
+				probeJpegOrientation(fd, &index, head, dimensions);
+				rc = true;
+			}
+			break;
+		}
+
+		case IMAGE_FORMAT_WEBP:
+			if (rc) {
+				probeWebpOrientation(fd, file_size, head, dimensions);
+			}
+			break;
+
+		case IMAGE_FORMAT_TIFF: {
+			// IFD0 is not always right after the header
+			TiffData tiff;
+			std::vector<unsigned char> count;
+			if (rc == false && tiff.open(&head[0], head.size()) && readAt(fd, count, 2, (off_t) tiff.ifd0())) {
+				uint32_t entries = tiff.little_endian() ? le16(&count[0]) : be16(&count[0]);
+				size_t needed = (size_t) tiff.ifd0() + 2 + 12 * entries + 4;
+				if (needed > head.size() && needed <= min(file_size, (size_t) DIMENSIONS_MAX_TIFF_READ) && readAt(fd, head, needed, 0)) {
+					rc = probeDimensionsData(&head[0], head.size(), dimensions);
+				}
+			}
+			break;
+		}
+	}
+
+	close(fd);
+	return rc;
+}
+
+struct DimensionsBatch {
+	const char* const* files;
+	ImageDimensions* dimensions;
+	std::atomic<size_t> succeeded;
+};
+
+static void probeItem(void* context, size_t index) {
+	DimensionsBatch* batch = (DimensionsBatch*) context;
+	if (probeDimensions(batch->files[index], &batch->dimensions[index])) {
+		batch->succeeded.fetch_add(1);
+	} else {
+		memset(&batch->dimensions[index], 0, sizeof(ImageDimensions));
+	}
+}
+
+size_t probeDimensionsBatch(const char* const* files, size_t count, ImageDimensions* dimensions) {
+
+	if (files == NULL || dimensions == NULL || count == 0) {
+		return 0;
+	}
+
+	DimensionsBatch batch;
+	batch.files = files;
+	batch.dimensions = dimensions;
+	batch.succeeded = 0;
+
+	// layout waits for these
+	JobScheduler* scheduler = jobSchedulerShared();
+	jobSchedulerRunBatch(scheduler, JOB_PRIORITY_VISIBLE, JOB_GROUP_DEFAULT,
+											 jobSchedulerGeneration(scheduler, JOB_GROUP_DEFAULT),
+											 count, DIMENSIONS_MAX_WORKERS, probeItem, &batch);
+
+	// done
+	return batch.succeeded.load();
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	#define IMAGE_FORMAT_UNKNOWN 0
+	#define IMAGE_FORMAT_JPEG    1
+	#define IMAGE_FORMAT_PNG     2
+	#define IMAGE_FORMAT_GIF     3
+	#define IMAGE_FORMAT_WEBP    4
+	#define IMAGE_FORMAT_TIFF    5
+
+	// size of the first read: enough for all formats but jpeg
+	#define DIMENSIONS_HEAD_READ 4096
+
+	typedef struct {
+		uint32_t width;              // pixels as stored (orientation not applied)
+		uint32_t height;
+		uint16_t orientation;        // exif orientation (1 if absent)
+		uint16_t format;             // IMAGE_FORMAT_*
+	} ImageDimensions;
+
+	// reads the first bytes of file and parses jpeg SOF, png IHDR,
+	// gif logical screen, webp VP8/VP8L/VP8X or tiff IFD0
+	// jpeg markers go through the marker index (see jpeg_index.h)
+	bool probeDimensions(const char* file, ImageDimensions* dimensions);
+
+	// same as probeDimensions on the first bytes of a file
+	// jpeg orientation is only found if the exif block is in data
+	bool probeDimensionsData(const unsigned char* data, size_t size, ImageDimensions* dimensions);
+
+	// probes count files into dimensions[count] using several threads
+	// failed entries are zeroed. returns the number of successes
+	size_t probeDimensionsBatch(const char* const* files, size_t count, ImageDimensions* dimensions);
+
+#ifdef __cplusplus
+}
+#endif
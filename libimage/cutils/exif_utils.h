@@ -8,6 +8,18 @@ extern "C" {
 	// pass valid exif orientation to set orientation value
 	bool exif_orient(const char* file, unsigned char* orientation);
 	
+	// same as exif_orient on an in-memory exif block
+	// tiff points to the tiff header following "Exif\0\0"
+	// orientation is updated in IFD0, and in IFD1 if present and with_thumbnail
+	bool exif_orient_data(unsigned char* tiff, unsigned int length, unsigned char* orientation, bool with_thumbnail);
+	
+	// location of the jpeg thumbnail described by IFD1
+	// offset is relative to the tiff header
+	bool exif_thumbnail_data(unsigned char* tiff, unsigned int length, unsigned int* offset, unsigned int* size);
+	
+	// updates the jpeg thumbnail length in IFD1
+	bool exif_set_thumbnail_size(unsigned char* tiff, unsigned int length, unsigned int size);
+	
 #ifdef __cplusplus
 }
 #endif
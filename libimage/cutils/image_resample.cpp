@@ -0,0 +1,551 @@
+#include <math.h>
+#include <stdint.h>
+#include <atomic>
+#include <new>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define IMAGE_RESAMPLE_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define IMAGE_RESAMPLE_NEON
+#include <arm_neon.h>
+#endif
+
+#include "cutils.h"
+#include "image_resample.h"
+
+#define RESAMPLE_PRECISION 14
+#define RESAMPLE_ONE       (1 << RESAMPLE_PRECISION)
+#define RESAMPLE_ROUND     (1 << (RESAMPLE_PRECISION - 1))
+
+// taps of one pass: output sample i reads count[i] source samples from
+// first[i] with weights[i * taps, ...) (zero padded), summing to RESAMPLE_ONE
+typedef struct {
+	std::vector<uint32_t> first;
+	std::vector<uint32_t> count;
+	std::vector<int16_t> weights;
+	uint32_t taps;
+} ResampleWeights;
+
+static double triangle(double x) {
+	x = fabs(x);
+	return x < 1 ? 1 - x : 0;
+}
+
+static double sinc(double x) {
+	if (x == 0) {
+		return 1;
+	}
+	x *= M_PI;
+	return sin(x) / x;
+}
+
+static double lanczos3(double x) {
+	return (x > -3 && x < 3) ? sinc(x) * sinc(x / 3) : 0;
+}
+
+static void computeWeights(uint32_t src_size, uint32_t dst_size, ImageResampleFilter filter, ResampleWeights* weights) {
+
+	double scale = (double) src_size / dst_size;
+	double filter_scale = max(scale, 1.0);
+	double support = (filter == IMAGE_RESAMPLE_LANCZOS3 ? 3.0 : 1.0) * filter_scale;
+
+	// float weights first
+	std::vector<uint32_t> first(dst_size);
+	std::vector<uint32_t> offset(dst_size + 1);
+	std::vector<double> values;
+	for (uint32_t i = 0; i < dst_size; i++) {
+		offset[i] = (uint32_t) values.size();
+		if (filter == IMAGE_RESAMPLE_BOX) {
+
+			// exact coverage, in src_size * dst_size units
+			uint64_t start = (uint64_t) i * src_size;
+			uint64_t end = start + src_size;
+			first[i] = (uint32_t) (start / dst_size);
+			uint32_t last = (uint32_t) ((end - 1) / dst_size);
+			for (uint32_t s = first[i]; s <= last; s++) {
+				uint64_t lo = max(start, (uint64_t) s * dst_size);
+				uint64_t hi = min(end, (uint64_t) (s + 1) * dst_size);
+				values.push_back((double) (hi - lo) / src_size);
+			}
+
+		} else {
+
+			// filter centered on the sample, stretched when downscaling
+			double center = (i + 0.5) * scale;
+			int64_t lo = max((int64_t) 0, (int64_t) floor(center - support + 0.5));
+			int64_t hi = min((int64_t) src_size, (int64_t) floor(center + support + 0.5));
+			first[i] = (uint32_t) lo;
+			double total = 0;
+			for (int64_t s = lo; s < hi; s++) {
+				double x = (s + 0.5 - center) / filter_scale;
+				double w = filter == IMAGE_RESAMPLE_LANCZOS3 ? lanczos3(x) : triangle(x);
+				values.push_back(w);
+				total += w;
+			}
+			if (total == 0) {
+				// cannot happen with these filters: use the nearest sample
+				values.resize(offset[i]);
+				first[i] = (uint32_t) min((int64_t) src_size - 1, (int64_t) center);
+				values.push_back(1);
+				total = 1;
+			}
+			for (size_t k = offset[i]; k < values.size(); k++) {
+				values[k] /= total;
+			}
+		}
+	}
+	offset[dst_size] = (uint32_t) values.size();
+
+	// fixed point, rounding error put on the largest weight
+	std::vector<int32_t> quantized(values.size());
+	weights->first.resize(dst_size);
+	weights->count.resize(dst_size);
+	weights->taps = 1;
+	std::vector<uint32_t> start(dst_size);
+	for (uint32_t i = 0; i < dst_size; i++) {
+		int32_t total = 0;
+		uint32_t largest = offset[i];
+		for (uint32_t k = offset[i]; k < offset[i + 1]; k++) {
+			quantized[k] = (int32_t) lround(values[k] * RESAMPLE_ONE);
+			total += quantized[k];
+			if (fabs(values[k]) > fabs(values[largest])) {
+				largest = k;
+			}
+		}
+		quantized[largest] += RESAMPLE_ONE - total;
+
+		// zero weights on the edges are not worth reading
+		uint32_t lo = offset[i];
+		uint32_t hi = offset[i + 1];
+		while (lo + 1 < hi && quantized[lo] == 0) {
+			lo++;
+		}
+		while (hi - 1 > lo && quantized[hi - 1] == 0) {
+			hi--;
+		}
+		start[i] = lo;
+		weights->first[i] = first[i] + (lo - offset[i]);
+		weights->count[i] = hi - lo;
+		weights->taps = max(weights->taps, hi - lo);
+	}
+
+	weights->weights.assign((size_t) dst_size * weights->taps, 0);
+	for (uint32_t i = 0; i < dst_size; i++) {
+		for (uint32_t k = 0; k < weights->count[i]; k++) {
+			weights->weights[(size_t) i * weights->taps + k] = (int16_t) quantized[start[i] + k];
+		}
+	}
+}
+
+static inline unsigned char clamp8(int32_t sum) {
+	sum = (sum + RESAMPLE_ROUND) >> RESAMPLE_PRECISION;
+	return (unsigned char) (sum < 0 ? 0 : (sum > 255 ? 255 : sum));
+}
+
+static inline uint32_t weightPair(int16_t a, int16_t b) {
+	return (uint16_t) a | ((uint32_t) (uint16_t) b << 16);
+}
+
+// plain c kernels
+
+static void horizontalC(const unsigned char* src, unsigned char* dst, uint32_t dst_width, int channels,
+												const ResampleWeights* weights) {
+
+	for (uint32_t x = 0; x < dst_width; x++) {
+		const unsigned char* p = src + (size_t) weights->first[x] * channels;
+		const int16_t* k = &weights->weights[(size_t) x * weights->taps];
+		for (int c = 0; c < channels; c++) {
+			int32_t sum = 0;
+			for (uint32_t t = 0; t < weights->count[x]; t++) {
+				sum += p[t * channels + c] * k[t];
+			}
+			*dst++ = clamp8(sum);
+		}
+	}
+}
+
+static void horizontalRGBAC(const unsigned char* src, unsigned char* dst, uint32_t dst_width,
+														const ResampleWeights* weights) {
+	horizontalC(src, dst, dst_width, 4, weights);
+}
+
+// accumulates a block of columns row after row
+static void verticalC(const unsigned char* src, size_t stride, const int16_t* weights, uint32_t count,
+											unsigned char* dst, size_t bytes) {
+
+	int32_t sums[256];
+	for (size_t block = 0; block < bytes; block += 256) {
+		size_t n = min(bytes - block, (size_t) 256);
+		for (size_t i = 0; i < n; i++) {
+			sums[i] = 0;
+		}
+		for (uint32_t t = 0; t < count; t++) {
+			const unsigned char* row = src + t * stride + block;
+			for (size_t i = 0; i < n; i++) {
+				sums[i] += row[i] * weights[t];
+			}
+		}
+		for (size_t i = 0; i < n; i++) {
+			dst[block + i] = clamp8(sums[i]);
+		}
+	}
+}
+
+#ifdef IMAGE_RESAMPLE_X86
+
+// sse4.1 kernels
+
+__attribute__((target("sse4.1")))
+static inline __m128i packRGBA(__m128i sum) {
+	sum = _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(RESAMPLE_ROUND)), RESAMPLE_PRECISION);
+	sum = _mm_packs_epi32(sum, sum);
+	return _mm_packus_epi16(sum, sum);
+}
+
+// pairs of taps: pixels are shuffled to r0 r1 g0 g1 b0 b1 a0 a1 (16 bits)
+// so one madd weighs and adds both
+__attribute__((target("sse4.1")))
+static inline __m128i horizontalTail(const unsigned char* p, const int16_t* k, uint32_t t, uint32_t count,
+																		 __m128i sum) {
+
+	const __m128i shuffle = _mm_setr_epi8(0, -1, 4, -1, 1, -1, 5, -1, 2, -1, 6, -1, 3, -1, 7, -1);
+	for (; t + 1 < count; t += 2) {
+		__m128i pixels = _mm_shuffle_epi8(_mm_loadl_epi64((const __m128i*) (p + t * 4)), shuffle);
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(pixels, _mm_set1_epi32((int) weightPair(k[t], k[t + 1]))));
+	}
+	if (t < count) {
+		int32_t last;
+		memcpy(&last, p + t * 4, 4);
+		__m128i pixels = _mm_shuffle_epi8(_mm_cvtsi32_si128(last), shuffle);
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(pixels, _mm_set1_epi32((int) weightPair(k[t], 0))));
+	}
+	return sum;
+}
+
+__attribute__((target("sse4.1")))
+static void horizontalRGBASSE4(const unsigned char* src, unsigned char* dst, uint32_t dst_width,
+															 const ResampleWeights* weights) {
+
+	for (uint32_t x = 0; x < dst_width; x++) {
+		const unsigned char* p = src + (size_t) weights->first[x] * 4;
+		const int16_t* k = &weights->weights[(size_t) x * weights->taps];
+		__m128i sum = horizontalTail(p, k, 0, weights->count[x], _mm_setzero_si128());
+		int32_t pixel = _mm_cvtsi128_si32(packRGBA(sum));
+		memcpy(dst + (size_t) x * 4, &pixel, 4);
+	}
+}
+
+// 16 columns: rows are interleaved by pairs so one madd weighs and adds both
+__attribute__((target("sse4.1")))
+static void verticalSSE4(const unsigned char* src, size_t stride, const int16_t* weights, uint32_t count,
+												 unsigned char* dst, size_t bytes) {
+
+	const __m128i round = _mm_set1_epi32(RESAMPLE_ROUND);
+	size_t i = 0;
+	for (; i + 16 <= bytes; i += 16) {
+		__m128i sum0 = _mm_setzero_si128();
+		__m128i sum1 = _mm_setzero_si128();
+		__m128i sum2 = _mm_setzero_si128();
+		__m128i sum3 = _mm_setzero_si128();
+		for (uint32_t t = 0; t < count; t += 2) {
+			__m128i a = _mm_loadu_si128((const __m128i*) (src + t * stride + i));
+			__m128i b = _mm_setzero_si128();
+			int16_t wb = 0;
+			if (t + 1 < count) {
+				b = _mm_loadu_si128((const __m128i*) (src + (t + 1) * stride + i));
+				wb = weights[t + 1];
+			}
+			__m128i w = _mm_set1_epi32((int) weightPair(weights[t], wb));
+			__m128i lo = _mm_unpacklo_epi8(a, b);
+			__m128i hi = _mm_unpackhi_epi8(a, b);
+			sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(_mm_cvtepu8_epi16(lo), w));
+			sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(lo, 8)), w));
+			sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(_mm_cvtepu8_epi16(hi), w));
+			sum3 = _mm_add_epi32(sum3, _mm_madd_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(hi, 8)), w));
+		}
+		sum0 = _mm_srai_epi32(_mm_add_epi32(sum0, round), RESAMPLE_PRECISION);
+		sum1 = _mm_srai_epi32(_mm_add_epi32(sum1, round), RESAMPLE_PRECISION);
+		sum2 = _mm_srai_epi32(_mm_add_epi32(sum2, round), RESAMPLE_PRECISION);
+		sum3 = _mm_srai_epi32(_mm_add_epi32(sum3, round), RESAMPLE_PRECISION);
+		__m128i packed = _mm_packus_epi16(_mm_packs_epi32(sum0, sum1), _mm_packs_epi32(sum2, sum3));
+		_mm_storeu_si128((__m128i*) (dst + i), packed);
+	}
+	if (i < bytes) {
+		verticalC(src + i, stride, weights, count, dst + i, bytes - i);
+	}
+}
+
+// avx2 kernels
+
+// four taps at once, one pair per 128-bit lane
+__attribute__((target("avx2")))
+static void horizontalRGBAAVX2(const unsigned char* src, unsigned char* dst, uint32_t dst_width,
+															 const ResampleWeights* weights) {
+
+	const __m256i shuffle = _mm256_setr_epi8(0, -1, 4, -1, 1, -1, 5, -1, 2, -1, 6, -1, 3, -1, 7, -1,
+																					 8, -1, 12, -1, 9, -1, 13, -1, 10, -1, 14, -1, 11, -1, 15, -1);
+	for (uint32_t x = 0; x < dst_width; x++) {
+		const unsigned char* p = src + (size_t) weights->first[x] * 4;
+		const int16_t* k = &weights->weights[(size_t) x * weights->taps];
+		uint32_t count = weights->count[x];
+		__m256i wide = _mm256_setzero_si256();
+		uint32_t t = 0;
+		for (; t + 3 < count; t += 4) {
+			__m128i quad = _mm_loadu_si128((const __m128i*) (p + t * 4));
+			__m256i pixels = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(quad), shuffle);
+			__m256i w = _mm256_setr_epi32((int) weightPair(k[t], k[t + 1]), (int) weightPair(k[t], k[t + 1]),
+																		(int) weightPair(k[t], k[t + 1]), (int) weightPair(k[t], k[t + 1]),
+																		(int) weightPair(k[t + 2], k[t + 3]), (int) weightPair(k[t + 2], k[t + 3]),
+																		(int) weightPair(k[t + 2], k[t + 3]), (int) weightPair(k[t + 2], k[t + 3]));
+			wide = _mm256_add_epi32(wide, _mm256_madd_epi16(pixels, w));
+		}
+		__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(wide), _mm256_extracti128_si256(wide, 1));
+		sum = horizontalTail(p, k, t, count, sum);
+		int32_t pixel = _mm_cvtsi128_si32(packRGBA(sum));
+		memcpy(dst + (size_t) x * 4, &pixel, 4);
+	}
+}
+
+// 32 columns, as verticalSSE4
+__attribute__((target("avx2")))
+static void verticalAVX2(const unsigned char* src, size_t stride, const int16_t* weights, uint32_t count,
+												 unsigned char* dst, size_t bytes) {
+
+	const __m256i round = _mm256_set1_epi32(RESAMPLE_ROUND);
+	size_t i = 0;
+	for (; i + 32 <= bytes; i += 32) {
+		__m256i sum0 = _mm256_setzero_si256();
+		__m256i sum1 = _mm256_setzero_si256();
+		__m256i sum2 = _mm256_setzero_si256();
+		__m256i sum3 = _mm256_setzero_si256();
+		for (uint32_t t = 0; t < count; t += 2) {
+			__m256i a = _mm256_loadu_si256((const __m256i*) (src + t * stride + i));
+			__m256i b = _mm256_setzero_si256();
+			int16_t wb = 0;
+			if (t + 1 < count) {
+				b = _mm256_loadu_si256((const __m256i*) (src + (t + 1) * stride + i));
+				wb = weights[t + 1];
+			}
+			__m256i w = _mm256_set1_epi32((int) weightPair(weights[t], wb));
+			// lanes hold columns 0-7 | 16-23 and 8-15 | 24-31
+			__m256i lo = _mm256_unpacklo_epi8(a, b);
+			__m256i hi = _mm256_unpackhi_epi8(a, b);
+			__m256i zero = _mm256_setzero_si256();
+			sum0 = _mm256_add_epi32(sum0, _mm256_madd_epi16(_mm256_unpacklo_epi8(lo, zero), w));
+			sum1 = _mm256_add_epi32(sum1, _mm256_madd_epi16(_mm256_unpackhi_epi8(lo, zero), w));
+			sum2 = _mm256_add_epi32(sum2, _mm256_madd_epi16(_mm256_unpacklo_epi8(hi, zero), w));
+			sum3 = _mm256_add_epi32(sum3, _mm256_madd_epi16(_mm256_unpackhi_epi8(hi, zero), w));
+		}
+		sum0 = _mm256_srai_epi32(_mm256_add_epi32(sum0, round), RESAMPLE_PRECISION);
+		sum1 = _mm256_srai_epi32(_mm256_add_epi32(sum1, round), RESAMPLE_PRECISION);
+		sum2 = _mm256_srai_epi32(_mm256_add_epi32(sum2, round), RESAMPLE_PRECISION);
+		sum3 = _mm256_srai_epi32(_mm256_add_epi32(sum3, round), RESAMPLE_PRECISION);
+		// packing is per lane too, which puts the columns back in order
+		__m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(sum0, sum1), _mm256_packs_epi32(sum2, sum3));
+		_mm256_storeu_si256((__m256i*) (dst + i), packed);
+	}
+	if (i < bytes) {
+		verticalSSE4(src + i, stride, weights, count, dst + i, bytes - i);
+	}
+}
+
+static bool supportsSSE4(void) {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse4.1");
+}
+
+static bool supportsAVX2(void) {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+#ifdef IMAGE_RESAMPLE_NEON
+
+// neon kernels
+
+static void horizontalRGBANEON(const unsigned char* src, unsigned char* dst, uint32_t dst_width,
+															 const ResampleWeights* weights) {
+
+	for (uint32_t x = 0; x < dst_width; x++) {
+		const unsigned char* p = src + (size_t) weights->first[x] * 4;
+		const int16_t* k = &weights->weights[(size_t) x * weights->taps];
+		uint32_t count = weights->count[x];
+		int32x4_t sum = vdupq_n_s32(0);
+		uint32_t t = 0;
+		for (; t + 1 < count; t += 2) {
+			int16x8_t pixels = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(p + t * 4)));
+			sum = vmlal_n_s16(sum, vget_low_s16(pixels), k[t]);
+			sum = vmlal_n_s16(sum, vget_high_s16(pixels), k[t + 1]);
+		}
+		if (t < count) {
+			uint32_t last;
+			memcpy(&last, p + t * 4, 4);
+			int16x8_t pixels = vreinterpretq_s16_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(last))));
+			sum = vmlal_n_s16(sum, vget_low_s16(pixels), k[t]);
+		}
+		sum = vshrq_n_s32(vaddq_s32(sum, vdupq_n_s32(RESAMPLE_ROUND)), RESAMPLE_PRECISION);
+		uint16x4_t narrow = vqmovun_s32(sum);
+		uint8x8_t packed = vqmovn_u16(vcombine_u16(narrow, narrow));
+		uint32_t pixel = vget_lane_u32(vreinterpret_u32_u8(packed), 0);
+		memcpy(dst + (size_t) x * 4, &pixel, 4);
+	}
+}
+
+static inline uint8x8_t packNEON(int32x4_t lo, int32x4_t hi) {
+	const int32x4_t round = vdupq_n_s32(RESAMPLE_ROUND);
+	lo = vshrq_n_s32(vaddq_s32(lo, round), RESAMPLE_PRECISION);
+	hi = vshrq_n_s32(vaddq_s32(hi, round), RESAMPLE_PRECISION);
+	return vqmovn_u16(vcombine_u16(vqmovun_s32(lo), vqmovun_s32(hi)));
+}
+
+static void verticalNEON(const unsigned char* src, size_t stride, const int16_t* weights, uint32_t count,
+												 unsigned char* dst, size_t bytes) {
+
+	size_t i = 0;
+	for (; i + 16 <= bytes; i += 16) {
+		int32x4_t sum0 = vdupq_n_s32(0);
+		int32x4_t sum1 = vdupq_n_s32(0);
+		int32x4_t sum2 = vdupq_n_s32(0);
+		int32x4_t sum3 = vdupq_n_s32(0);
+		for (uint32_t t = 0; t < count; t++) {
+			uint8x16_t row = vld1q_u8(src + t * stride + i);
+			int16x8_t lo = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(row)));
+			int16x8_t hi = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(row)));
+			sum0 = vmlal_n_s16(sum0, vget_low_s16(lo), weights[t]);
+			sum1 = vmlal_n_s16(sum1, vget_high_s16(lo), weights[t]);
+			sum2 = vmlal_n_s16(sum2, vget_low_s16(hi), weights[t]);
+			sum3 = vmlal_n_s16(sum3, vget_high_s16(hi), weights[t]);
+		}
+		vst1q_u8(dst + i, vcombine_u8(packNEON(sum0, sum1), packNEON(sum2, sum3)));
+	}
+	if (i < bytes) {
+		verticalC(src + i, stride, weights, count, dst + i, bytes - i);
+	}
+}
+
+#endif
+
+// dispatch
+
+static bool supportsC(void) {
+	return true;
+}
+
+typedef struct {
+	const char* name;
+	bool (*supported)(void);
+	void (*horizontal)(const unsigned char* src, unsigned char* dst, uint32_t dst_width,
+										 const ResampleWeights* weights);
+	void (*vertical)(const unsigned char* src, size_t stride, const int16_t* weights, uint32_t count,
+									 unsigned char* dst, size_t bytes);
+} ResampleKernels;
+
+// best first
+static const ResampleKernels resampleKernels[] = {
+#ifdef IMAGE_RESAMPLE_X86
+	{ "avx2", supportsAVX2, horizontalRGBAAVX2, verticalAVX2 },
+	{ "sse4.1", supportsSSE4, horizontalRGBASSE4, verticalSSE4 },
+#endif
+#ifdef IMAGE_RESAMPLE_NEON
+	{ "neon", supportsC, horizontalRGBANEON, verticalNEON },
+#endif
+	{ "c", supportsC, horizontalRGBAC, verticalC },
+};
+
+static std::atomic<const ResampleKernels*> selectedKernels(NULL);
+
+static const ResampleKernels* currentKernels(void) {
+	const ResampleKernels* kernels = selectedKernels.load(std::memory_order_acquire);
+	if (kernels == NULL) {
+		for (size_t i = 0; i < sizeof(resampleKernels) / sizeof(resampleKernels[0]); i++) {
+			if (resampleKernels[i].supported()) {
+				kernels = &resampleKernels[i];
+				break;
+			}
+		}
+		selectedKernels.store(kernels, std::memory_order_release);
+	}
+	return kernels;
+}
+
+const char* imageResampleKernels(void) {
+	return currentKernels()->name;
+}
+
+bool imageResampleUseKernels(const char* name) {
+	if (name == NULL) {
+		return false;
+	}
+	for (size_t i = 0; i < sizeof(resampleKernels) / sizeof(resampleKernels[0]); i++) {
+		if (strcmp(resampleKernels[i].name, name) == 0 && resampleKernels[i].supported()) {
+			selectedKernels.store(&resampleKernels[i], std::memory_order_release);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool imageResample(const unsigned char* src, uint32_t src_width, uint32_t src_height, size_t src_stride,
+									 unsigned char* dst, uint32_t dst_width, uint32_t dst_height, size_t dst_stride,
+									 int channels, ImageResampleFilter filter) {
+
+	if (src == NULL || dst == NULL || src_width == 0 || src_height == 0 || dst_width == 0 || dst_height == 0) {
+		return false;
+	}
+	if (channels != 1 && channels != 3 && channels != 4) {
+		return false;
+	}
+	if (filter != IMAGE_RESAMPLE_BOX && filter != IMAGE_RESAMPLE_BILINEAR && filter != IMAGE_RESAMPLE_LANCZOS3) {
+		return false;
+	}
+	if (src_stride < (size_t) src_width * channels || dst_stride < (size_t) dst_width * channels) {
+		return false;
+	}
+
+	try {
+
+		ResampleWeights xweights, yweights;
+		computeWeights(src_width, dst_width, filter, &xweights);
+		computeWeights(src_height, dst_height, filter, &yweights);
+		const ResampleKernels* kernels = currentKernels();
+
+		// horizontal pass over the source rows the vertical pass reads
+		uint32_t first_row = src_height;
+		uint32_t end_row = 0;
+		for (uint32_t y = 0; y < dst_height; y++) {
+			first_row = min(first_row, yweights.first[y]);
+			end_row = max(end_row, yweights.first[y] + yweights.count[y]);
+		}
+		size_t row_bytes = (size_t) dst_width * channels;
+		std::vector<unsigned char> rows((end_row - first_row) * row_bytes);
+		for (uint32_t y = first_row; y < end_row; y++) {
+			const unsigned char* src_row = src + y * src_stride;
+			unsigned char* row = &rows[(y - first_row) * row_bytes];
+			if (channels == 4) {
+				kernels->horizontal(src_row, row, dst_width, &xweights);
+			} else {
+				horizontalC(src_row, row, dst_width, channels, &xweights);
+			}
+		}
+
+		// vertical pass
+		for (uint32_t y = 0; y < dst_height; y++) {
+			kernels->vertical(&rows[(yweights.first[y] - first_row) * row_bytes], row_bytes,
+												&yweights.weights[(size_t) y * yweights.taps], yweights.count[y],
+												dst + y * dst_stride, row_bytes);
+		}
+
+	} catch (std::bad_alloc&) {
+		return false;
+	}
+
+	// done
+	return true;
+
+}
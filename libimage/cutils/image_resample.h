@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// separable resampling of 8-bit images: each pass uses precomputed
+	// 2.14 fixed-point weights so the result only depends on the inputs,
+	// whatever kernels (AVX2, SSE4.1, NEON or plain C) the cpu gets
+
+	typedef enum {
+		IMAGE_RESAMPLE_BOX = 0,        // area average, the one for thumbnails
+		IMAGE_RESAMPLE_BILINEAR = 1,
+		IMAGE_RESAMPLE_LANCZOS3 = 2,
+	} ImageResampleFilter;
+
+	// pixels are rows of stride bytes of channels samples (1, 3 or 4)
+	// rgba should be premultiplied so colours do not bleed from transparent pixels
+	// returns false on invalid arguments or if memory runs out
+	bool imageResample(const unsigned char* src, uint32_t src_width, uint32_t src_height, size_t src_stride,
+										 unsigned char* dst, uint32_t dst_width, uint32_t dst_height, size_t dst_stride,
+										 int channels, ImageResampleFilter filter);
+
+	// kernels used by imageResample: "avx2", "sse4.1", "neon" or "c"
+	const char* imageResampleKernels(void);
+
+	// forces kernels by name, to compare or benchmark them
+	// returns false (and changes nothing) if the cpu lacks them
+	bool imageResampleUseKernels(const char* name);
+
+#ifdef __cplusplus
+}
+#endif
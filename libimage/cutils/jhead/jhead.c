@@ -15,6 +15,12 @@
 
 #include <sys/stat.h>
 
+#ifndef _WIN32
+    #include <stdbool.h>
+    #include "../jpeg_utils.h"
+    #include "../thumbnail_utils.h"
+#endif
+
 #define JHEAD_VERSION "2.96"
 
 // This #define turns on features that are too very specific to 
@@ -31,79 +37,87 @@
 #define JPEGS_ONLY  4
 #define MODIFY_JPEG 5
 #define READ_JPEG   6
-static int DoModify     = FALSE;
-
-
-static int FilesMatched;
-static int FileSequence;
 
+// Kept global: ErrFatal and ErrNonfatal are called by the parser with
+// no way to pass a context.
 static const char * CurrentFile;
 
 static const char * progname;   // program name for error messages
 
+static int SupressNonFatalErrors = FALSE; // Wether or not to pint warnings on recoverable errors
+
+       int ShowTags     = FALSE;    // Do not show raw by default.
+       int DumpExifMap  = FALSE;
+
 //--------------------------------------------------------------------------
-// Command line options flags
-static int TrimExif = FALSE;        // Cut off exif beyond interesting data.
-static int RenameToDate = 0;        // 1=rename, 2=rename all.
+// Command line options and per run counters, passed to the functions
+// that process files instead of living in file scope statics.
+//--------------------------------------------------------------------------
+typedef struct {
+    int DoModify;
+
+    int FilesMatched;
+    int FileSequence;
+
+    int TrimExif;                   // Cut off exif beyond interesting data.
+    int RenameToDate;               // 1=rename, 2=rename all.
 #ifdef _WIN32
-static int RenameAssociatedFiles = FALSE;
+    int RenameAssociatedFiles;
 #endif
-static char * strftime_args = NULL; // Format for new file name.
-static int Exif2FileTime  = FALSE;
-       int ShowTags     = FALSE;    // Do not show raw by default.
-static int Quiet        = FALSE;    // Be quiet on success (like unix programs)
-       int DumpExifMap  = FALSE;
-static int ShowConcise  = FALSE;
-static int CreateExifSection = FALSE;
-static char * ApplyCommand = NULL;  // Apply this command to all images.
-static char * FilterModel = NULL;
-static int    ExifOnly    = FALSE;
-static int    PortraitOnly = FALSE;
-static time_t ExifTimeAdjust = 0;   // Timezone adjust
-static time_t ExifTimeSet = 0;      // Set exif time to a value.
-static char DateSet[11];
-static unsigned DateSetChars = 0;
-static unsigned FileTimeToExif = FALSE;
-
-static int DeleteComments = FALSE;
-static int DeleteExif = FALSE;
-static int DeleteIptc = FALSE;
-static int DeleteXmp = FALSE;
-static int DeleteUnknown = FALSE;
-static char * ThumbSaveName = NULL; // If not NULL, use this string to make up
+    char * strftime_args;           // Format for new file name.
+    int Exif2FileTime;
+    int Quiet;                      // Be quiet on success (like unix programs)
+    int ShowConcise;
+    int CreateExifSection;
+    char * ApplyCommand;            // Apply this command to all images.
+    char * FilterModel;
+    int    ExifOnly;
+    int    PortraitOnly;
+    time_t ExifTimeAdjust;          // Timezone adjust
+    time_t ExifTimeSet;             // Set exif time to a value.
+    char DateSet[11];
+    unsigned DateSetChars;
+    unsigned FileTimeToExif;
+
+    int DeleteComments;
+    int DeleteExif;
+    int DeleteIptc;
+    int DeleteXmp;
+    int DeleteUnknown;
+    char * ThumbSaveName;           // If not NULL, use this string to make up
                                     // the filename to store the thumbnail to.
 
-static char * ThumbInsertName = NULL; // If not NULL, use this string to make up
+    char * ThumbInsertName;         // If not NULL, use this string to make up
                                     // the filename to retrieve the thumbnail from.
 
-static int RegenThumbnail = FALSE;
+    int RegenThumbnail;
 
-static char * ExifXferScrFile = NULL;// Extract Exif header from this file, and
+    char * ExifXferScrFile;         // Extract Exif header from this file, and
                                     // put it into the Jpegs processed.
 
-static int EditComment = FALSE;     // Invoke an editor for editing the comment
-static int SupressNonFatalErrors = FALSE; // Wether or not to pint warnings on recoverable errors
+    int EditComment;                // Invoke an editor for editing the comment
 
-static char * CommentSavefileName = NULL; // Save comment to this file.
-static char * CommentInsertfileName = NULL; // Insert comment from this file.
-static char * CommentInsertLiteral = NULL;  // Insert this comment (from command line)
+    char * CommentSavefileName;     // Save comment to this file.
+    char * CommentInsertfileName;   // Insert comment from this file.
+    char * CommentInsertLiteral;    // Insert this comment (from command line)
 
-static int AutoRotate = FALSE;
-static int ZeroRotateTagOnly = FALSE;
+    int AutoRotate;
+    int ZeroRotateTagOnly;
 
-static int ShowFileInfo = TRUE;     // Indicates to show standard file info
+    int ShowFileInfo;               // Indicates to show standard file info
                                     // (file name, file size, file date)
 
-
 #ifdef MATTHIAS
     // This #ifdef to take out less than elegant stuff for editing
     // the comments in a JPEG.  The programs rdjpgcom and wrjpgcom
     // included with Linux distributions do a better job.
 
-    static char * AddComment = NULL; // Add this tag.
-    static char * RemComment = NULL; // Remove this tag
-    static int AutoResize = FALSE;
+    char * AddComment;              // Add this tag.
+    char * RemComment;              // Remove this tag
+    int AutoResize;
+    char AutoResizeCommand[PATH_MAX+1];
 #endif // MATTHIAS
+} JheadContext_t;
 
 //--------------------------------------------------------------------------
 // Error exit handler
@@ -195,7 +209,7 @@ static char KnownTags[][10] = {"date", "desc","scan_date","author",
                                "keyword","videograb",
                                "show_raw","panorama","titlepix",""};
 
-static int ModifyDescriptComment(char * OutComment, char * SrcComment)
+static int ModifyDescriptComment(JheadContext_t * Context, char * OutComment, char * SrcComment)
 {
     char Line[500];
     int Len;
@@ -229,19 +243,19 @@ static int ModifyDescriptComment(char * OutComment, char * SrcComment)
                             if (Line[l] == ' ') Line[l] = '='; // Use equal sign for clarity.
                             if (a == 2) break; // Delete 'orig_path' tag.
                             if (a == 3) HasScandate = TRUE;
-                            if (RemComment){
-                                if (strlen(RemComment) == l){
-                                    if (!memcmp(Line, RemComment, l)){
+                            if (Context->RemComment){
+                                if (strlen(Context->RemComment) == l){
+                                    if (!memcmp(Line, Context->RemComment, l)){
                                         Modified = TRUE;
                                         break;
                                     }
                                 }
                             }
-                            if (AddComment){
+                            if (Context->AddComment){
                                 // Overwrite old comment of same tag with new one.
-                                if (!memcmp(Line, AddComment, l+1)){
+                                if (!memcmp(Line, Context->AddComment, l+1)){
                                     TagExists = TRUE;
-                                    strncpy(Line, AddComment, sizeof(Line));
+                                    strncpy(Line, Context->AddComment, sizeof(Line));
                                     Modified = TRUE;
                                 }
                             }
@@ -259,8 +273,8 @@ static int ModifyDescriptComment(char * OutComment, char * SrcComment)
         }
     }
 
-    if (AddComment && TagExists == FALSE){
-        strncat(OutComment, AddComment, MAX_COMMENT_SIZE-5-strlen(OutComment));
+    if (Context->AddComment && TagExists == FALSE){
+        strncat(OutComment, Context->AddComment, MAX_COMMENT_SIZE-5-strlen(OutComment));
         strcat(OutComment, "\n");
         Modified = TRUE;
     }
@@ -277,12 +291,11 @@ static int ModifyDescriptComment(char * OutComment, char * SrcComment)
 //--------------------------------------------------------------------------
 // Automatic make smaller command stuff
 //--------------------------------------------------------------------------
-static int AutoResizeCmdStuff(void)
+static int AutoResizeCmdStuff(JheadContext_t * Context)
 {
-    static char CommandString[PATH_MAX+1];
     double scale;
 
-    ApplyCommand = CommandString;
+    Context->ApplyCommand = Context->AutoResizeCommand;
 
     if (ImageInfo.Height <= 1280 && ImageInfo.Width <= 1280){
         printf("not resizing %dx%x '%s'\n",ImageInfo.Height, ImageInfo.Width, ImageInfo.FileName);
@@ -294,7 +307,7 @@ static int AutoResizeCmdStuff(void)
 
     if (scale < 0.5) scale = 0.5; // Don't scale down by more than a factor of two.
 
-    sprintf(CommandString, "mogrify -geometry %dx%d -quality 85 &i",(int)(ImageInfo.Width*scale), (int)(ImageInfo.Height*scale));
+    sprintf(Context->AutoResizeCommand, "mogrify -geometry %dx%d -quality 85 &i",(int)(ImageInfo.Width*scale), (int)(ImageInfo.Height*scale));
     return TRUE;
 }
 
@@ -343,7 +356,7 @@ static int shellescape(char* to, const char* from)
 //--------------------------------------------------------------------------
 // Apply the specified command to the JPEG file.
 //--------------------------------------------------------------------------
-static void DoCommand(const char * FileName, int ShowIt)
+static void DoCommand(const char * Command, const char * FileName, int ShowIt)
 {
     int a,e;
     char ExecString[PATH_MAX*3];
@@ -375,14 +388,14 @@ static void DoCommand(const char * FileName, int ShowIt)
 
     // Build the exec string.  &i and &o in the exec string get replaced by input and output files.
     for (a=0;;a++){
-        if (ApplyCommand[a] == '&'){
-            if (ApplyCommand[a+1] == 'i'){
+        if (Command[a] == '&'){
+            if (Command[a+1] == 'i'){
                 // Input file.
                 e += shellescape(ExecString+e, FileName);
                 a += 1;
                 continue;
             }
-            if (ApplyCommand[a+1] == 'o'){
+            if (Command[a+1] == 'o'){
                 // Needs an output file distinct from the input file.
                 e += shellescape(ExecString+e, TempName);
                 a += 1;
@@ -390,8 +403,8 @@ static void DoCommand(const char * FileName, int ShowIt)
                 continue;
             }
         }
-        ExecString[e++] = ApplyCommand[a];
-        if (ApplyCommand[a] == 0) break;
+        ExecString[e++] = Command[a];
+        if (Command[a] == 0) break;
     }
 
     if (ShowIt) printf("Cmd:%s\n",ExecString);
@@ -420,33 +433,33 @@ static void DoCommand(const char * FileName, int ShowIt)
 //--------------------------------------------------------------------------
 // check if this file should be skipped based on contents.
 //--------------------------------------------------------------------------
-static int CheckFileSkip(void)
+static int CheckFileSkip(JheadContext_t * Context)
 {
     // I sometimes add code here to only process images based on certain
     // criteria - for example, only to convert non progressive Jpegs to progressives, etc..
 
-    if (FilterModel){
+    if (Context->FilterModel){
         // Filtering processing by camera model.
         // This feature is useful when pictures from multiple cameras are colated, 
         // the its found that one of the cameras has the time set incorrectly.
-        if (strstr(ImageInfo.CameraModel, FilterModel) == NULL){
+        if (strstr(ImageInfo.CameraModel, Context->FilterModel) == NULL){
             // Skip.
             return TRUE;
         }
     }
 
-    if (ExifOnly){
+    if (Context->ExifOnly){
         // Filtering by EXIF only.  Skip all files that have no Exif.
         if (FindSection(M_EXIF) == NULL){
             return TRUE;
         }
     }
 
-    if (PortraitOnly == 1){
+    if (Context->PortraitOnly == 1){
         if (ImageInfo.Width > ImageInfo.Height) return TRUE;
     }
 
-    if (PortraitOnly == -1){
+    if (Context->PortraitOnly == -1){
         if (ImageInfo.Width < ImageInfo.Height) return TRUE;
     }
 
@@ -479,7 +492,7 @@ static void RelativeName(char * OutFileName, const char * NamePattern, const cha
 //--------------------------------------------------------------------------
 // Rename associated files
 //--------------------------------------------------------------------------
-void RenameAssociated(const char * FileName, char * NewBaseName)
+void RenameAssociated(JheadContext_t * Context, const char * FileName, char * NewBaseName)
 {
     int a;
     int PathLen;
@@ -520,7 +533,7 @@ void RenameAssociated(const char * FileName, char * NewBaseName)
         strncat(NewName, finddata.name+a, _MAX_PATH-strlen(NewName)); // add extension to new name
 
         if (rename(FilePattern, NewName) == 0){
-            if (!Quiet){
+            if (!Context->Quiet){
                 printf("%s --> %s\n",FilePattern, NewName);
             }
         }
@@ -535,7 +548,7 @@ void RenameAssociated(const char * FileName, char * NewBaseName)
 //--------------------------------------------------------------------------
 // Handle renaming of files by date.
 //--------------------------------------------------------------------------
-static void DoFileRenaming(const char * FileName)
+static void DoFileRenaming(JheadContext_t * Context, const char * FileName)
 {
     int NumAlpha = 0;
     int NumDigit = 0;
@@ -571,7 +584,7 @@ static void DoFileRenaming(const char * FileName)
 
     strncpy(NewBaseName, FileName, PATH_MAX); // Get path component of name.
 
-    if (strftime_args){
+    if (Context->strftime_args){
         // Complicated scheme for flexibility.  Just pass the args to strftime.
         time_t UnixTime;
 
@@ -588,7 +601,7 @@ static void DoFileRenaming(const char * FileName)
 
         // Substitute "%f" for the original name (minus path & extension)
         pattern[PATH_MAX-1]=0;
-        strncpy(pattern, strftime_args, PATH_MAX-1);
+        strncpy(pattern, Context->strftime_args, PATH_MAX-1);
         while ((s = strstr(pattern, "%f")) && strlen(pattern) + n < PATH_MAX-1){
             memmove(s + n, s + 2, strlen(s+2) + 1);
             memmove(s, FileName + PrefixPart, n);
@@ -609,7 +622,7 @@ static void DoFileRenaming(const char * FileName)
                         memcpy(pat, pattern+ppos, 4);
                         pat[a-ppos] = 'd'; // Replace 'i' with 'd' for '%d'
                         pat[a-ppos+1] = '\0';
-                        sprintf(num, pat, FileSequence); // let printf do the number formatting.
+                        sprintf(num, pat, Context->FileSequence); // let printf do the number formatting.
                         nl = strlen(num);
                         l = strlen(pattern+a+1);
                         if (ppos+nl+l+1 >= PATH_MAX) ErrFatal("str overflow");
@@ -668,9 +681,9 @@ static void DoFileRenaming(const char * FileName)
             if (rename(FileName, NewName) == 0){
                 printf("%s --> %s\n",FileName, NewName);
 #ifdef _WIN32
-                if (RenameAssociatedFiles){
+                if (Context->RenameAssociatedFiles){
                     sprintf(NewName, "%s%s", NewBaseName, NameExtra);
-                    RenameAssociated(FileName, NewName);
+                    RenameAssociated(Context, FileName, NewName);
                 }
 #endif
             }else{
@@ -687,25 +700,145 @@ static void DoFileRenaming(const char * FileName)
     }
 }
 
+#ifndef _WIN32
+//--------------------------------------------------------------------------
+// Put a thumbnail held in memory into the exif header.
+// Same as ReplaceThumbnail, without going through a file.
+//--------------------------------------------------------------------------
+static int ReplaceThumbnailData(const uchar * ThumbData, unsigned ThumbLen)
+{
+    Section_t * ExifSection;
+    unsigned NewExifSize;
+    uchar * NewData;
+
+    if (ImageInfo.ThumbnailOffset == 0 || ImageInfo.ThumbnailAtEnd == FALSE){
+        // Adding or removing of thumbnail is not possible - that would require rearranging
+        // of the exif header, which is risky, and jhad doesn't know how to do.
+        return FALSE;
+    }
+
+    ExifSection = FindSection(M_EXIF);
+    if (ExifSection == NULL || ImageInfo.ThumbnailSizeOffset == 0){
+        return FALSE;
+    }
+
+    NewExifSize = ImageInfo.ThumbnailOffset+8+ThumbLen;
+    if (NewExifSize > 65535){
+        ErrNonfatal("Thumbnail is too large to insert into exif header", 0, 0);
+        return FALSE;
+    }
+
+    NewData = (uchar *)realloc(ExifSection->Data, NewExifSize);
+    if (NewData == NULL){
+        ErrNonfatal("Could not allocate memory for thumbnail", 0, 0);
+        return FALSE;
+    }
+    ExifSection->Data = NewData;
+    memcpy(ExifSection->Data+ImageInfo.ThumbnailOffset+8, ThumbData, ThumbLen);
+
+    ImageInfo.ThumbnailSize = ThumbLen;
+    Put32u(ExifSection->Data+ImageInfo.ThumbnailSizeOffset+8, ThumbLen);
+
+    ExifSection->Data[0] = (uchar)(NewExifSize >> 8);
+    ExifSection->Data[1] = (uchar)NewExifSize;
+    ExifSection->Size = NewExifSize;
+
+    return TRUE;
+}
+
 //--------------------------------------------------------------------------
 // Rotate the image and its thumbnail
+// Done in process with cutils lossless transforms (used to call jpegtran)
 //--------------------------------------------------------------------------
-static int DoAutoRotate(const char * FileName)
+static int DoAutoRotate(JheadContext_t * Context, const char * FileName)
 {
     if (ImageInfo.Orientation >= 2 && ImageInfo.Orientation <= 8){
         const char * Argument;
+        JXFORM_CODE Transform;
+
+        Transform = exifOrientToJpegTransform((unsigned char)ImageInfo.Orientation);
         Argument = ClearOrientation();
 
-        if (!ZeroRotateTagOnly){
+        if (!Context->ZeroRotateTagOnly){
+            if (Argument == NULL || Transform == JXFORM_NONE){
+                ErrFatal("Orientation screwup");
+            }
+
+            // Partial edge blocks get trimmed, like jpegtran -trim
+            if (!jpegTransformFile(FileName, Transform, NULL)){
+                ErrFatal("Lossless rotation failed");
+            }
+
+            // Now rotate the thumbnail, if there is one.
+            if (ImageInfo.ThumbnailOffset && 
+                ImageInfo.ThumbnailSize && 
+                ImageInfo.ThumbnailAtEnd){
+                // Must have a thumbnail that exists and is modifieable.
+                Section_t * ExifSection;
+                uchar * ThumbData = NULL;
+                unsigned long ThumbLen = 0;
+
+                ExifSection = FindSection(M_EXIF);
+                if (ExifSection && jpegTransformBuffer(ExifSection->Data+ImageInfo.ThumbnailOffset+8,
+                        ImageInfo.ThumbnailSize, Transform, NULL, &ThumbData, &ThumbLen)){
+                    // Put the thumbnail back in the header
+                    ReplaceThumbnailData(ThumbData, (unsigned)ThumbLen);
+                    free(ThumbData);
+                }
+            }
+        }
+        return TRUE;
+    }
+    return FALSE;
+}
+
+//--------------------------------------------------------------------------
+// Regenerate the thumbnail from a scaled decode of the image
+// Done in process with cutils (used to call mogrify)
+//--------------------------------------------------------------------------
+static int RegenerateThumbnail(JheadContext_t * Context, const char * FileName)
+{
+    uchar * ThumbData = NULL;
+    unsigned long ThumbLen = 0;
+    int Result;
+
+    if (ImageInfo.ThumbnailOffset == 0 || ImageInfo.ThumbnailAtEnd == FALSE){
+        // There is no thumbnail, or the thumbnail is not at the end.
+        return FALSE;
+    }
+
+    if (!jpegThumbnail(FileName, Context->RegenThumbnail, 80, &ThumbData, &ThumbLen)){
+        ErrFatal("Unable to generate thumbnail");
+        return FALSE;
+    }
+
+    // Put the thumbnail back in the header
+    Result = ReplaceThumbnailData(ThumbData, (unsigned)ThumbLen);
+    free(ThumbData);
+    return Result;
+}
+
+#else // _WIN32
+// cutils is POSIX only: the Windows build still relies on jpegtran and
+// mogrify being on the path.
+
+//--------------------------------------------------------------------------
+// Rotate the image and its thumbnail with jpegtran
+//--------------------------------------------------------------------------
+static int DoAutoRotate(JheadContext_t * Context, const char * FileName)
+{
+    if (ImageInfo.Orientation >= 2 && ImageInfo.Orientation <= 8){
+        const char * Argument;
+        Argument = ClearOrientation();
+
+        if (!Context->ZeroRotateTagOnly){
             char RotateCommand[PATH_MAX*2+50];
             if (Argument == NULL){
                 ErrFatal("Orientation screwup");
             }
 
             sprintf(RotateCommand, "jpegtran -trim -%s -outfile &o &i", Argument);
-            ApplyCommand = RotateCommand;
-            DoCommand(FileName, FALSE);
-            ApplyCommand = NULL;
+            DoCommand(RotateCommand, FileName, FALSE);
 
             // Now rotate the thumbnail, if there is one.
             if (ImageInfo.ThumbnailOffset && 
@@ -741,7 +874,7 @@ static int DoAutoRotate(const char * FileName)
 //--------------------------------------------------------------------------
 // Regenerate the thumbnail using mogrify
 //--------------------------------------------------------------------------
-static int RegenerateThumbnail(const char * FileName)
+static int RegenerateThumbnail(JheadContext_t * Context, const char * FileName)
 {
     char ThumbnailGenCommand[PATH_MAX*2+50];
     if (ImageInfo.ThumbnailOffset == 0 || ImageInfo.ThumbnailAtEnd == FALSE){
@@ -750,7 +883,7 @@ static int RegenerateThumbnail(const char * FileName)
     }
 
     sprintf(ThumbnailGenCommand, "mogrify -thumbnail %dx%d \"%s\"", 
-        RegenThumbnail, RegenThumbnail, FileName);
+        Context->RegenThumbnail, Context->RegenThumbnail, FileName);
 
     if (system(ThumbnailGenCommand) == 0){
         // Put the thumbnail back in the header
@@ -761,6 +894,8 @@ static int RegenerateThumbnail(const char * FileName)
     }
 }
 
+#endif // _WIN32
+
 //--------------------------------------------------------------------------
 // Set file time as exif time.
 //--------------------------------------------------------------------------
@@ -774,7 +909,7 @@ void FileTimeAsString(char * TimeStr)
 //--------------------------------------------------------------------------
 // Do selected operations to one file at a time.
 //--------------------------------------------------------------------------
-void ProcessFile(const char * FileName)
+void ProcessFile(JheadContext_t * Context, const char * FileName)
 {
     int Modified = FALSE;
     ReadMode_t ReadMode;
@@ -786,7 +921,7 @@ void ProcessFile(const char * FileName)
 
     ReadMode = READ_METADATA;
     CurrentFile = FileName;
-    FilesMatched = 1; 
+    Context->FilesMatched = 1; 
 
     ResetJpgfile();
 
@@ -807,7 +942,7 @@ void ProcessFile(const char * FileName)
         }
     }
 
-    if ((DoModify & MODIFY_ANY) || RenameToDate || Exif2FileTime){
+    if ((Context->DoModify & MODIFY_ANY) || Context->RenameToDate || Context->Exif2FileTime){
         if (access(FileName, 2 /*W_OK*/)){
             printf("Skipping readonly file '%s'\n",FileName);
             return;
@@ -817,16 +952,16 @@ void ProcessFile(const char * FileName)
     strncpy(ImageInfo.FileName, FileName, PATH_MAX);
 
 
-    if (ApplyCommand || AutoRotate){
+    if (Context->ApplyCommand || Context->AutoRotate){
         // Applying a command is special - the headers from the file have to be
         // pre-read, then the command executed, and then the image part of the file read.
 
         if (!ReadJpegFile(FileName, READ_METADATA)) return;
 
         #ifdef MATTHIAS
-            if (AutoResize){
+            if (Context->AutoResize){
                 // Automatic resize computation - to customize for each run...
-                if (AutoResizeCmdStuff() == 0){
+                if (AutoResizeCmdStuff(Context) == 0){
                     DiscardData();
                     return;
                 }
@@ -834,20 +969,20 @@ void ProcessFile(const char * FileName)
         #endif // MATTHIAS
 
 
-        if (CheckFileSkip()){
+        if (CheckFileSkip(Context)){
             DiscardData();
             return;
         }
 
         DiscardAllButExif();
 
-        if (AutoRotate){
-            if (DoAutoRotate(FileName)){
+        if (Context->AutoRotate){
+            if (DoAutoRotate(Context, FileName)){
                 Modified = TRUE;
             }
         }else{
             struct stat dummy;
-            DoCommand(FileName, Quiet ? FALSE : TRUE);
+            DoCommand(Context->ApplyCommand, FileName, Context->Quiet ? FALSE : TRUE);
 
             if (stat(FileName, &dummy)){
                 // The file is not there anymore. Perhaps the command
@@ -858,11 +993,11 @@ void ProcessFile(const char * FileName)
         }
         ReadMode = READ_IMAGE;   // Don't re-read exif section again on next read.
 
-    }else if (ExifXferScrFile){
+    }else if (Context->ExifXferScrFile){
         char RelativeExifName[PATH_MAX+1];
 
         // Make a relative name.
-        RelativeName(RelativeExifName, ExifXferScrFile, FileName);
+        RelativeName(RelativeExifName, Context->ExifXferScrFile, FileName);
 
         if(!ReadJpegFile(RelativeExifName, READ_METADATA)) return;
 
@@ -872,24 +1007,24 @@ void ProcessFile(const char * FileName)
         ReadMode = READ_IMAGE;
     }
 
-    if (DoModify){
+    if (Context->DoModify){
         ReadMode |= READ_IMAGE;
     }
 
     if (!ReadJpegFile(FileName, ReadMode)) return;
 
-    if (CheckFileSkip()){
+    if (CheckFileSkip(Context)){
         DiscardData();
         return;
     }
 
-    FileSequence += 1; // Count files processed.
+    Context->FileSequence += 1; // Count files processed.
 
-    if (ShowConcise){
+    if (Context->ShowConcise){
         ShowConciseImageInfo();
     }else{
-        if (!(DoModify) || ShowTags){
-            ShowImageInfo(ShowFileInfo);
+        if (!(Context->DoModify) || ShowTags){
+            ShowImageInfo(Context->ShowFileInfo);
 
             {
                 // if IPTC section is present, show it also.
@@ -904,37 +1039,37 @@ void ProcessFile(const char * FileName)
         }
     }
 
-    if (ThumbSaveName){
+    if (Context->ThumbSaveName){
         char OutFileName[PATH_MAX+1];
         // Make a relative name.
-        RelativeName(OutFileName, ThumbSaveName, FileName);
+        RelativeName(OutFileName, Context->ThumbSaveName, FileName);
 
         if (SaveThumbnail(OutFileName)){
             printf("Created: '%s'\n", OutFileName);
         }
     }
 
-    if (CreateExifSection){
+    if (Context->CreateExifSection){
         // Make a new minimal exif section
         create_EXIF();
         Modified = TRUE;
     }
 
-    if (RegenThumbnail){
-        if (RegenerateThumbnail(FileName)){
+    if (Context->RegenThumbnail){
+        if (RegenerateThumbnail(Context, FileName)){
             Modified = TRUE;
         }
     }
 
-    if (ThumbInsertName){
+    if (Context->ThumbInsertName){
         char ThumbFileName[PATH_MAX+1];
         // Make a relative name.
-        RelativeName(ThumbFileName, ThumbInsertName, FileName);
+        RelativeName(ThumbFileName, Context->ThumbInsertName, FileName);
 
         if (ReplaceThumbnail(ThumbFileName)){
             Modified = TRUE;
         }
-    }else if (TrimExif){
+    }else if (Context->TrimExif){
         // Deleting thumbnail is just replacing it with a null thumbnail.
         if (ReplaceThumbnail(NULL)){
             Modified = TRUE;
@@ -943,9 +1078,9 @@ void ProcessFile(const char * FileName)
 
     if (
 #ifdef MATTHIAS
-        AddComment || RemComment ||
+        Context->AddComment || Context->RemComment ||
 #endif
-                   EditComment || CommentInsertfileName || CommentInsertLiteral){
+                   Context->EditComment || Context->CommentInsertfileName || Context->CommentInsertLiteral){
 
         Section_t * CommentSec;
         char Comment[MAX_COMMENT_SIZE+1];
@@ -969,13 +1104,13 @@ void ProcessFile(const char * FileName)
             CommentSize = MAX_COMMENT_SIZE;
         }
 
-        if (CommentInsertfileName){
+        if (Context->CommentInsertfileName){
             // Read a new comment section from file.
             char CommentFileName[PATH_MAX+1];
             FILE * CommentFile;
 
             // Make a relative name.
-            RelativeName(CommentFileName, CommentInsertfileName, FileName);
+            RelativeName(CommentFileName, Context->CommentInsertfileName, FileName);
 
             CommentFile = fopen(CommentFileName,"r");
             if (CommentFile == NULL){
@@ -987,19 +1122,19 @@ void ProcessFile(const char * FileName)
                 fclose(CommentFile);
                 if (CommentSize < 0) CommentSize = 0;
             }
-        }else if (CommentInsertLiteral){
-            strncpy(Comment, CommentInsertLiteral, MAX_COMMENT_SIZE);
+        }else if (Context->CommentInsertLiteral){
+            strncpy(Comment, Context->CommentInsertLiteral, MAX_COMMENT_SIZE);
             CommentSize = strlen(Comment);
         }else{
 #ifdef MATTHIAS
             char CommentZt[MAX_COMMENT_SIZE+1];
             memcpy(CommentZt, (char *)CommentSec->Data+2, CommentSize);
             CommentZt[CommentSize] = '\0';
-            if (ModifyDescriptComment(Comment, CommentZt)){
+            if (ModifyDescriptComment(Context, Comment, CommentZt)){
                 Modified = TRUE;
                 CommentSize = strlen(Comment);
             }
-            if (EditComment)
+            if (Context->EditComment)
 #else
             memcpy(Comment, (char *)CommentSec->Data+2, CommentSize);
 #endif
@@ -1030,7 +1165,7 @@ void ProcessFile(const char * FileName)
     }
 
 
-    if (CommentSavefileName){
+    if (Context->CommentSavefileName){
         Section_t * CommentSec;
         CommentSec = FindSection(M_COM);
 
@@ -1039,7 +1174,7 @@ void ProcessFile(const char * FileName)
             FILE * CommentFile;
 
             // Make a relative name.
-            RelativeName(OutFileName, CommentSavefileName, FileName);
+            RelativeName(OutFileName, Context->CommentSavefileName, FileName);
 
             CommentFile = fopen(OutFileName,"w");
 
@@ -1054,24 +1189,24 @@ void ProcessFile(const char * FileName)
         }
     }
 
-    if (ExifTimeAdjust || ExifTimeSet || DateSetChars || FileTimeToExif){
+    if (Context->ExifTimeAdjust || Context->ExifTimeSet || Context->DateSetChars || Context->FileTimeToExif){
        if (ImageInfo.numDateTimeTags){
             struct tm tm;
             time_t UnixTime;
             char TempBuf[50];
             int a;
             Section_t * ExifSection;
-            if (ExifTimeSet){
+            if (Context->ExifTimeSet){
                 // A time to set was specified.
-                UnixTime = ExifTimeSet;
+                UnixTime = Context->ExifTimeSet;
             }else{
-                if (FileTimeToExif){
+                if (Context->FileTimeToExif){
                     FileTimeAsString(ImageInfo.DateTime);
                 }
-                if (DateSetChars){
-                    memcpy(ImageInfo.DateTime, DateSet, DateSetChars);
+                if (Context->DateSetChars){
+                    memcpy(ImageInfo.DateTime, Context->DateSet, Context->DateSetChars);
                     a = 1970;
-                    sscanf(DateSet, "%d", &a);
+                    sscanf(Context->DateSet, "%d", &a);
                     if (a < 1970){
                         strcpy(TempBuf, ImageInfo.DateTime);
                         goto skip_unixtime;
@@ -1083,7 +1218,7 @@ void ProcessFile(const char * FileName)
                 // Convert to unix 32 bit time value, add offset, and convert back.
                 UnixTime = mktime(&tm);
                 if ((int)UnixTime == -1) goto badtime;
-                UnixTime += ExifTimeAdjust;
+                UnixTime += Context->ExifTimeAdjust;
             }
             tm = *localtime(&UnixTime);
 
@@ -1109,19 +1244,19 @@ skip_unixtime:
         }
     }
 
-    if (DeleteComments){
+    if (Context->DeleteComments){
         if (RemoveSectionType(M_COM)) Modified = TRUE;
     }
-    if (DeleteExif){
+    if (Context->DeleteExif){
         if (RemoveSectionType(M_EXIF)) Modified = TRUE;
     }
-    if (DeleteIptc){
+    if (Context->DeleteIptc){
         if (RemoveSectionType(M_IPTC)) Modified = TRUE;
     }
-    if (DeleteXmp){
+    if (Context->DeleteXmp){
         if (RemoveSectionType(M_XMP)) Modified = TRUE;
     }
-    if (DeleteUnknown){
+    if (Context->DeleteUnknown){
         if (RemoveUnknownSections()) Modified = TRUE;
     }
 
@@ -1130,7 +1265,7 @@ skip_unixtime:
         char BackupName[PATH_MAX+5];
         struct stat buf;
 
-        if (!Quiet) printf("Modified: %s\n",FileName);
+        if (!Context->Quiet) printf("Modified: %s\n",FileName);
 
         strcpy(BackupName, FileName);
         strcat(BackupName, ".t");
@@ -1161,7 +1296,7 @@ skip_unixtime:
     }
 
 
-    if (Exif2FileTime){
+    if (Context->Exif2FileTime){
         // Set the file date to the date from the exif header.
         if (ImageInfo.numDateTimeTags){
             // Converte the file date to Unix time.
@@ -1179,7 +1314,7 @@ skip_unixtime:
             if (utime(FileName, &mtime) != 0){
                 printf("Error: Could not change time of file '%s'\n",FileName);
             }else{
-                if (!Quiet) printf("%s\n",FileName);
+                if (!Context->Quiet) printf("%s\n",FileName);
             }
         }else{
             printf("File '%s' contains no Exif timestamp\n", FileName);
@@ -1189,8 +1324,8 @@ skip_unixtime:
     // Feature to rename image according to date and time from camera.
     // I use this feature to put images from multiple digicams in sequence.
 
-    if (RenameToDate){
-        DoFileRenaming(FileName);
+    if (Context->RenameToDate){
+        DoFileRenaming(Context, FileName);
     }
     DiscardData();
     return;
@@ -1199,6 +1334,16 @@ badtime:
     DiscardData();
 }
 
+#ifdef _WIN32
+//--------------------------------------------------------------------------
+// Called by MyGlob for each matching file.
+//--------------------------------------------------------------------------
+static void ProcessGlobbedFile(const char * FileName, void * Context)
+{
+    ProcessFile((JheadContext_t *)Context, FileName);
+}
+#endif
+
 //--------------------------------------------------------------------------
 // complain about bad state of the command line.
 //--------------------------------------------------------------------------
@@ -1292,11 +1437,19 @@ static void Usage (void)
            "             already contain a thumbnail.\n"
            "  -rgt[size] Regnerate exif thumbnail.  Only works if image already\n"
            "             contains a thumbail.  size specifies maximum height or width of\n"
+#ifdef _WIN32
            "             thumbnail.  Relies on 'mogrify' programs to be on path\n"
+#else
+           "             thumbnail.\n"
+#endif
 
            "\nROTATION TAG MANIPULATION:\n"
+#ifdef _WIN32
            "  -autorot   Invoke jpegtran to rotate images according to Exif orientation tag\n"
            "             Note: Windows users must get jpegtran for this to work\n"
+#else
+           "  -autorot   Losslessly rotate images according to Exif orientation tag\n"
+#endif
            "  -norot     Zero out the rotation tag.  This to avoid some browsers from\n" 
            "             rotating the image again after you rotated it but neglected to\n"
            "             clear the rotation tag\n"
@@ -1397,6 +1550,11 @@ int main (int argc, char **argv)
 {
     int argn;
     char * arg;
+    JheadContext_t Context;
+
+    memset(&Context, 0, sizeof(Context));
+    Context.ShowFileInfo = TRUE;
+
     progname = argv[0];
 
     for (argn=1;argn<argc;argn++){
@@ -1405,44 +1563,44 @@ int main (int argc, char **argv)
 
     // General metadata options:
         if (!strcmp(arg,"-te")){
-            ExifXferScrFile = argv[++argn];
-            DoModify |= MODIFY_JPEG;
+            Context.ExifXferScrFile = argv[++argn];
+            Context.DoModify |= MODIFY_JPEG;
         }else if (!strcmp(arg,"-dc")){
-            DeleteComments = TRUE;
-            DoModify |= MODIFY_JPEG;
+            Context.DeleteComments = TRUE;
+            Context.DoModify |= MODIFY_JPEG;
         }else if (!strcmp(arg,"-de")){
-            DeleteExif = TRUE;
-            DoModify |= MODIFY_JPEG;
+            Context.DeleteExif = TRUE;
+            Context.DoModify |= MODIFY_JPEG;
         }else if (!strcmp(arg,"-di")){
-            DeleteIptc = TRUE;
-            DoModify |= MODIFY_JPEG;
+            Context.DeleteIptc = TRUE;
+            Context.DoModify |= MODIFY_JPEG;
         }else if (!strcmp(arg,"-dx")){
-            DeleteXmp = TRUE;
-            DoModify |= MODIFY_JPEG;
+            Context.DeleteXmp = TRUE;
+            Context.DoModify |= MODIFY_JPEG;
         }else if (!strcmp(arg, "-du")){
-            DeleteUnknown = TRUE;
-            DoModify |= MODIFY_JPEG;
+            Context.DeleteUnknown = TRUE;
+            Context.DoModify |= MODIFY_JPEG;
         }else if (!strcmp(arg, "-purejpg")){
-            DeleteExif = TRUE;
-            DeleteComments = TRUE;
-            DeleteIptc = TRUE;
-            DeleteUnknown = TRUE;
-            DeleteXmp = TRUE;
-            DoModify |= MODIFY_JPEG;
+            Context.DeleteExif = TRUE;
+            Context.DeleteComments = TRUE;
+            Context.DeleteIptc = TRUE;
+            Context.DeleteUnknown = TRUE;
+            Context.DeleteXmp = TRUE;
+            Context.DoModify |= MODIFY_JPEG;
         }else if (!strcmp(arg,"-ce")){
-            EditComment = TRUE;
-            DoModify |= MODIFY_JPEG;
+            Context.EditComment = TRUE;
+            Context.DoModify |= MODIFY_JPEG;
         }else if (!strcmp(arg,"-cs")){
-            CommentSavefileName = argv[++argn];
+            Context.CommentSavefileName = argv[++argn];
         }else if (!strcmp(arg,"-ci")){
-            CommentInsertfileName = argv[++argn];
-            DoModify |= MODIFY_JPEG;
+            Context.CommentInsertfileName = argv[++argn];
+            Context.DoModify |= MODIFY_JPEG;
         }else if (!strcmp(arg,"-cl")){
-            CommentInsertLiteral = argv[++argn];
-            DoModify |= MODIFY_JPEG;
+            Context.CommentInsertLiteral = argv[++argn];
+            Context.DoModify |= MODIFY_JPEG;
         }else if (!strcmp(arg,"-mkexif")){
-            CreateExifSection = TRUE;
-            DoModify |= MODIFY_JPEG;
+            Context.CreateExifSection = TRUE;
+            Context.DoModify |= MODIFY_JPEG;
 
     // Output verbosity control
         }else if (!strcmp(arg,"-h")){
@@ -1450,7 +1608,7 @@ int main (int argc, char **argv)
         }else if (!strcmp(arg,"-v")){
             ShowTags = TRUE;
         }else if (!strcmp(arg,"-q")){
-            Quiet = TRUE;
+            Context.Quiet = TRUE;
         }else if (!strcmp(arg,"-V")){
             printf("Jhead version: "JHEAD_VERSION"   Compiled: "__DATE__"\n");
             exit(0);
@@ -1459,41 +1617,41 @@ int main (int argc, char **argv)
         }else if (!strcmp(arg,"-se")){
             SupressNonFatalErrors = TRUE;
         }else if (!strcmp(arg,"-c")){
-            ShowConcise = TRUE;
+            Context.ShowConcise = TRUE;
         }else if (!strcmp(arg,"-nofinfo")){
-            ShowFileInfo = 0;
+            Context.ShowFileInfo = 0;
 
     // Thumbnail manipulation options
         }else if (!strcmp(arg,"-dt")){
-            TrimExif = TRUE;
-            DoModify |= MODIFY_JPEG;
+            Context.TrimExif = TRUE;
+            Context.DoModify |= MODIFY_JPEG;
         }else if (!strcmp(arg,"-st")){
-            ThumbSaveName = argv[++argn];
-            DoModify |= READ_JPEG;
+            Context.ThumbSaveName = argv[++argn];
+            Context.DoModify |= READ_JPEG;
         }else if (!strcmp(arg,"-rt")){
-            ThumbInsertName = argv[++argn];
-            DoModify |= MODIFY_JPEG;
+            Context.ThumbInsertName = argv[++argn];
+            Context.DoModify |= MODIFY_JPEG;
         }else if (!memcmp(arg,"-rgt", 4)){
-            RegenThumbnail = 160;
-            sscanf(arg+4, "%d", &RegenThumbnail);
-            if (RegenThumbnail > 320){
+            Context.RegenThumbnail = 160;
+            sscanf(arg+4, "%d", &Context.RegenThumbnail);
+            if (Context.RegenThumbnail > 320){
                 ErrFatal("Specified thumbnail geometry too big!");
             }
-            DoModify |= MODIFY_JPEG;
+            Context.DoModify |= MODIFY_JPEG;
 
     // Rotation tag manipulation
         }else if (!strcmp(arg,"-autorot")){
-            AutoRotate = 1;
-            DoModify |= MODIFY_JPEG;
+            Context.AutoRotate = 1;
+            Context.DoModify |= MODIFY_JPEG;
         }else if (!strcmp(arg,"-norot")){
-            AutoRotate = 1;
-            ZeroRotateTagOnly = 1;
-            DoModify |= MODIFY_JPEG;
+            Context.AutoRotate = 1;
+            Context.ZeroRotateTagOnly = 1;
+            Context.DoModify |= MODIFY_JPEG;
 
     // Date/Time manipulation options
         }else if (!memcmp(arg,"-n",2)){
-            RenameToDate = 1;
-            DoModify |= READ_JPEG; // Rename doesn't modify file, so count as read action.
+            Context.RenameToDate = 1;
+            Context.DoModify |= READ_JPEG; // Rename doesn't modify file, so count as read action.
             arg+=2;
             if (*arg == 'f'){
                 // Accept -nf, but -n does the same thing now.
@@ -1501,9 +1659,9 @@ int main (int argc, char **argv)
             }
             if (*arg){
                 // A strftime format string is supplied.
-                strftime_args = arg;
+                Context.strftime_args = arg;
                 #ifdef _WIN32
-                    SlashToNative(strftime_args);
+                    SlashToNative(Context.strftime_args);
                 #endif
                 //printf("strftime_args = %s\n",arg);
             }
@@ -1511,11 +1669,11 @@ int main (int argc, char **argv)
             #ifndef _WIN32
                 ErrFatal("Error: -a only supported in Windows version");
             #else
-                RenameAssociatedFiles = TRUE;
+                Context.RenameAssociatedFiles = TRUE;
             #endif
         }else if (!strcmp(arg,"-ft")){
-            Exif2FileTime = TRUE;
-            DoModify |= MODIFY_ANY;
+            Context.Exif2FileTime = TRUE;
+            Context.DoModify |= MODIFY_ANY;
         }else if (!memcmp(arg,"-ta",3)){
             // Time adjust feature.
             int hours, minutes, seconds, n;
@@ -1528,10 +1686,10 @@ int main (int argc, char **argv)
             if (n < 1){
                 ErrFatal("Error: -ta must be immediately followed by time");
             }
-            if (ExifTimeAdjust) ErrFatal("Can only use one of -da or -ta options at once");
-            ExifTimeAdjust = hours*3600 + minutes*60 + seconds;
-            if (arg[3] == '-') ExifTimeAdjust = -ExifTimeAdjust;
-            DoModify |= MODIFY_JPEG;
+            if (Context.ExifTimeAdjust) ErrFatal("Can only use one of -da or -ta options at once");
+            Context.ExifTimeAdjust = hours*3600 + minutes*60 + seconds;
+            if (arg[3] == '-') Context.ExifTimeAdjust = -Context.ExifTimeAdjust;
+            Context.DoModify |= MODIFY_JPEG;
         }else if (!memcmp(arg,"-da",3)){
             // Date adjust feature (large time adjustments)
             time_t NewDate, OldDate = 0;
@@ -1543,20 +1701,20 @@ int main (int argc, char **argv)
             }else{
                 ErrFatal("Must specifiy second date for -da option");
             }
-            if (ExifTimeAdjust) ErrFatal("Can only use one of -da or -ta options at once");
-            ExifTimeAdjust = NewDate-OldDate;
-            DoModify |= MODIFY_JPEG;
+            if (Context.ExifTimeAdjust) ErrFatal("Can only use one of -da or -ta options at once");
+            Context.ExifTimeAdjust = NewDate-OldDate;
+            Context.DoModify |= MODIFY_JPEG;
         }else if (!memcmp(arg,"-dsft",5)){
             // Set file time to date/time in exif
-            FileTimeToExif = TRUE;
-            DoModify |= MODIFY_JPEG;
+            Context.FileTimeToExif = TRUE;
+            Context.DoModify |= MODIFY_JPEG;
         }else if (!memcmp(arg,"-ds",3)){
             // Set date feature
             int a;
             // Check date validity and copy it.  Could be incompletely specified.
-            strcpy(DateSet, "0000:01:01");
+            strcpy(Context.DateSet, "0000:01:01");
             for (a=0;arg[a+3];a++){
-                if (isdigit(DateSet[a])){
+                if (isdigit(Context.DateSet[a])){
                     if (!isdigit(arg[a+3])){
                         a = 0;
                         break;
@@ -1567,13 +1725,13 @@ int main (int argc, char **argv)
                         break;
                     }
                 }
-                DateSet[a] = arg[a+3];
+                Context.DateSet[a] = arg[a+3];
             }
             if (a < 4 || a > 10){
                 ErrFatal("Date must be in format YYYY, YYYY:MM, or YYYY:MM:DD");
             }
-            DateSetChars = a;
-            DoModify |= MODIFY_JPEG;
+            Context.DateSetChars = a;
+            Context.DoModify |= MODIFY_JPEG;
         }else if (!memcmp(arg,"-ts",3)){
             // Set the exif time.
             // Time must be specified as "yyyy:mm:dd-hh:mm:ss"
@@ -1588,40 +1746,40 @@ int main (int argc, char **argv)
                         "Example: jhead -ts2001:01:01-12:00:00 foo.jpg");
             }
 
-            ExifTimeSet  = mktime(&tm);
+            Context.ExifTimeSet  = mktime(&tm);
 
-            if ((int)ExifTimeSet == -1) ErrFatal("Time specified is out of range");
-            DoModify |= MODIFY_JPEG;
+            if ((int)Context.ExifTimeSet == -1) ErrFatal("Time specified is out of range");
+            Context.DoModify |= MODIFY_JPEG;
 
     // File matching and selection
         }else if (!strcmp(arg,"-model")){
             if (argn+1 >= argc) Usage(); // No extra argument.
-            FilterModel = argv[++argn];
+            Context.FilterModel = argv[++argn];
         }else if (!strcmp(arg,"-exonly")){
-            ExifOnly = 1;
+            Context.ExifOnly = 1;
         }else if (!strcmp(arg,"-orp")){
-            PortraitOnly = 1;
+            Context.PortraitOnly = 1;
         }else if (!strcmp(arg,"-orl")){
-            PortraitOnly = -1;
+            Context.PortraitOnly = -1;
         }else if (!strcmp(arg,"-cmd")){
             if (argn+1 >= argc) Usage(); // No extra argument.
-            ApplyCommand = argv[++argn];
-            DoModify |= MODIFY_ANY;
+            Context.ApplyCommand = argv[++argn];
+            Context.DoModify |= MODIFY_ANY;
 
 #ifdef MATTHIAS
         }else if (!strcmp(arg,"-ca")){
             // Its a literal comment.  Add.
-            AddComment = argv[++argn];
-            DoModify |= MODIFY_JPEG;
+            Context.AddComment = argv[++argn];
+            Context.DoModify |= MODIFY_JPEG;
         }else if (!strcmp(arg,"-cr")){
             // Its a literal comment.  Remove this keyword.
-            RemComment = argv[++argn];
-            DoModify |= MODIFY_JPEG;
+            Context.RemComment = argv[++argn];
+            Context.DoModify |= MODIFY_JPEG;
         }else if (!strcmp(arg,"-ar")){
-            AutoResize = TRUE;
-            ShowConcise = TRUE;
-            ApplyCommand = (char *)1; // Must be non null so it does commands.
-            DoModify |= MODIFY_JPEG;
+            Context.AutoResize = TRUE;
+            Context.ShowConcise = TRUE;
+            Context.ApplyCommand = (char *)1; // Must be non null so it does commands.
+            Context.DoModify |= MODIFY_JPEG;
 #endif // MATTHIAS
         }else{
             printf("Argument '%s' not understood\n",arg);
@@ -1638,56 +1796,56 @@ int main (int argc, char **argv)
         ErrFatal("No files to process.  Use -h for help");
     }
 
-    if (ThumbSaveName != NULL && strcmp(ThumbSaveName, "&i") == 0){
+    if (Context.ThumbSaveName != NULL && strcmp(Context.ThumbSaveName, "&i") == 0){
         printf("Error: By specifying \"&i\" for the thumbail name, your original file\n"
                "       will be overwitten.  If this is what you really want,\n"
                "       specify  -st \"./&i\"  to override this check\n");
         exit(0);
     }
 
-    if (RegenThumbnail){
-        if (ThumbSaveName || ThumbInsertName){
+    if (Context.RegenThumbnail){
+        if (Context.ThumbSaveName || Context.ThumbInsertName){
             printf("Error: Cannot regen and save or insert thumbnail in same run\n");
             exit(0);
         }
     }
 
-    if (EditComment){
-        if (CommentSavefileName != NULL || CommentInsertfileName != NULL){
+    if (Context.EditComment){
+        if (Context.CommentSavefileName != NULL || Context.CommentInsertfileName != NULL){
             printf("Error: Cannot use -ce option in combination with -cs or -ci\n");
             exit(0);
         }
     }
 
 
-    if (ExifXferScrFile){
-        if (FilterModel || ApplyCommand){
+    if (Context.ExifXferScrFile){
+        if (Context.FilterModel || Context.ApplyCommand){
             ErrFatal("Error: Filter by model and/or applying command to files\n"
             "   invalid while transferring Exif headers");
         }
     }
 
-    FileSequence = 0;
+    Context.FileSequence = 0;
     for (;argn<argc;argn++){
-        FilesMatched = FALSE;
+        Context.FilesMatched = FALSE;
 
         #ifdef _WIN32
             SlashToNative(argv[argn]);
             // Use my globbing module to do fancier wildcard expansion with recursive
             // subdirectories under Windows.
-            MyGlob(argv[argn], ProcessFile);
+            MyGlob(argv[argn], ProcessGlobbedFile, &Context);
         #else
             // Under linux, don't do any extra fancy globbing - shell globbing is 
             // pretty fancy as it is - although not as good as myglob.c
-            ProcessFile(argv[argn]);
+            ProcessFile(&Context, argv[argn]);
         #endif
 
-        if (!FilesMatched){
+        if (!Context.FilesMatched){
             fprintf(stderr, "Error: No files matched '%s'\n",argv[argn]);
         }
     }
     
-    if (FileSequence == 0){
+    if (Context.FileSequence == 0){
         return EXIT_FAILURE;
     }else{
         return EXIT_SUCCESS;
@@ -6,6 +6,8 @@
 // where they get used as possible, so include files only get stuff that 
 // gets used in more than one file.
 //--------------------------------------------------------------------------
+#pragma once
+
 #define _CRT_SECURE_NO_DEPRECATE 1
 
 #include <stdio.h>
@@ -196,7 +198,7 @@ void ShowXmp(Section_t XmpSection);
 
 // Prototypes for myglob.c module
 #ifdef _WIN32
-void MyGlob(const char * Pattern , void (*FileFuncParm)(const char * FileName));
+void MyGlob(const char * Pattern , void (*FileFuncParm)(const char * FileName, void * Arg), void * Arg);
 void SlashToNative(char * Path);
 #endif
 
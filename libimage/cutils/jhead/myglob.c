@@ -32,7 +32,7 @@ typedef struct {
 //--------------------------------------------------------------------------------
 // Dummy function to show operation.
 //--------------------------------------------------------------------------------
-void ShowName(const char * FileName)
+void ShowName(const char * FileName, void * Arg)
 {
     printf("     %s\n",FileName);
 }
@@ -71,7 +71,7 @@ int CompareFunc(const void * f1, const void * f2)
 //--------------------------------------------------------------------------------
 // Decide how a particular pattern should be handled, and call function for each.
 //--------------------------------------------------------------------------------
-void MyGlob(const char * Pattern , void (*FileFuncParm)(const char * FileName))
+void MyGlob(const char * Pattern , void (*FileFuncParm)(const char * FileName, void * Arg), void * Arg)
 {
     char BasePattern[_MAX_PATH];
     char MatchPattern[_MAX_PATH];
@@ -134,7 +134,7 @@ DoRecursion:
 
     if (!SawPat){
         // No pattern.  This should refer to a file.
-        FileFuncParm(PatCopy);
+        FileFuncParm(PatCopy, Arg);
         return;
     }
 
@@ -205,13 +205,13 @@ DoRecursion:
                     // Need more directories.
                     SplicePath(CombinedName, BasePattern, FileList[a].Name);
                     strncat(CombinedName, PatCopy+PatternEnd, _MAX_PATH*2-strlen(CombinedName));
-                    MyGlob(CombinedName,FileFuncParm);
+                    MyGlob(CombinedName,FileFuncParm,Arg);
                 }
             }else{
                 if (MatchFiles){
                     // We need files at this level.
                     SplicePath(CombinedName, BasePattern, FileList[a].Name);
-                    FileFuncParm(CombinedName);
+                    FileFuncParm(CombinedName, Arg);
                 }
             }
             free(FileList[a].Name);
@@ -272,7 +272,7 @@ int main (int argc, char **argv)
     }
 
     for (;argn<argc;argn++){
-        MyGlob(argv[argn], ShowName);
+        MyGlob(argv[argn], ShowName, NULL);
     }
     return EXIT_SUCCESS;
 }
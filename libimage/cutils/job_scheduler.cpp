@@ -0,0 +1,341 @@
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cutils.h"
+#include "job_scheduler.h"
+
+#define JOB_DEFAULT_MAX_PENDING 4096
+
+struct Job {
+	JobFunction function;
+	void* context;
+	uint32_t group;
+	uint32_t generation;
+};
+
+// owner pushes and pops at the back (latest request first)
+// thieves take from the front
+struct JobWorker {
+	std::mutex mutex;
+	std::deque<Job> queues[JOB_PRIORITY_COUNT];
+};
+
+struct JobScheduler {
+	std::vector<JobWorker*> workers;
+	std::vector<std::thread> threads;
+	std::atomic<uint32_t> generations[JOB_GROUP_COUNT];
+	std::atomic<size_t> pending[JOB_PRIORITY_COUNT];
+	std::atomic<size_t> next_worker;
+	size_t max_pending;
+
+	// idle workers sleep here
+	std::mutex sleep_mutex;
+	std::condition_variable wakeup;
+	std::atomic<size_t> total_pending;
+	std::atomic<bool> stopping;
+};
+
+// scheduler and worker index when running on a worker thread
+static thread_local JobScheduler* current_scheduler = NULL;
+static thread_local size_t current_worker = 0;
+
+static bool popJob(JobWorker* worker, int priority, bool own, Job* job) {
+	std::lock_guard<std::mutex> lock(worker->mutex);
+	std::deque<Job>& queue = worker->queues[priority];
+	if (queue.empty()) {
+		return false;
+	}
+	if (own) {
+		*job = queue.back();
+		queue.pop_back();
+	} else {
+		*job = queue.front();
+		queue.pop_front();
+	}
+	return true;
+}
+
+// highest priority first: own queue, then steal from the others
+static bool takeJob(JobScheduler* scheduler, size_t self, Job* job, int* priority) {
+	size_t count = scheduler->workers.size();
+	for (int p = 0; p < JOB_PRIORITY_COUNT; p++) {
+		if (scheduler->pending[p].load() == 0) {
+			continue;
+		}
+		for (size_t i = 0; i < count; i++) {
+			size_t victim = (self + i) % count;
+			if (popJob(scheduler->workers[victim], p, victim == self, job)) {
+				*priority = p;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+static void runJob(JobScheduler* scheduler, const Job& job, int priority) {
+	scheduler->pending[priority].fetch_sub(1);
+	scheduler->total_pending.fetch_sub(1);
+	bool cancelled = (job.generation != scheduler->generations[job.group % JOB_GROUP_COUNT].load());
+	job.function(job.context, cancelled);
+}
+
+static void workerLoop(JobScheduler* scheduler, size_t self) {
+
+	current_scheduler = scheduler;
+	current_worker = self;
+
+	for (;;) {
+
+		// leave what is still queued to jobSchedulerDestroy
+		if (scheduler->stopping.load()) {
+			return;
+		}
+
+		Job job;
+		int priority;
+		if (takeJob(scheduler, self, &job, &priority)) {
+			runJob(scheduler, job, priority);
+			continue;
+		}
+
+		// nothing anywhere: sleep until something is submitted
+		std::unique_lock<std::mutex> lock(scheduler->sleep_mutex);
+		if (scheduler->stopping.load()) {
+			return;
+		}
+		if (scheduler->total_pending.load() == 0) {
+			scheduler->wakeup.wait(lock);
+		}
+	}
+}
+
+JobScheduler* jobSchedulerCreate(unsigned int workers, size_t max_pending) {
+
+	if (workers == 0) {
+		workers = std::thread::hardware_concurrency();
+	}
+	if (workers == 0) {
+		workers = 1;
+	}
+
+	JobScheduler* scheduler = new JobScheduler();
+	for (int g = 0; g < JOB_GROUP_COUNT; g++) {
+		scheduler->generations[g] = 0;
+	}
+	for (int p = 0; p < JOB_PRIORITY_COUNT; p++) {
+		scheduler->pending[p] = 0;
+	}
+	scheduler->next_worker = 0;
+	scheduler->max_pending = max_pending ? max_pending : JOB_DEFAULT_MAX_PENDING;
+	scheduler->total_pending = 0;
+	scheduler->stopping = false;
+
+	for (unsigned int i = 0; i < workers; i++) {
+		scheduler->workers.push_back(new JobWorker());
+	}
+	try {
+		for (unsigned int i = 0; i < workers; i++) {
+			scheduler->threads.push_back(std::thread(workerLoop, scheduler, (size_t) i));
+		}
+	} catch (...) {
+		// could not spawn more: go with what we have
+	}
+	if (scheduler->threads.empty()) {
+		jobSchedulerDestroy(scheduler);
+		return NULL;
+	}
+	return scheduler;
+}
+
+void jobSchedulerDestroy(JobScheduler* scheduler) {
+
+	if (scheduler == NULL) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(scheduler->sleep_mutex);
+		scheduler->stopping = true;
+	}
+	scheduler->wakeup.notify_all();
+	for (size_t i = 0; i < scheduler->threads.size(); i++) {
+		scheduler->threads[i].join();
+	}
+
+	// workers stopped taking jobs: let the queued ones free their context
+	for (size_t i = 0; i < scheduler->workers.size(); i++) {
+		JobWorker* worker = scheduler->workers[i];
+		for (int p = 0; p < JOB_PRIORITY_COUNT; p++) {
+			while (worker->queues[p].empty() == false) {
+				Job job = worker->queues[p].front();
+				worker->queues[p].pop_front();
+				scheduler->pending[p].fetch_sub(1);
+				job.function(job.context, true);
+			}
+		}
+		delete worker;
+	}
+	delete scheduler;
+}
+
+JobScheduler* jobSchedulerShared(void) {
+	static std::once_flag once;
+	static JobScheduler* shared = NULL;
+	std::call_once(once, []() { shared = jobSchedulerCreate(0, 0); });
+	return shared;
+}
+
+unsigned int jobSchedulerWorkers(JobScheduler* scheduler) {
+	return scheduler != NULL ? (unsigned int) scheduler->threads.size() : 0;
+}
+
+uint32_t jobSchedulerGeneration(JobScheduler* scheduler, uint32_t group) {
+	return scheduler != NULL ? scheduler->generations[group % JOB_GROUP_COUNT].load() : 0;
+}
+
+uint32_t jobSchedulerCancel(JobScheduler* scheduler, uint32_t group) {
+	return scheduler != NULL ? scheduler->generations[group % JOB_GROUP_COUNT].fetch_add(1) + 1 : 0;
+}
+
+bool jobSchedulerIsCancelled(JobScheduler* scheduler, uint32_t group, uint32_t generation) {
+	return scheduler != NULL && scheduler->generations[group % JOB_GROUP_COUNT].load() != generation;
+}
+
+bool jobSchedulerSubmit(JobScheduler* scheduler, int priority, uint32_t group, uint32_t generation,
+												JobFunction function, void* context) {
+
+	if (scheduler == NULL || function == NULL || priority < 0 || priority >= JOB_PRIORITY_COUNT) {
+		return false;
+	}
+
+	// back-pressure: the caller decides what to drop
+	if (scheduler->pending[priority].fetch_add(1) >= scheduler->max_pending) {
+		scheduler->pending[priority].fetch_sub(1);
+		return false;
+	}
+
+	// jobs submitted from a worker stay on it, others are spread
+	size_t index = (current_scheduler == scheduler) ? current_worker
+		: scheduler->next_worker.fetch_add(1) % scheduler->workers.size();
+	Job job = { function, context, group, generation };
+	{
+		// counted before any worker can pop it (runJob decrements)
+		std::lock_guard<std::mutex> lock(scheduler->workers[index]->mutex);
+		scheduler->workers[index]->queues[priority].push_back(job);
+		scheduler->total_pending.fetch_add(1);
+	}
+
+	// a worker between its total_pending check and wait holds sleep_mutex
+	// taking it here makes sure the notification is not lost
+	{
+		std::lock_guard<std::mutex> lock(scheduler->sleep_mutex);
+	}
+	scheduler->wakeup.notify_one();
+	return true;
+}
+
+size_t jobSchedulerPending(JobScheduler* scheduler, int priority) {
+	if (scheduler == NULL || priority < 0 || priority >= JOB_PRIORITY_COUNT) {
+		return 0;
+	}
+	return scheduler->pending[priority].load();
+}
+
+//
+// batches
+//
+
+// shared by the caller and its helper jobs: helpers that start after
+// the batch is over only drop their reference
+struct JobBatch {
+	JobScheduler* scheduler;
+	JobBatchFunction function;
+	void* context;
+	size_t count;
+	uint32_t group;
+	uint32_t generation;
+	std::mutex mutex;
+	std::condition_variable done;
+	size_t next;
+	size_t in_flight;
+	bool stopped;
+};
+
+static bool claimIndex(JobBatch* batch, size_t* index) {
+	std::lock_guard<std::mutex> lock(batch->mutex);
+	if (batch->stopped || batch->next >= batch->count ||
+			jobSchedulerIsCancelled(batch->scheduler, batch->group, batch->generation)) {
+		return false;
+	}
+	*index = batch->next++;
+	batch->in_flight++;
+	return true;
+}
+
+static void runBatch(JobBatch* batch) {
+	size_t index;
+	while (claimIndex(batch, &index)) {
+		batch->function(batch->context, index);
+		std::lock_guard<std::mutex> lock(batch->mutex);
+		batch->in_flight--;
+		if (batch->in_flight == 0) {
+			batch->done.notify_all();
+		}
+	}
+}
+
+static void batchJob(void* context, bool cancelled) {
+	std::shared_ptr<JobBatch>* batch = (std::shared_ptr<JobBatch>*) context;
+	if (cancelled == false) {
+		runBatch(batch->get());
+	}
+	delete batch;
+}
+
+void jobSchedulerRunBatch(JobScheduler* scheduler, int priority, uint32_t group, uint32_t generation,
+													size_t count, unsigned int max_workers, JobBatchFunction function, void* context) {
+
+	if (function == NULL || count == 0) {
+		return;
+	}
+
+	std::shared_ptr<JobBatch> batch = std::make_shared<JobBatch>();
+	batch->scheduler = scheduler;
+	batch->function = function;
+	batch->context = context;
+	batch->count = count;
+	batch->group = group;
+	batch->generation = generation;
+	batch->next = 0;
+	batch->in_flight = 0;
+	batch->stopped = false;
+
+	// helpers: current thread is one of the workers
+	size_t helpers = jobSchedulerWorkers(scheduler);
+	if (max_workers != 0) {
+		helpers = min(helpers, (size_t) max_workers - 1);
+	}
+	helpers = min(helpers, count - 1);
+	for (size_t i = 0; i < helpers; i++) {
+		std::shared_ptr<JobBatch>* reference = new std::shared_ptr<JobBatch>(batch);
+		if (jobSchedulerSubmit(scheduler, priority, group, generation, batchJob, reference) == false) {
+			delete reference;
+			break;
+		}
+	}
+
+	runBatch(batch.get());
+
+	// only wait for calls already started
+	std::unique_lock<std::mutex> lock(batch->mutex);
+	batch->stopped = true;
+	while (batch->in_flight != 0) {
+		batch->done.wait(lock);
+	}
+}
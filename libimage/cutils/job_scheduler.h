@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// priority classes: a worker never runs a job while one
+	// of a higher class is queued anywhere
+	#define JOB_PRIORITY_VISIBLE       0
+	#define JOB_PRIORITY_NEAR_VISIBLE  1
+	#define JOB_PRIORITY_PREFETCH      2
+	#define JOB_PRIORITY_BACKGROUND    3
+	#define JOB_PRIORITY_COUNT         4
+
+	// jobs are tagged with a group (e.g. one gallery view) and the
+	// generation of that group when they were submitted
+	// JOB_GROUP_DEFAULT is for work nobody cancels
+	#define JOB_GROUP_COUNT            64
+	#define JOB_GROUP_DEFAULT          0
+
+	typedef struct JobScheduler JobScheduler;
+
+	// cancelled is true when the group generation changed before the
+	// job started: only cleanup (freeing context) should be done
+	typedef void (*JobFunction)(void* context, bool cancelled);
+
+	// called for each index of a batch
+	typedef void (*JobBatchFunction)(void* context, size_t index);
+
+	// workers = 0 uses one per core
+	// max_pending is the queue limit of each priority class
+	JobScheduler* jobSchedulerCreate(unsigned int workers, size_t max_pending);
+
+	// running jobs complete, pending ones are called as cancelled
+	void jobSchedulerDestroy(JobScheduler* scheduler);
+
+	// process-wide scheduler shared by cutils batch functions
+	JobScheduler* jobSchedulerShared(void);
+
+	unsigned int jobSchedulerWorkers(JobScheduler* scheduler);
+
+	uint32_t jobSchedulerGeneration(JobScheduler* scheduler, uint32_t group);
+
+	// jobs of group submitted before this call will not start
+	// returns the new generation to submit with
+	uint32_t jobSchedulerCancel(JobScheduler* scheduler, uint32_t group);
+
+	// for long jobs to stop early
+	bool jobSchedulerIsCancelled(JobScheduler* scheduler, uint32_t group, uint32_t generation);
+
+	// returns false when the priority class queue is full (back-pressure)
+	// the job is then not queued and function is not called
+	bool jobSchedulerSubmit(JobScheduler* scheduler, int priority, uint32_t group, uint32_t generation,
+													JobFunction function, void* context);
+
+	size_t jobSchedulerPending(JobScheduler* scheduler, int priority);
+
+	// runs function for each index of [0, count) on at most max_workers
+	// threads (0 for all), the calling thread being one of them
+	// returns when all started calls are done
+	// cancelling group (jobSchedulerCancel) stops new calls
+	void jobSchedulerRunBatch(JobScheduler* scheduler, int priority, uint32_t group, uint32_t generation,
+														size_t count, unsigned int max_workers, JobBatchFunction function, void* context);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,81 @@
+#include <atomic>
+#include <mutex>
+
+#include "cutils.h"
+#include "jpeg_batch.h"
+#include "job_scheduler.h"
+
+struct JpegBatch {
+	const JpegBatchItem* items;
+	size_t count;
+	JpegBatchCallback callback;
+	void* context;
+	std::atomic<size_t> succeeded;
+	size_t completed;
+	std::mutex callback_mutex;
+};
+
+static bool processItem(const JpegBatchItem* item) {
+
+	if (item->file == NULL) {
+		return false;
+	}
+
+	// nothing to do
+	if (item->transform == JXFORM_NONE) {
+		return true;
+	}
+
+	// transform in place: pixels are now upright
+	JpegTransformOptions options;
+	memset(&options, 0, sizeof(options));
+	options.reset_orientation = true;
+	options.transform_thumbnail = true;
+	options.optimize_coding = true;
+	options.thumbnail_kept = item->thumbnail_kept;
+	return jpegTransformFile(item->file, item->transform, &options);
+}
+
+static void batchItem(void* context, size_t index) {
+
+	JpegBatch* batch = (JpegBatch*) context;
+
+	// process it
+	bool success = processItem(&batch->items[index]);
+	if (success) {
+		batch->succeeded.fetch_add(1);
+	}
+
+	// report
+	std::lock_guard<std::mutex> lock(batch->callback_mutex);
+	batch->completed++;
+	if (batch->callback != NULL) {
+		batch->callback(batch->context, index, success, batch->completed, batch->count);
+	}
+}
+
+size_t jpegBatchTransform(const JpegBatchItem* items, size_t count,
+													unsigned int max_workers,
+													JpegBatchCallback callback, void* context,
+													uint32_t group, uint32_t generation) {
+
+	if (items == NULL || count == 0) {
+		return 0;
+	}
+
+	// shared state
+	JpegBatch batch;
+	batch.items = items;
+	batch.count = count;
+	batch.callback = callback;
+	batch.context = context;
+	batch.succeeded = 0;
+	batch.completed = 0;
+
+	// user is waiting for it
+	jobSchedulerRunBatch(jobSchedulerShared(), JOB_PRIORITY_VISIBLE, group, generation,
+											 count, max_workers, batchItem, &batch);
+
+	// done
+	return batch.succeeded.load();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	#include "jpeg_utils.h"
+
+	typedef struct {
+		const char* file;
+		JXFORM_CODE transform;
+		bool* thumbnail_kept; // see JpegTransformOptions (may be NULL)
+	} JpegBatchItem;
+
+	// called once per file as soon as it is processed
+	// calls are serialized but happen on worker threads
+	typedef void (*JpegBatchCallback)(void* context, size_t index, bool success,
+																		size_t completed, size_t total);
+
+	// losslessly transforms items in place and resets their exif orientation
+	// runs on max_workers threads (0 for one per core) and blocks until done
+	// jobs are tagged with group and generation of the shared scheduler
+	// (see job_scheduler.h): cancelling group stops scheduling new files
+	// returns the number of files successfully transformed
+	size_t jpegBatchTransform(const JpegBatchItem* items, size_t count,
+														unsigned int max_workers,
+														JpegBatchCallback callback, void* context,
+														uint32_t group, uint32_t generation);
+
+#ifdef __cplusplus
+}
+#endif
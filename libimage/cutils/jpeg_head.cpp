@@ -0,0 +1,151 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cutils.h"
+#include "jpeg_head.h"
+
+// extensions are rounded up so that a run of small segments
+// past the first read does not turn into one pread each
+#define JPEG_HEAD_EXTEND_STEP (16 * 1024)
+
+static bool readFully(int fd, unsigned char* buffer, size_t size, off_t offset) {
+	while (size > 0) {
+		ssize_t count = pread(fd, buffer, size, offset);
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count <= 0) {
+			return false;
+		}
+		buffer += count;
+		size -= (size_t) count;
+		offset += count;
+	}
+	return true;
+}
+
+// makes sure the first end bytes of the file are in head->data
+static bool ensureHead(int fd, JpegHead* head, size_t end) {
+
+	if (end <= head->bytes_read) {
+		return true;
+	}
+	if (end > head->file_size) {
+		return false;
+	}
+
+	size_t target = (end + JPEG_HEAD_EXTEND_STEP - 1) / JPEG_HEAD_EXTEND_STEP * JPEG_HEAD_EXTEND_STEP;
+	if (target > head->file_size) {
+		target = head->file_size;
+	}
+
+	unsigned char* data = (unsigned char*) realloc(head->data, target);
+	if (data == NULL) {
+		return false;
+	}
+	head->data = data;
+
+	if (readFully(fd, data + head->bytes_read, target - head->bytes_read, (off_t) head->bytes_read) == false) {
+		return false;
+	}
+	head->bytes_read = target;
+	return true;
+}
+
+bool jpegReadHeadFd(int fd, JpegHead* head) {
+
+	if (head == NULL) {
+		return false;
+	}
+	memset(head, 0, sizeof(JpegHead));
+
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0 || st.st_size < 4) {
+		return false;
+	}
+	head->file_size = (size_t) st.st_size;
+
+	// one read for the common case
+	size_t initial = min(head->file_size, (size_t) JPEG_HEAD_INITIAL_READ);
+	head->data = (unsigned char*) malloc(initial);
+	if (head->data == NULL) {
+		return false;
+	}
+	if (readFully(fd, head->data, initial, 0) == false) {
+		jpegFreeHead(head);
+		return false;
+	}
+	head->bytes_read = initial;
+
+	if (head->data[0] != 0xFF || head->data[1] != 0xD8) {
+		jpegFreeHead(head);
+		return false;
+	}
+
+	// walk segments: a truncated or corrupted chain
+	// ends the head where the last valid segment ends
+	size_t offset = 2;
+	while (ensureHead(fd, head, offset + 2)) {
+
+		if (head->data[offset] != 0xFF) {
+			break;
+		}
+		unsigned char marker = head->data[offset + 1];
+		if (marker == 0xFF) {
+			offset++;
+			continue;
+		}
+		if (marker == 0xD9) {
+			break;
+		}
+		if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+			offset += 2;
+			continue;
+		}
+
+		if (ensureHead(fd, head, offset + 4) == false) {
+			break;
+		}
+		size_t length = (head->data[offset + 2] << 8) | head->data[offset + 3];
+		if (length < 2 || ensureHead(fd, head, offset + 2 + length) == false) {
+			break;
+		}
+
+		if (marker == 0xDA) {
+			head->sos_offset = offset;
+			offset += 2 + length;
+			break;
+		}
+		offset += 2 + length;
+	}
+
+	head->size = offset;
+	return true;
+}
+
+bool jpegReadHead(const char* file, JpegHead* head) {
+
+	if (head != NULL) {
+		memset(head, 0, sizeof(JpegHead));
+	}
+	if (file == NULL || head == NULL) {
+		return false;
+	}
+
+	int fd = open(file, O_RDONLY);
+	if (fd == -1) {
+		return false;
+	}
+	bool rc = jpegReadHeadFd(fd, head);
+	close(fd);
+	return rc;
+}
+
+void jpegFreeHead(JpegHead* head) {
+	if (head != NULL) {
+		free(head->data);
+		memset(head, 0, sizeof(JpegHead));
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// size of the first read: covers the markers of most files
+	#define JPEG_HEAD_INITIAL_READ (64 * 1024)
+
+	// the head of a jpeg file: SOI and all segments up to and
+	// including the SOS header, without the entropy-coded data
+	typedef struct {
+		unsigned char* data;      // file bytes from offset 0
+		size_t size;              // bytes of data that belong to the head
+		size_t sos_offset;        // offset of the SOS marker (0 if not reached)
+		size_t bytes_read;        // bytes actually read from the file
+		size_t file_size;
+	} JpegHead;
+
+	// reads the head with one pread of JPEG_HEAD_INITIAL_READ bytes
+	// extended only when a segment runs past what was read
+	// stops at SOS (or EOI): image data is never transferred
+	// returns false if this is not a jpeg file
+	// on success caller must call jpegFreeHead
+	bool jpegReadHead(const char* file, JpegHead* head);
+
+	// same as jpegReadHead on an open descriptor (not moved)
+	bool jpegReadHeadFd(int fd, JpegHead* head);
+
+	void jpegFreeHead(JpegHead* head);
+
+#ifdef __cplusplus
+}
+#endif
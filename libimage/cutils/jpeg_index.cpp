@@ -0,0 +1,265 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <mutex>
+
+#include "cutils.h"
+#include "jpeg_index.h"
+#include "jpeg_head.h"
+
+// direct-mapped: a colliding file simply replaces the slot
+#define JPEG_INDEX_CACHE_SLOTS 4096
+#define JPEG_INDEX_CACHE_MAGIC 0x3158494A // "JIX1"
+
+typedef struct {
+	uint32_t magic;
+	uint32_t checksum;           // of everything after this field
+	uint64_t path_hash;
+	uint64_t file_size;
+	int64_t mtime_sec;
+	int64_t mtime_nsec;
+	JpegIndex index;
+} JpegIndexRecord;
+
+static std::mutex cache_mutex;
+static int cache_fd = -1;
+
+static uint64_t hashPath(const char* path) {
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (const unsigned char* p = (const unsigned char*) path; *p; p++) {
+		hash = (hash ^ *p) * 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static uint32_t checksumRecord(const JpegIndexRecord* record) {
+	const unsigned char* p = (const unsigned char*) &record->path_hash;
+	const unsigned char* end = (const unsigned char*) (record + 1);
+	uint32_t hash = 0x811c9dc5;
+	for (; p < end; p++) {
+		hash = (hash ^ *p) * 0x01000193;
+	}
+	return hash;
+}
+
+static void keyRecord(JpegIndexRecord* record, const char* file, const struct stat* st) {
+	memset(record, 0, sizeof(JpegIndexRecord));
+	record->magic = JPEG_INDEX_CACHE_MAGIC;
+	record->path_hash = hashPath(file);
+	record->file_size = (uint64_t) st->st_size;
+	record->mtime_sec = (int64_t) st->st_mtime;
+#ifdef __APPLE__
+	record->mtime_nsec = (int64_t) st->st_mtimespec.tv_nsec;
+#else
+	record->mtime_nsec = (int64_t) st->st_mtim.tv_nsec;
+#endif
+}
+
+static off_t slotOffset(uint64_t path_hash) {
+	return (off_t) ((path_hash % JPEG_INDEX_CACHE_SLOTS) * sizeof(JpegIndexRecord));
+}
+
+static bool cacheLookup(const JpegIndexRecord* key, JpegIndex* index) {
+
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	if (cache_fd == -1) {
+		return false;
+	}
+
+	JpegIndexRecord record;
+	if (pread(cache_fd, &record, sizeof(record), slotOffset(key->path_hash)) != sizeof(record)) {
+		return false;
+	}
+	if (record.magic != key->magic || record.checksum != checksumRecord(&record) ||
+			record.path_hash != key->path_hash || record.file_size != key->file_size ||
+			record.mtime_sec != key->mtime_sec || record.mtime_nsec != key->mtime_nsec) {
+		return false;
+	}
+
+	memcpy(index, &record.index, sizeof(JpegIndex));
+	return true;
+}
+
+static void cacheStore(JpegIndexRecord* record, const JpegIndex* index) {
+
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	if (cache_fd == -1) {
+		return;
+	}
+
+	// one pwrite per record: a torn write fails the checksum
+	// and a failed one only costs a rebuild next time
+	memcpy(&record->index, index, sizeof(JpegIndex));
+	record->checksum = checksumRecord(record);
+	ssize_t written = pwrite(cache_fd, record, sizeof(JpegIndexRecord), slotOffset(record->path_hash));
+	(void) written;
+}
+
+bool jpegIndexCacheOpen(const char* path) {
+
+	if (path == NULL) {
+		return false;
+	}
+
+	int fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (fd == -1) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	if (cache_fd != -1) {
+		close(cache_fd);
+	}
+	cache_fd = fd;
+	return true;
+}
+
+void jpegIndexCacheClose(void) {
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	if (cache_fd != -1) {
+		close(cache_fd);
+		cache_fd = -1;
+	}
+}
+
+static bool isSOF(unsigned char marker) {
+	return marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+}
+
+bool jpegIndexBuild(const unsigned char* data, size_t size, JpegIndex* index) {
+
+	if (index == NULL) {
+		return false;
+	}
+	memset(index, 0, sizeof(JpegIndex));
+	if (data == NULL || size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+		return false;
+	}
+
+	size_t offset = 2;
+	while (offset + 4 <= size) {
+
+		if (data[offset] != 0xFF) {
+			break;
+		}
+		unsigned char marker = data[offset + 1];
+		if (marker == 0xFF) {
+			offset++;
+			continue;
+		}
+		if (marker == 0xD9) {
+			break;
+		}
+		if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+			offset += 2;
+			continue;
+		}
+
+		size_t length = (data[offset + 2] << 8) | data[offset + 3];
+		if (length < 2 || length > size - offset - 2) {
+			break;
+		}
+
+		const unsigned char* payload = data + offset + 4;
+		if (index->segment_count < JPEG_INDEX_MAX_SEGMENTS) {
+			JpegSegment* segment = &index->segments[index->segment_count++];
+			segment->offset = (uint32_t) offset;
+			segment->length = (uint32_t) length;
+			segment->marker = marker;
+			memcpy(segment->signature, payload, min(length - 2, sizeof(segment->signature)));
+		} else {
+			index->truncated = 1;
+		}
+
+		if (isSOF(marker) && length >= 2 + 6 && index->sof_marker == 0) {
+			index->sof_marker = marker;
+			index->height = (uint16_t) ((payload[1] << 8) | payload[2]);
+			index->width = (uint16_t) ((payload[3] << 8) | payload[4]);
+			index->components = payload[5];
+			for (unsigned i = 0; i < payload[5] && i < JPEG_INDEX_MAX_COMPONENTS && 6 + 3 * i + 2 < length - 2; i++) {
+				index->sampling[i] = payload[6 + 3 * i + 1];
+			}
+		}
+
+		if (marker == 0xDA) {
+			index->sos_offset = (uint32_t) offset;
+			index->data_offset = (uint32_t) (offset + 2 + length);
+			break;
+		}
+		offset += 2 + length;
+	}
+
+	return true;
+}
+
+bool jpegIndexFile(const char* file, JpegIndex* index) {
+
+	if (file == NULL || index == NULL) {
+		return false;
+	}
+
+	int fd = open(file, O_RDONLY);
+	if (fd == -1) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return false;
+	}
+
+	JpegIndexRecord record;
+	keyRecord(&record, file, &st);
+	if (cacheLookup(&record, index)) {
+		close(fd);
+		return true;
+	}
+
+	// markers are all in the head
+	JpegHead head;
+	bool rc = jpegReadHeadFd(fd, &head);
+	close(fd);
+	if (rc == false) {
+		return false;
+	}
+	rc = jpegIndexBuild(head.data, head.size, index);
+	jpegFreeHead(&head);
+
+	if (rc) {
+		cacheStore(&record, index);
+	}
+	return rc;
+}
+
+void jpegIndexUpdate(const char* file, const JpegIndex* index) {
+
+	if (file == NULL || index == NULL) {
+		return;
+	}
+
+	struct stat st;
+	if (stat(file, &st) != 0) {
+		return;
+	}
+
+	JpegIndexRecord record;
+	keyRecord(&record, file, &st);
+	cacheStore(&record, index);
+}
+
+const JpegSegment* jpegIndexFind(const JpegIndex* index, unsigned char marker, const char* signature) {
+
+	if (index == NULL) {
+		return NULL;
+	}
+
+	size_t length = signature ? min(strlen(signature) + 1, sizeof(((JpegSegment*) 0)->signature)) : 0;
+	for (uint32_t i = 0; i < index->segment_count; i++) {
+		const JpegSegment* segment = &index->segments[i];
+		if (segment->marker == marker && (signature == NULL || memcmp(segment->signature, signature, length) == 0)) {
+			return segment;
+		}
+	}
+	return NULL;
+}
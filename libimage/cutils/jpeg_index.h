@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	#define JPEG_INDEX_MAX_SEGMENTS 32
+	#define JPEG_INDEX_MAX_COMPONENTS 4
+
+	typedef struct {
+		uint32_t offset;             // file offset of the 0xFF marker byte
+		uint32_t length;             // segment length (includes the 2 length bytes)
+		uint8_t marker;              // 0xE0-0xEF, 0xDB, 0xC4, 0xC0-0xCF, 0xDA...
+		char signature[4];           // first payload bytes ("Exif", "JFIF", "ICC_", "MPF"...)
+		uint8_t reserved[3];
+	} JpegSegment;
+
+	// fixed-size record: can be copied and stored as is
+	typedef struct {
+		uint32_t segment_count;      // segments before SOS (SOS included)
+		uint32_t sos_offset;         // 0 if not reached
+		uint32_t data_offset;        // first byte of entropy-coded data
+		uint16_t width;              // from SOF
+		uint16_t height;
+		uint8_t sof_marker;          // 0xC0 baseline, 0xC2 progressive...
+		uint8_t components;
+		uint8_t sampling[JPEG_INDEX_MAX_COMPONENTS];  // (h << 4) | v per component
+		uint8_t truncated;           // more segments than JPEG_INDEX_MAX_SEGMENTS
+		uint8_t reserved;
+		JpegSegment segments[JPEG_INDEX_MAX_SEGMENTS];
+	} JpegIndex;
+
+	// persistent cache keyed by (path, size, mtime)
+	// without it every jpegIndexFile call reads the file head
+	bool jpegIndexCacheOpen(const char* path);
+	void jpegIndexCacheClose(void);
+
+	// indexes an in-memory jpeg (or the head of one)
+	bool jpegIndexBuild(const unsigned char* data, size_t size, JpegIndex* index);
+
+	// cached index of a jpeg file
+	bool jpegIndexFile(const char* file, JpegIndex* index);
+
+	// stores index under the current size and mtime of file
+	// to be called after an in-place edit that kept the layout
+	void jpegIndexUpdate(const char* file, const JpegIndex* index);
+
+	// first segment with marker whose payload starts with signature
+	// (NULL signature matches any)
+	const JpegSegment* jpegIndexFind(const JpegIndex* index, unsigned char marker, const char* signature);
+
+#ifdef __cplusplus
+}
+#endif
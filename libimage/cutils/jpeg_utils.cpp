@@ -1,36 +1,35 @@
 
 #include "cutils.h"
 #include "jpeg_utils.h"
+#include "exif_utils.h"
 #include <unistd.h>
+#include <sys/stat.h>
 
-// for jhead
+// for jhead (which has its own when linking cutils objects)
+#ifndef JHEAD_BUILD
 int ShowTags     = FALSE;
 int DumpExifMap  = FALSE;
 void ErrFatal(char * msg) {}
 void ErrNonfatal(char * msg, int a1, int a2) {}
 void FileTimeAsString(char * TimeStr) {}
+#endif
 
 // This procedure is called by the IJPEG library when an error occurs.
 static void error_exit (j_common_ptr pcinfo) {
   throw 1;
 }
 
-static char* openTemporaryOutputFile(FILE** output_file) {
-  const char* temp_directory = getenv("TMPDIR");
-  if (temp_directory == NULL || temp_directory[0] == '\0') {
-    temp_directory = "/tmp";
-  }
-
-  const size_t directory_length = strlen(temp_directory);
-  const char* separator = temp_directory[directory_length - 1] == '/' ? "" : "/";
-  const char* filename_template = "foto-jpeg-XXXXXX";
+static char* openTemporaryOutputFile(const char* directory, FILE** output_file) {
+  const size_t directory_length = strlen(directory);
+  const char* separator = (directory_length == 0 || directory[directory_length - 1] == '/') ? "" : "/";
+  const char* filename_template = ".foto-jpeg-XXXXXX";
   const size_t path_length = directory_length + strlen(separator) + strlen(filename_template) + 1;
   char* path = (char*)malloc(path_length);
   if (path == NULL) {
     return NULL;
   }
 
-  snprintf(path, path_length, "%s%s%s", temp_directory, separator, filename_template);
+  snprintf(path, path_length, "%s%s%s", directory, separator, filename_template);
   const int descriptor = mkstemp(path);
   if (descriptor == -1) {
     free(path);
@@ -48,18 +47,164 @@ static char* openTemporaryOutputFile(FILE** output_file) {
   return path;
 }
 
-const char* jpegTransform(const char* file, JXFORM_CODE trans) {
+static char* openTemporaryOutputFile(FILE** output_file) {
+  const char* temp_directory = getenv("TMPDIR");
+  if (temp_directory == NULL || temp_directory[0] == '\0') {
+    temp_directory = "/tmp";
+  }
+  return openTemporaryOutputFile(temp_directory, output_file);
+}
+
+static char* openSiblingOutputFile(const char* file, FILE** output_file) {
+  const char* slash = strrchr(file, '/');
+  if (slash == NULL) {
+    return openTemporaryOutputFile(".", output_file);
+  }
 
+  const size_t directory_length = slash - file + 1;
+  char* directory = (char*)malloc(directory_length + 1);
+  if (directory == NULL) {
+    return NULL;
+  }
+  memcpy(directory, file, directory_length);
+  directory[directory_length] = '\0';
+  char* path = openTemporaryOutputFile(directory, output_file);
+  free(directory);
+  return path;
+}
+
+struct JpegTransformer {
   struct jpeg_decompress_struct srcinfo;
   struct jpeg_compress_struct dstinfo;
   struct jpeg_error_mgr jsrcerr, jdsterr;
+  bool srcinfo_created;
+  bool dstinfo_created;
+};
+
+static void createTransformer(JpegTransformer* transformer) {
+
+  transformer->srcinfo_created = false;
+  transformer->dstinfo_created = false;
+
+  /* Initialize the JPEG decompression object with default error handling. */
+  transformer->srcinfo.err = jpeg_std_error(&transformer->jsrcerr);
+  transformer->jsrcerr.error_exit = error_exit;
+  jpeg_create_decompress(&transformer->srcinfo);
+  transformer->srcinfo_created = true;
+
+  /* Initialize the JPEG compression object with default error handling. */
+  transformer->dstinfo.err = jpeg_std_error(&transformer->jdsterr);
+  transformer->jdsterr.error_exit = error_exit;
+  jpeg_create_compress(&transformer->dstinfo);
+  transformer->dstinfo_created = true;
+
+  transformer->dstinfo.err->trace_level = 0;
+  transformer->jsrcerr.trace_level = transformer->jdsterr.trace_level;
+  transformer->srcinfo.mem->max_memory_to_use = transformer->dstinfo.mem->max_memory_to_use;
+}
+
+static void destroyTransformer(JpegTransformer* transformer) {
+  if (transformer->dstinfo_created) {
+    jpeg_destroy_compress(&transformer->dstinfo);
+    transformer->dstinfo_created = false;
+  }
+  if (transformer->srcinfo_created) {
+    jpeg_destroy_decompress(&transformer->srcinfo);
+    transformer->srcinfo_created = false;
+  }
+}
+
+static const JpegTransformOptions defaultTransformOptions = { false, false, false, false, NULL };
+
+// the exif block saved by jcopy_markers_setup
+// updating it changes what jcopy_markers_execute writes
+static jpeg_saved_marker_ptr findSavedExifMarker(j_decompress_ptr srcinfo) {
+  for (jpeg_saved_marker_ptr marker = srcinfo->marker_list; marker != NULL; marker = marker->next) {
+    if (marker->marker != JPEG_APP0 + 1 || marker->data_length < 6 + 8) {
+      continue;
+    }
+    if (memcmp(marker->data, "Exif\0\0", 6) != 0) {
+      continue;
+    }
+    return marker;
+  }
+  return NULL;
+}
+
+// IFD1 orientation describes the thumbnail:
+// it is only reset if the thumbnail was transformed too
+static void updateSavedExifOrientation(j_decompress_ptr srcinfo, unsigned char orientation,
+                                       bool with_thumbnail) {
+  jpeg_saved_marker_ptr marker = findSavedExifMarker(srcinfo);
+  if (marker != NULL) {
+    exif_orient_data(marker->data + 6, marker->data_length - 6, &orientation, with_thumbnail);
+  }
+}
+
+// returns false if there is a thumbnail that could not be transformed
+// in which case the saved exif block is left untouched
+static bool transformSavedExifThumbnail(j_decompress_ptr srcinfo, JXFORM_CODE trans,
+                                        const JpegTransformOptions* options, bool* transformed) {
+
+  *transformed = false;
+  jpeg_saved_marker_ptr marker = findSavedExifMarker(srcinfo);
+  if (marker == NULL) {
+    return true;
+  }
+
+  /* Locate thumbnail */
+  unsigned char* tiff = marker->data + 6;
+  unsigned int length = marker->data_length - 6;
+  unsigned int offset, size;
+  if (!exif_thumbnail_data(tiff, length, &offset, &size)) {
+    return true;
+  }
+
+  /* Transform it: only output options apply */
+  JpegTransformOptions thumbnail_options = defaultTransformOptions;
+  thumbnail_options.optimize_coding = options->optimize_coding;
+  unsigned char* thumbnail = NULL;
+  unsigned long thumbnail_size = 0;
+  if (!jpegTransformBuffer(tiff + offset, size, trans, &thumbnail_options, &thumbnail, &thumbnail_size)) {
+    return false;
+  }
+
+  /* Thumbnail can grow only if nothing follows it
+   * and the marker must still fit in 64 KB
+   */
+  bool at_end = (offset + size == length);
+  unsigned long new_length = at_end ? offset + thumbnail_size : length;
+  if ((!at_end && thumbnail_size > size) || 6 + new_length > 65533) {
+    free(thumbnail);
+    return false;
+  }
+
+  /* Saved marker is in the image pool: reallocate there */
+  JOCTET* data = marker->data;
+  if (6 + new_length > marker->data_length) {
+    data = (JOCTET*) (*srcinfo->mem->alloc_large)((j_common_ptr) srcinfo, JPOOL_IMAGE, 6 + new_length);
+    memcpy(data, marker->data, 6 + offset);
+  }
+
+  /* Splice */
+  memcpy(data + 6 + offset, thumbnail, thumbnail_size);
+  exif_set_thumbnail_size(data + 6, (unsigned int) new_length, (unsigned int) thumbnail_size);
+  marker->data = data;
+  marker->data_length = (unsigned int) (6 + new_length);
+  free(thumbnail);
+  *transformed = true;
+  return true;
+}
+
+// source and destination managers must be set up by caller
+// errors are thrown by the libjpeg error handler
+static void executeTransform(JpegTransformer* transformer, JXFORM_CODE trans,
+                             const JpegTransformOptions* options) {
+
+  j_decompress_ptr srcinfo = &transformer->srcinfo;
+  j_compress_ptr dstinfo = &transformer->dstinfo;
   jvirt_barray_ptr * src_coef_arrays;
   jvirt_barray_ptr * dst_coef_arrays;
-  FILE * input_file = NULL;
-  FILE * output_file = NULL;
-  char* tempfile = NULL;
-  bool srcinfo_created = false;
-  bool dstinfo_created = false;
 
   /* -copy switch */
   JCOPY_OPTION copyoption	= JCOPYOPT_ALL;
@@ -67,125 +212,231 @@ const char* jpegTransform(const char* file, JXFORM_CODE trans) {
   /* image transformation options */
   jpeg_transform_info transformoption;
   memset(&transformoption, 0, sizeof(jpeg_transform_info));
+  transformoption.transform = trans;
+  transformoption.perfect = false;
+  transformoption.force_grayscale = false;
+
+  /* Images whose size is not a multiple of the iMCU size cannot have their
+   * partial edge blocks moved: trim them (at most 15 pixels) so that the
+   * transform stays lossless for the rest of the image. trim only applies
+   * to the edges the requested transform actually moves.
+   */
+  transformoption.trim = true;
+
+  /* Enable saving of extra markers that we want to copy */
+  jcopy_markers_setup(srcinfo, copyoption);
+
+  /* Read file header */
+  (void) jpeg_read_header(srcinfo, TRUE);
+
+  /* Update markers before they get copied */
+  bool thumbnail_transformed = false;
+  if (options->transform_thumbnail) {
+    if (!transformSavedExifThumbnail(srcinfo, trans, options, &thumbnail_transformed) &&
+        options->thumbnail_kept != NULL) {
+      *options->thumbnail_kept = true;
+    }
+  }
+  if (options->reset_orientation) {
+    updateSavedExifOrientation(srcinfo, 1, thumbnail_transformed);
+  }
+
+  /* Any space needed by a transform option must be requested before
+   * jpeg_read_coefficients so that memory allocation will be done right.
+   */
+  if (!jtransform_request_workspace(srcinfo, &transformoption)) {
+    throw 1;
+  }
+
+  /* Read source file as DCT coefficients */
+  src_coef_arrays = jpeg_read_coefficients(srcinfo);
+
+  /* Initialize destination compression parameters from source values */
+  jpeg_copy_critical_parameters(srcinfo, dstinfo);
+
+  /* Adjust destination parameters if required by transform options;
+   * also find out which set of coefficient arrays will hold the output.
+   */
+  dst_coef_arrays = jtransform_adjust_parameters(srcinfo, dstinfo,
+                                                 src_coef_arrays,
+                                                 &transformoption);
+
+  /* Output options */
+  if (options->optimize_coding) {
+    dstinfo->optimize_coding = TRUE;
+  }
+  if (options->progressive) {
+    jpeg_simple_progression(dstinfo);
+  }
+
+  /* Start compressor (note no image data is actually written here) */
+  jpeg_write_coefficients(dstinfo, dst_coef_arrays);
+
+  /* Copy to the output file any extra markers that we want to preserve */
+  jcopy_markers_execute(srcinfo, dstinfo, copyoption);
+
+  /* Execute image transformation, if any */
+  jtransform_execute_transformation(srcinfo, dstinfo,
+                                    src_coef_arrays,
+                                    &transformoption);
+
+  /* Finish compression and release memory */
+  jpeg_finish_compress(dstinfo);
+  (void) jpeg_finish_decompress(srcinfo);
+}
+
+// transforms file into output_file
+static bool transformFileToFile(const char* file, FILE* output_file, JXFORM_CODE trans,
+                                const JpegTransformOptions* options) {
+
+  JpegTransformer transformer;
+  FILE * input_file = NULL;
 
   try
   {
-    /* Initialize the JPEG decompression object with default error handling. */
-    srcinfo.err = jpeg_std_error(&jsrcerr);
-    jsrcerr.error_exit = error_exit;
-    jpeg_create_decompress(&srcinfo);
-    srcinfo_created = true;
-    /* Initialize the JPEG compression object with default error handling. */
-    dstinfo.err = jpeg_std_error(&jdsterr);
-    jdsterr.error_exit = error_exit;
-    jpeg_create_compress(&dstinfo);
-    dstinfo_created = true;
-
-    /* Set up JPEG parameters. */
-    transformoption.transform = trans;
-    transformoption.trim = false;
-    transformoption.force_grayscale = false;
-    dstinfo.err->trace_level = 0;
-    jsrcerr.trace_level = jdsterr.trace_level;
-    srcinfo.mem->max_memory_to_use = dstinfo.mem->max_memory_to_use;
+    /* Initialize the JPEG objects */
+    createTransformer(&transformer);
 
     /* Open the input file. */
     if ((input_file = fopen(file, "rb")) == NULL) {
       throw 1;
     }
 
-    /* Specify data source for decompression */
-    jpeg_stdio_src(&srcinfo, input_file);
+    /* Specify data source and destination */
+    jpeg_stdio_src(&transformer.srcinfo, input_file);
+    jpeg_stdio_dest(&transformer.dstinfo, output_file);
 
-    /* Enable saving of extra markers that we want to copy */
-    jcopy_markers_setup(&srcinfo, copyoption);
+    /* Do it */
+    executeTransform(&transformer, trans, options);
+    destroyTransformer(&transformer);
 
-    /* Read file header */
-    (void) jpeg_read_header(&srcinfo, TRUE);
+    /* Close input file and flush output */
+    fclose(input_file);
+    input_file = NULL;
+    if (fflush(output_file) != 0) {
+      return false;
+    }
 
-    /* these are the size of the dct blocks */
-    int dct_width = srcinfo.max_h_samp_factor * DCTSIZE;
-    int dct_height = srcinfo.max_v_samp_factor * DCTSIZE;
+    /* Done */
+    return true;
+  }
+  catch (...)
+  {
+    if (input_file != NULL)
+      fclose(input_file);
+    destroyTransformer(&transformer);
+    return false;
+  }
+}
 
-    /* make sure image sizes are multiple of dct blocks size */
-    if (srcinfo.image_width % dct_width != 0 || srcinfo.image_height % dct_height != 0)
-    {
-      throw 1;
-    }
+const char* jpegTransform(const char* file, JXFORM_CODE trans) {
 
-    tempfile = openTemporaryOutputFile(&output_file);
-    if (tempfile == NULL)
-    {
-      throw 1;
-    }
+  /* Output goes to $TMPDIR */
+  FILE * output_file = NULL;
+  char* tempfile = openTemporaryOutputFile(&output_file);
+  if (tempfile == NULL) {
+    return NULL;
+  }
 
-    /* Any space needed by a transform option must be requested before
-		 * jpeg_read_coefficients so that memory allocation will be done right.
-		 */
-    jtransform_request_workspace(&srcinfo, &transformoption);
+  /* Transform and close */
+  bool rc = transformFileToFile(file, output_file, trans, &defaultTransformOptions);
+  if (fclose(output_file) != 0) {
+    rc = false;
+  }
 
-    /* Read source file as DCT coefficients */
-    src_coef_arrays = jpeg_read_coefficients(&srcinfo);
+  /* Cleanup on error */
+  if (rc == false) {
+    remove(tempfile);
+    free(tempfile);
+    return NULL;
+  }
 
-    /* Initialize destination compression parameters from source values */
-    jpeg_copy_critical_parameters(&srcinfo, &dstinfo);
+  /* Done */
+  return tempfile;
+}
 
-    /* Adjust destination parameters if required by transform options;
-		 * also find out which set of coefficient arrays will hold the output.
-		 */
-    dst_coef_arrays = jtransform_adjust_parameters(&srcinfo, &dstinfo,
-																									 src_coef_arrays,
-																									 &transformoption);
+bool jpegTransformFile(const char* file, JXFORM_CODE trans,
+                       const JpegTransformOptions* options) {
 
-    /* Specify data destination for compression */
-    jpeg_stdio_dest(&dstinfo, output_file);
+  if (options == NULL) {
+    options = &defaultTransformOptions;
+  }
 
-    /* Start compressor (note no image data is actually written here) */
-    jpeg_write_coefficients(&dstinfo, dst_coef_arrays);
+  /* We need the original mode to give it to the new file */
+  struct stat file_stat;
+  if (stat(file, &file_stat) != 0) {
+    return false;
+  }
 
-    /* Copy to the output file any extra markers that we want to preserve */
-    jcopy_markers_execute(&srcinfo, &dstinfo, copyoption);
+  /* Output goes to the same directory so that rename is atomic */
+  FILE * output_file = NULL;
+  char* tempfile = openSiblingOutputFile(file, &output_file);
+  if (tempfile == NULL) {
+    return false;
+  }
 
-    /* Execute image transformation, if any */
-    jtransform_execute_transformation(&srcinfo, &dstinfo,
-																			src_coef_arrays,
-																			&transformoption);
+  /* Transform and close */
+  bool rc = transformFileToFile(file, output_file, trans, options);
+  if (rc) {
+    fchmod(fileno(output_file), file_stat.st_mode & 07777);
+    rc = (fsync(fileno(output_file)) == 0);
+  }
+  if (fclose(output_file) != 0) {
+    rc = false;
+  }
 
-    /* Finish compression and release memory */
-    jpeg_finish_compress(&dstinfo);
-    jpeg_destroy_compress(&dstinfo);
-    dstinfo_created = false;
-    (void) jpeg_finish_decompress(&srcinfo);
-    jpeg_destroy_decompress(&srcinfo);
-    srcinfo_created = false;
+  /* Replace original */
+  if (rc) {
+    rc = (rename(tempfile, file) == 0);
+  }
 
-    /* Close files, if we opened them */
-    fclose(input_file);
-    input_file = NULL;
-    fclose(output_file);
-    output_file = NULL;
+  /* Cleanup */
+  if (rc == false) {
+    remove(tempfile);
+  }
+  free(tempfile);
+  return rc;
+}
+
+bool jpegTransformBuffer(const unsigned char* input, unsigned long input_size,
+                         JXFORM_CODE trans, const JpegTransformOptions* options,
+                         unsigned char** output, unsigned long* output_size) {
+
+  if (input == NULL || output == NULL || output_size == NULL) {
+    return false;
+  }
+  if (options == NULL) {
+    options = &defaultTransformOptions;
+  }
+
+  JpegTransformer transformer;
+  unsigned char* buffer = NULL;
+  unsigned long buffer_size = 0;
+
+  try
+  {
+    /* Initialize the JPEG objects */
+    createTransformer(&transformer);
+
+    /* Specify data source and destination: libjpeg grows buffer as needed */
+    jpeg_mem_src(&transformer.srcinfo, input, input_size);
+    jpeg_mem_dest(&transformer.dstinfo, &buffer, &buffer_size);
+
+    /* Do it */
+    executeTransform(&transformer, trans, options);
+    destroyTransformer(&transformer);
 
     /* Done */
-    return tempfile;
+    *output = buffer;
+    *output_size = buffer_size;
+    return true;
   }
   catch (...)
   {
-    // close files
-    if (input_file != NULL)
-      fclose(input_file);
-    if (output_file != NULL)
-      fclose(output_file);
-    if (dstinfo_created)
-      jpeg_destroy_compress(&dstinfo);
-    if (srcinfo_created)
-      jpeg_destroy_decompress(&srcinfo);
-    if (tempfile != NULL) {
-      remove(tempfile);
-      free(tempfile);
-    }
-
-    // done
-    return NULL;
+    destroyTransformer(&transformer);
+    if (buffer != NULL)
+      free(buffer);
+    return false;
   }
 }
 
@@ -1,4 +1,3 @@
-
 #pragma once
 
 #ifdef __cplusplus
@@ -9,7 +8,32 @@ extern "C" {
 	#include "transupp.h"
 	#include "jhead/jhead.h"
 
+	typedef struct {
+		bool reset_orientation;   // set exif orientation to 1 while copying markers
+		bool transform_thumbnail; // apply the same transform to the exif thumbnail
+		bool optimize_coding;     // compute optimal huffman tables (jpegtran -optimize)
+		bool progressive;         // write a progressive jpeg (jpegtran -progressive)
+		bool* thumbnail_kept;     // if not NULL, set to true when the exif thumbnail
+		                          // could not be transformed and was left as is
+	} JpegTransformOptions;
+
+	// transform file into a temporary file under $TMPDIR
+	// returns the temporary file path (to be freed) or NULL
 	const char* jpegTransform(const char* file, JXFORM_CODE trans);
+
+	// transform file into a temporary file next to it and
+	// rename it over the original once fully written
+	// options may be NULL for defaults
+	bool jpegTransformFile(const char* file, JXFORM_CODE trans,
+												 const JpegTransformOptions* options);
+
+	// transform an in-memory jpeg into a malloc'ed buffer
+	// on success caller is responsible for freeing *output
+	// options may be NULL for defaults
+	bool jpegTransformBuffer(const unsigned char* input, unsigned long input_size,
+													 JXFORM_CODE trans, const JpegTransformOptions* options,
+													 unsigned char** output, unsigned long* output_size);
+
 	JXFORM_CODE exifOrientToJpegTransform(unsigned char orientation);
 	
 #ifdef __cplusplus
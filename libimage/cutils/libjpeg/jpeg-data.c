@@ -21,10 +21,13 @@
 //#include "config.h"
 #include "jpeg-data.h"
 
+#include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+#include "../jpeg_head.h"
+
 /* This refers to the exif-i18n.h file from the "exif" package and is
  * NOT to be confused with the libexif/i18n.h file.
  */
@@ -319,6 +322,26 @@ jpeg_data_load_file (JPEGData *data, const char *path)
 	free (d);
 }
 
+void
+jpeg_data_load_file_metadata (JPEGData *data, const char *path)
+{
+	JpegHead head;
+
+	if (!data) return;
+	if (!path) return;
+
+	if (!jpegReadHead (path, &head)) {
+		exif_log (data->priv->log, EXIF_LOG_CODE_CORRUPT_DATA, "jpeg-data",
+				_("Could not read '%s'."), path);
+		return;
+	}
+
+	/* Sections up to SOS only: no image data to parse */
+	jpeg_data_load_data (data, head.data,
+			     head.sos_offset ? head.sos_offset : head.size);
+	jpegFreeHead (&head);
+}
+
 void
 jpeg_data_ref (JPEGData *data)
 {
@@ -81,6 +81,9 @@ void      jpeg_data_save_data     (JPEGData *data, unsigned char **d,
 				   unsigned int *size);
 
 void      jpeg_data_load_file     (JPEGData *data, const char *path);
+/* Only reads the file head (see jpeg_head.h): sections up to SOS,
+ * no image data. Such data can not be saved back. */
+void      jpeg_data_load_file_metadata (JPEGData *data, const char *path);
 int       jpeg_data_save_file     (JPEGData *data, const char *path);
 
 void      jpeg_data_set_exif_data (JPEGData *data, ExifData *exif_data);
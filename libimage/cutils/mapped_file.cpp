@@ -0,0 +1,51 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_file.h"
+
+MappedFile::MappedFile() : fd_(-1), data_(NULL), size_(0) {
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+bool MappedFile::open(const char* path, bool writable) {
+
+	close();
+
+	fd_ = ::open(path, writable ? O_RDWR : O_RDONLY);
+	if (fd_ == -1) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd_, &st) != 0 || st.st_size <= 0) {
+		close();
+		return false;
+	}
+
+	void* mapping = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd_, 0);
+	if (mapping == MAP_FAILED) {
+		close();
+		return false;
+	}
+
+	data_ = (const unsigned char*) mapping;
+	size_ = (size_t) st.st_size;
+	return true;
+}
+
+void MappedFile::close() {
+	if (data_ != NULL) {
+		munmap((void*) data_, size_);
+		data_ = NULL;
+		size_ = 0;
+	}
+	if (fd_ != -1) {
+		::close(fd_);
+		fd_ = -1;
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+
+// read-only memory mapping of a whole file
+// pages are only read from disk when touched
+class MappedFile {
+
+public:
+	MappedFile();
+	~MappedFile();
+
+	// writable only opens the descriptor for pwrite
+	bool open(const char* path, bool writable = false);
+	void close();
+
+	const unsigned char* data() const { return data_; }
+	size_t size() const { return size_; }
+	int descriptor() const { return fd_; }
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	int fd_;
+	const unsigned char* data_;
+	size_t size_;
+};
@@ -0,0 +1,347 @@
+#include <atomic>
+
+#include "cutils.h"
+#include "metadata_utils.h"
+#include "jpeg_head.h"
+#include "jpeg_index.h"
+#include "job_scheduler.h"
+#include "mapped_file.h"
+#include "tiff_utils.h"
+
+// tags not in tiff_utils.h
+#define TAG_MAKE                  0x010F
+#define TAG_MODEL                 0x0110
+#define TAG_DATE_TIME             0x0132
+#define TAG_DATE_TIME_ORIGINAL    0x9003
+#define TAG_DATE_TIME_DIGITIZED   0x9004
+#define TAG_PIXEL_X_DIMENSION     0xA002
+#define TAG_PIXEL_Y_DIMENSION     0xA003
+#define TAG_GPS_LATITUDE_REF      0x0001
+#define TAG_GPS_LATITUDE          0x0002
+#define TAG_GPS_LONGITUDE_REF     0x0003
+#define TAG_GPS_LONGITUDE         0x0004
+#define TAG_GPS_ALTITUDE_REF      0x0005
+#define TAG_GPS_ALTITUDE          0x0006
+
+// days since 1970-01-01 of a proleptic gregorian date
+static int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+	y -= m <= 2;
+	const int64_t era = (y >= 0 ? y : y - 399) / 400;
+	const unsigned yoe = (unsigned) (y - era * 400);
+	const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + (int64_t) doe - 719468;
+}
+
+static bool parseExifDate(const char* date, int64_t* time) {
+	int year, month, day, hour, minute, second;
+	if (sscanf(date, "%4d:%2d:%2d %2d:%2d:%2d", &year, &month, &day, &hour, &minute, &second) != 6) {
+		return false;
+	}
+	if (year < 1 || month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+		return false;
+	}
+	*time = daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+	return true;
+}
+
+static void copyString(const TiffData& tiff, const TiffEntry& entry, char* buffer, size_t size) {
+	const unsigned char* value = tiff.value_data(entry);
+	if (value == NULL || entry.type != TIFF_TYPE_ASCII) {
+		return;
+	}
+	size_t length = min((size_t) entry.value_size, size - 1);
+	memcpy(buffer, value, length);
+	buffer[length] = 0;
+
+	// trailing blanks are common in make and model
+	while (length > 0 && (buffer[length - 1] == ' ' || buffer[length - 1] == 0)) {
+		buffer[--length] = 0;
+	}
+}
+
+static bool readRational(const TiffData& tiff, uint32_t offset, double* value) {
+	uint32_t denominator = tiff.get32(offset + 4);
+	if (denominator == 0) {
+		return false;
+	}
+	*value = (double) tiff.get32(offset) / denominator;
+	return true;
+}
+
+// degrees, minutes, seconds
+static bool readCoordinate(const TiffData& tiff, const TiffEntry& entry, double* value) {
+	if (entry.type != TIFF_TYPE_RATIONAL || entry.count < 3 || tiff.value_data(entry) == NULL) {
+		return false;
+	}
+	double degrees, minutes, seconds;
+	if (!readRational(tiff, entry.value_offset, &degrees) ||
+			!readRational(tiff, entry.value_offset + 8, &minutes) ||
+			!readRational(tiff, entry.value_offset + 16, &seconds)) {
+		return false;
+	}
+	*value = degrees + minutes / 60.0 + seconds / 3600.0;
+	return true;
+}
+
+// collects values while walking directories
+struct MetadataVisitor {
+
+	const TiffData& tiff;
+	ImageMetadata* metadata;
+	int date_priority;
+	char latitude_ref;
+	char longitude_ref;
+	bool has_latitude;
+	bool has_longitude;
+	unsigned char altitude_ref;
+	uint32_t exif_width;
+	uint32_t exif_height;
+	uint32_t tiff_width;
+	uint32_t tiff_height;
+	uint32_t thumbnail_offset;
+	uint32_t thumbnail_size;
+
+	MetadataVisitor(const TiffData& t, ImageMetadata* m) : tiff(t), metadata(m), date_priority(0),
+		latitude_ref('N'), longitude_ref('E'), has_latitude(false), has_longitude(false), altitude_ref(0),
+		exif_width(0), exif_height(0), tiff_width(0), tiff_height(0), thumbnail_offset(0), thumbnail_size(0) {}
+
+	bool date(const TiffEntry& entry, char* date, int64_t* time) {
+		char buffer[20] = { 0 };
+		copyString(tiff, entry, buffer, sizeof(buffer));
+		if (!parseExifDate(buffer, time)) {
+			return false;
+		}
+		memcpy(date, buffer, sizeof(buffer));
+		return true;
+	}
+
+	void captureDate(const TiffEntry& entry, int priority) {
+		if (priority > date_priority && date(entry, metadata->capture_date, &metadata->capture_time)) {
+			metadata->flags |= METADATA_HAS_CAPTURE_TIME;
+			date_priority = priority;
+		}
+	}
+
+	char ref(const TiffEntry& entry) {
+		const unsigned char* value = tiff.value_data(entry);
+		return value != NULL ? (char) value[0] : 0;
+	}
+
+	bool operator()(TiffIfdKind kind, const TiffIfd& /*ifd*/, const TiffEntry& entry) {
+		uint32_t value = 0;
+		switch (kind) {
+
+			case TIFF_IFD0:
+				switch (entry.tag) {
+					case TIFF_TAG_ORIENTATION:
+						if (tiff.value(entry, &value) && value >= 1 && value <= 8) {
+							metadata->orientation = (uint16_t) value;
+							metadata->flags |= METADATA_HAS_ORIENTATION;
+						}
+						break;
+					case TAG_MAKE:
+						copyString(tiff, entry, metadata->make, sizeof(metadata->make));
+						if (metadata->make[0]) metadata->flags |= METADATA_HAS_CAMERA;
+						break;
+					case TAG_MODEL:
+						copyString(tiff, entry, metadata->model, sizeof(metadata->model));
+						if (metadata->model[0]) metadata->flags |= METADATA_HAS_CAMERA;
+						break;
+					case TAG_DATE_TIME:
+						if (date(entry, metadata->modify_date, &metadata->modify_time)) {
+							metadata->flags |= METADATA_HAS_MODIFY_TIME;
+						}
+						break;
+					case TIFF_TAG_IMAGE_WIDTH:
+						tiff.value(entry, &tiff_width);
+						break;
+					case TIFF_TAG_IMAGE_LENGTH:
+						tiff.value(entry, &tiff_height);
+						break;
+				}
+				break;
+
+			case TIFF_IFD1:
+				if (entry.tag == TIFF_TAG_JPEG_OFFSET) {
+					tiff.value(entry, &thumbnail_offset);
+				} else if (entry.tag == TIFF_TAG_JPEG_LENGTH) {
+					tiff.value(entry, &thumbnail_size);
+				}
+				break;
+
+			case TIFF_IFD_EXIF:
+				switch (entry.tag) {
+					case TAG_DATE_TIME_ORIGINAL:
+						captureDate(entry, 2);
+						break;
+					case TAG_DATE_TIME_DIGITIZED:
+						captureDate(entry, 1);
+						break;
+					case TAG_PIXEL_X_DIMENSION:
+						tiff.value(entry, &exif_width);
+						break;
+					case TAG_PIXEL_Y_DIMENSION:
+						tiff.value(entry, &exif_height);
+						break;
+				}
+				break;
+
+			case TIFF_IFD_GPS:
+				switch (entry.tag) {
+					case TAG_GPS_LATITUDE_REF:
+						latitude_ref = ref(entry);
+						break;
+					case TAG_GPS_LATITUDE:
+						has_latitude = readCoordinate(tiff, entry, &metadata->latitude);
+						break;
+					case TAG_GPS_LONGITUDE_REF:
+						longitude_ref = ref(entry);
+						break;
+					case TAG_GPS_LONGITUDE:
+						has_longitude = readCoordinate(tiff, entry, &metadata->longitude);
+						break;
+					case TAG_GPS_ALTITUDE_REF:
+						altitude_ref = (unsigned char) ref(entry);
+						break;
+					case TAG_GPS_ALTITUDE:
+						if (entry.type == TIFF_TYPE_RATIONAL && tiff.value_data(entry) != NULL &&
+								readRational(tiff, entry.value_offset, &metadata->altitude)) {
+							metadata->flags |= METADATA_HAS_GPS_ALTITUDE;
+						}
+						break;
+				}
+				break;
+		}
+		return true;
+	}
+
+	// signs and sizes once all entries are known
+	void finish(size_t tiff_offset, bool is_tiff_file) {
+		if (has_latitude && has_longitude) {
+			if (latitude_ref == 'S') metadata->latitude = -metadata->latitude;
+			if (longitude_ref == 'W') metadata->longitude = -metadata->longitude;
+			metadata->flags |= METADATA_HAS_GPS;
+		} else {
+			metadata->latitude = 0;
+			metadata->longitude = 0;
+		}
+		if (metadata->flags & METADATA_HAS_GPS_ALTITUDE) {
+			if (altitude_ref == 1) metadata->altitude = -metadata->altitude;
+		}
+		if (thumbnail_size != 0 && tiff.contains(thumbnail_offset, thumbnail_size)) {
+			metadata->thumbnail_offset = (uint32_t) (tiff_offset + thumbnail_offset);
+			metadata->thumbnail_size = thumbnail_size;
+			metadata->flags |= METADATA_HAS_THUMBNAIL;
+		}
+		if ((metadata->flags & METADATA_HAS_SIZE) == 0) {
+			uint32_t width = is_tiff_file ? tiff_width : exif_width;
+			uint32_t height = is_tiff_file ? tiff_height : exif_height;
+			if (width != 0 && height != 0) {
+				metadata->width = width;
+				metadata->height = height;
+				metadata->flags |= METADATA_HAS_SIZE;
+			}
+		}
+	}
+};
+
+static void probeTiff(const unsigned char* data, size_t size, size_t tiff_offset, bool is_tiff_file, ImageMetadata* metadata) {
+	TiffData tiff;
+	if (tiff.open(data, size) == false) {
+		return;
+	}
+	MetadataVisitor visitor(tiff, metadata);
+	tiffWalk(tiff, visitor);
+	visitor.finish(tiff_offset, is_tiff_file);
+}
+
+// the head holds all the markers: the index gives the size
+// and the exif block is parsed in place, without another read
+static bool probeJpeg(const JpegHead* head, ImageMetadata* metadata) {
+
+	JpegIndex index;
+	if (jpegIndexBuild(head->data, head->size, &index) == false) {
+		return false;
+	}
+
+	if (index.width != 0 && index.height != 0) {
+		metadata->width = index.width;
+		metadata->height = index.height;
+		metadata->flags |= METADATA_HAS_SIZE;
+	}
+
+	const JpegSegment* segment = jpegIndexFind(&index, 0xE1, "Exif");
+	if (segment == NULL || segment->length < 2 + 6 + 8) {
+		return true;
+	}
+
+	size_t exif_offset = segment->offset + 4 + 6;
+	size_t exif_size = segment->length - 2 - 6;
+	if (exif_offset + exif_size <= head->size) {
+		probeTiff(head->data + exif_offset, exif_size, exif_offset, false, metadata);
+	}
+	return true;
+}
+
+bool probeMetadata(const char* file, ImageMetadata* metadata) {
+
+	if (metadata == NULL) {
+		return false;
+	}
+	memset(metadata, 0, sizeof(ImageMetadata));
+	metadata->orientation = 1;
+
+	// jpeg markers are all in the head: read it once without the image data
+	JpegHead head;
+	if (file != NULL && jpegReadHead(file, &head)) {
+		bool rc = probeJpeg(&head, metadata);
+		jpegFreeHead(&head);
+		return rc;
+	}
+
+	MappedFile mapping;
+	if (file == NULL || mapping.open(file) == false || mapping.size() < 4) {
+		return false;
+	}
+
+	const unsigned char* data = mapping.data();
+	if ((data[0] == 0x49 && data[1] == 0x49) || (data[0] == 0x4D && data[1] == 0x4D)) {
+		probeTiff(data, mapping.size(), 0, true, metadata);
+		return true;
+	}
+	return false;
+}
+
+struct MetadataBatch {
+	const char* const* files;
+	ImageMetadata* metadata;
+	std::atomic<size_t> succeeded;
+};
+
+static void probeItem(void* context, size_t index) {
+	MetadataBatch* batch = (MetadataBatch*) context;
+	if (probeMetadata(batch->files[index], &batch->metadata[index])) {
+		batch->succeeded.fetch_add(1);
+	} else {
+		memset(&batch->metadata[index], 0, sizeof(ImageMetadata));
+	}
+}
+
+size_t probeMetadataBatch(const char* const* files, size_t count, ImageMetadata* metadata) {
+
+	if (files == NULL || metadata == NULL || count == 0) {
+		return 0;
+	}
+
+	MetadataBatch batch;
+	batch.files = files;
+	batch.metadata = metadata;
+	batch.succeeded = 0;
+
+	// details are shown after the grid
+	JobScheduler* scheduler = jobSchedulerShared();
+	jobSchedulerRunBatch(scheduler, JOB_PRIORITY_NEAR_VISIBLE, JOB_GROUP_DEFAULT,
+											 jobSchedulerGeneration(scheduler, JOB_GROUP_DEFAULT), count, 0, probeItem, &batch);
+	return batch.succeeded.load();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	#define METADATA_HAS_CAPTURE_TIME   0x01
+	#define METADATA_HAS_SIZE           0x02
+	#define METADATA_HAS_ORIENTATION    0x04
+	#define METADATA_HAS_CAMERA         0x08
+	#define METADATA_HAS_GPS            0x10
+	#define METADATA_HAS_GPS_ALTITUDE   0x20
+	#define METADATA_HAS_THUMBNAIL      0x40
+	#define METADATA_HAS_MODIFY_TIME    0x80
+
+	// fixed-size record: can be copied and stored as is
+	typedef struct {
+		uint32_t flags;              // METADATA_HAS_* bits
+		uint32_t width;              // pixels as stored (orientation not applied)
+		uint32_t height;
+		uint16_t orientation;        // exif orientation (1 if absent)
+		char capture_date[20];       // "YYYY:MM:DD HH:MM:SS" as in exif (original, else digitized)
+		int64_t capture_time;        // capture_date in seconds since 1970 (no time zone)
+		char modify_date[20];        // ifd0 DateTime: last edit, not a capture date
+		int64_t modify_time;
+		char make[32];
+		char model[40];
+		double latitude;             // degrees, negative south
+		double longitude;            // degrees, negative west
+		double altitude;             // meters, negative below sea level
+		uint32_t thumbnail_offset;   // exif jpeg thumbnail position in file
+		uint32_t thumbnail_size;
+	} ImageMetadata;
+
+	// reads jpeg markers up to the image data (or tiff directories) once
+	// and fills metadata. returns false if the file is not jpeg nor tiff
+	bool probeMetadata(const char* file, ImageMetadata* metadata);
+
+	// probes count files into metadata[count]
+	// failed entries are zeroed. returns the number of successes
+	size_t probeMetadataBatch(const char* const* files, size_t count, ImageMetadata* metadata);
+
+#ifdef __cplusplus
+}
+#endif
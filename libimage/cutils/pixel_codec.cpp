@@ -0,0 +1,196 @@
+#include <stdint.h>
+
+#include "cutils.h"
+#include "pixel_codec.h"
+
+#define CODEC_MIN_MATCH      4
+#define CODEC_HASH_BITS      12
+#define CODEC_LAST_LITERALS  5    // block must end with literals
+#define CODEC_MATCH_LIMIT    12   // no match starts closer to the end
+#define CODEC_MAX_OFFSET     65535
+#define CODEC_SKIP_TRIGGER   6    // speeds up on incompressible data
+#define CODEC_FAST_COPY      16   // short copies done with a fixed size
+
+static uint32_t read32(const unsigned char* p) {
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static uint32_t hash32(uint32_t value) {
+	return (value * 2654435761U) >> (32 - CODEC_HASH_BITS);
+}
+
+static unsigned char* writeLength(unsigned char* op, size_t length) {
+	while (length >= 255) {
+		*op++ = 255;
+		length -= 255;
+	}
+	*op++ = (unsigned char) length;
+	return op;
+}
+
+static unsigned char* writeLiterals(unsigned char* op, const unsigned char* literals, size_t length, size_t match) {
+	*op++ = (unsigned char) ((min(length, (size_t) 15) << 4) | min(match, (size_t) 15));
+	if (length >= 15) {
+		op = writeLength(op, length - 15);
+	}
+	memcpy(op, literals, length);
+	return op + length;
+}
+
+size_t pixelCodecBound(size_t size) {
+	return size + size / 255 + 16;
+}
+
+size_t pixelCodecCompress(const unsigned char* src, size_t size, unsigned char* dst, size_t capacity) {
+
+	if (src == NULL || dst == NULL || capacity < pixelCodecBound(size)) {
+		return 0;
+	}
+
+	unsigned char* op = dst;
+	const unsigned char* anchor = src;
+
+	if (size > CODEC_MATCH_LIMIT) {
+
+		// positions of the last 4-byte sequences seen
+		uint32_t table[1 << CODEC_HASH_BITS];
+		memset(table, 0, sizeof(table));
+
+		const unsigned char* ip = src + 1;
+		const unsigned char* match_limit = src + size - CODEC_MATCH_LIMIT;
+		const unsigned char* match_end = src + size - CODEC_LAST_LITERALS;
+		unsigned int misses = 0;
+
+		while (ip < match_limit) {
+
+			uint32_t sequence = read32(ip);
+			uint32_t hash = hash32(sequence);
+			const unsigned char* ref = src + table[hash];
+			table[hash] = (uint32_t) (ip - src);
+
+			if (ref >= ip || ip - ref > CODEC_MAX_OFFSET || read32(ref) != sequence) {
+				ip += 1 + (misses++ >> CODEC_SKIP_TRIGGER);
+				continue;
+			}
+			misses = 0;
+
+			// extend backwards into pending literals then forward
+			while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+				ip--;
+				ref--;
+			}
+			const unsigned char* end = ip + CODEC_MIN_MATCH;
+			const unsigned char* from = ref + CODEC_MIN_MATCH;
+			while (end < match_end && *end == *from) {
+				end++;
+				from++;
+			}
+
+			// sequence: literals, offset, match length
+			size_t match = end - ip - CODEC_MIN_MATCH;
+			op = writeLiterals(op, anchor, ip - anchor, match);
+			size_t offset = ip - ref;
+			*op++ = (unsigned char) (offset & 0xff);
+			*op++ = (unsigned char) (offset >> 8);
+			if (match >= 15) {
+				op = writeLength(op, match - 15);
+			}
+
+			ip = end;
+			anchor = ip;
+		}
+	}
+
+	// last literals
+	op = writeLiterals(op, anchor, src + size - anchor, 0);
+	return op - dst;
+}
+
+static bool readLength(const unsigned char** ip, const unsigned char* end, size_t* length) {
+	unsigned char byte;
+	do {
+		if (*ip >= end) {
+			return false;
+		}
+		byte = *(*ip)++;
+		*length += byte;
+	} while (byte == 255);
+	return true;
+}
+
+bool pixelCodecDecompress(const unsigned char* src, size_t size, unsigned char* dst, size_t dst_size) {
+
+	if (src == NULL || dst == NULL || size == 0) {
+		return false;
+	}
+
+	const unsigned char* ip = src;
+	const unsigned char* in_end = src + size;
+	unsigned char* op = dst;
+	unsigned char* out_end = dst + dst_size;
+
+	for (;;) {
+
+		// literals
+		if (ip >= in_end) {
+			return false;
+		}
+		unsigned int token = *ip++;
+		size_t literals = token >> 4;
+		if (literals == 15 && readLength(&ip, in_end, &literals) == false) {
+			return false;
+		}
+		if (literals > (size_t) (in_end - ip) || literals > (size_t) (out_end - op)) {
+			return false;
+		}
+		if (literals <= CODEC_FAST_COPY && in_end - ip >= CODEC_FAST_COPY && out_end - op >= CODEC_FAST_COPY) {
+			memcpy(op, ip, CODEC_FAST_COPY);
+		} else {
+			memcpy(op, ip, literals);
+		}
+		op += literals;
+		ip += literals;
+
+		// last sequence has no match
+		if (ip == in_end) {
+			break;
+		}
+
+		// match
+		if (in_end - ip < 2) {
+			return false;
+		}
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (size_t) (op - dst)) {
+			return false;
+		}
+		size_t match = token & 15;
+		if (match == 15 && readLength(&ip, in_end, &match) == false) {
+			return false;
+		}
+		match += CODEC_MIN_MATCH;
+		if (match > (size_t) (out_end - op)) {
+			return false;
+		}
+
+		// overlapping copies repeat the last offset bytes:
+		// each copy doubles what can be copied next
+		const unsigned char* ref = op - offset;
+		if (offset >= CODEC_FAST_COPY && match <= CODEC_FAST_COPY && out_end - op >= CODEC_FAST_COPY) {
+			memcpy(op, ref, CODEC_FAST_COPY);
+			op += match;
+		} else {
+			while (match > 0) {
+				size_t chunk = min((size_t) (op - ref), match);
+				memcpy(op, ref, chunk);
+				op += chunk;
+				match -= chunk;
+			}
+		}
+	}
+
+	return op == out_end;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// LZ4 block format: no entropy stage, so decompression runs
+	// at memory speed. Meant for decoded pixels, not for archival
+
+	// worst case size of compressed data
+	size_t pixelCodecBound(size_t size);
+
+	// returns the compressed size or 0 if capacity < pixelCodecBound(size)
+	size_t pixelCodecCompress(const unsigned char* src, size_t size, unsigned char* dst, size_t capacity);
+
+	// dst_size must be the exact uncompressed size
+	// returns false on malformed input (never writes past dst_size)
+	bool pixelCodecDecompress(const unsigned char* src, size_t size, unsigned char* dst, size_t dst_size);
+
+#ifdef __cplusplus
+}
+#endif
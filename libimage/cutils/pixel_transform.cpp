@@ -0,0 +1,498 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PIXEL_TRANSFORM_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PIXEL_TRANSFORM_NEON
+#include <arm_neon.h>
+#endif
+
+#include "cutils.h"
+#include "pixel_transform.h"
+
+// pixels per side of the tiles transposes walk: 64 rgba rows of
+// source and destination fit together in a 32 KB L1
+#define TRANSFORM_TILE 64
+
+// transposes a block of n x n pixels: row i (at src + i * src_step)
+// becomes column i of the rows at dst + j * dst_step
+typedef void (*TransposeBlock)(const unsigned char* src, ptrdiff_t src_step, unsigned char* dst, ptrdiff_t dst_step);
+
+// dst[x] = src[width - 1 - x]
+typedef void (*ReverseRow)(const unsigned char* src, unsigned char* dst, uint32_t width);
+
+typedef struct {
+	TransposeBlock transpose;
+	uint32_t block;
+	ReverseRow reverse;
+} PixelKernels;
+
+// plain c kernels
+
+template <int BPP>
+static void transposeBlockC(const unsigned char* src, ptrdiff_t src_step, unsigned char* dst, ptrdiff_t dst_step) {
+	for (int j = 0; j < 8; j++) {
+		const unsigned char* in = src + j * BPP;
+		unsigned char* out = dst + j * dst_step;
+		for (int i = 0; i < 8; i++) {
+			memcpy(out + i * BPP, in + i * src_step, BPP);
+		}
+	}
+}
+
+template <int BPP>
+static void reverseRowC(const unsigned char* src, unsigned char* dst, uint32_t width) {
+	const unsigned char* p = src + (size_t) width * BPP;
+	for (uint32_t x = 0; x < width; x++) {
+		p -= BPP;
+		memcpy(dst + (size_t) x * BPP, p, BPP);
+	}
+}
+
+static void reverseRowGeneric(const unsigned char* src, unsigned char* dst, uint32_t width, int bpp) {
+	const unsigned char* p = src + (size_t) width * bpp;
+	for (uint32_t x = 0; x < width; x++) {
+		p -= bpp;
+		memcpy(dst + (size_t) x * bpp, p, bpp);
+	}
+}
+
+#ifdef PIXEL_TRANSFORM_X86
+
+// sse4.1 kernels: transposes are log2(n) rounds of interleaving
+// row i with row i + n / 2, which leaves column j in register j
+
+__attribute__((target("sse4.1")))
+static void transposeGraySSE4(const unsigned char* src, ptrdiff_t src_step, unsigned char* dst, ptrdiff_t dst_step) {
+	__m128i x[16], y[16];
+	for (int i = 0; i < 16; i++) {
+		x[i] = _mm_loadu_si128((const __m128i*) (src + i * src_step));
+	}
+	for (int round = 0; round < 4; round++) {
+		for (int i = 0; i < 8; i++) {
+			y[2 * i] = _mm_unpacklo_epi8(x[i], x[i + 8]);
+			y[2 * i + 1] = _mm_unpackhi_epi8(x[i], x[i + 8]);
+		}
+		for (int i = 0; i < 16; i++) {
+			x[i] = y[i];
+		}
+	}
+	for (int j = 0; j < 16; j++) {
+		_mm_storeu_si128((__m128i*) (dst + j * dst_step), x[j]);
+	}
+}
+
+__attribute__((target("sse4.1")))
+static inline void transpose4x32SSE4(__m128i* r0, __m128i* r1, __m128i* r2, __m128i* r3) {
+	__m128i t0 = _mm_unpacklo_epi32(*r0, *r2);
+	__m128i t1 = _mm_unpackhi_epi32(*r0, *r2);
+	__m128i t2 = _mm_unpacklo_epi32(*r1, *r3);
+	__m128i t3 = _mm_unpackhi_epi32(*r1, *r3);
+	*r0 = _mm_unpacklo_epi32(t0, t2);
+	*r1 = _mm_unpackhi_epi32(t0, t2);
+	*r2 = _mm_unpacklo_epi32(t1, t3);
+	*r3 = _mm_unpackhi_epi32(t1, t3);
+}
+
+__attribute__((target("sse4.1")))
+static void transposeRGBASSE4(const unsigned char* src, ptrdiff_t src_step, unsigned char* dst, ptrdiff_t dst_step) {
+	__m128i r0 = _mm_loadu_si128((const __m128i*) src);
+	__m128i r1 = _mm_loadu_si128((const __m128i*) (src + src_step));
+	__m128i r2 = _mm_loadu_si128((const __m128i*) (src + 2 * src_step));
+	__m128i r3 = _mm_loadu_si128((const __m128i*) (src + 3 * src_step));
+	transpose4x32SSE4(&r0, &r1, &r2, &r3);
+	_mm_storeu_si128((__m128i*) dst, r0);
+	_mm_storeu_si128((__m128i*) (dst + dst_step), r1);
+	_mm_storeu_si128((__m128i*) (dst + 2 * dst_step), r2);
+	_mm_storeu_si128((__m128i*) (dst + 3 * dst_step), r3);
+}
+
+// rgb pixels are padded to 32 bits in registers, without reading
+// or writing past the 12 bytes of 4 pixels
+__attribute__((target("sse4.1")))
+static inline __m128i loadRGBSSE4(const unsigned char* p) {
+	const __m128i expand = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	int32_t last;
+	memcpy(&last, p + 8, 4);
+	__m128i pixels = _mm_insert_epi32(_mm_loadl_epi64((const __m128i*) p), last, 2);
+	return _mm_shuffle_epi8(pixels, expand);
+}
+
+__attribute__((target("sse4.1")))
+static inline void storeRGBSSE4(unsigned char* p, __m128i pixels) {
+	const __m128i compress = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+	pixels = _mm_shuffle_epi8(pixels, compress);
+	_mm_storel_epi64((__m128i*) p, pixels);
+	int32_t last = _mm_extract_epi32(pixels, 2);
+	memcpy(p + 8, &last, 4);
+}
+
+__attribute__((target("sse4.1")))
+static void transposeRGBSSE4(const unsigned char* src, ptrdiff_t src_step, unsigned char* dst, ptrdiff_t dst_step) {
+	__m128i r0 = loadRGBSSE4(src);
+	__m128i r1 = loadRGBSSE4(src + src_step);
+	__m128i r2 = loadRGBSSE4(src + 2 * src_step);
+	__m128i r3 = loadRGBSSE4(src + 3 * src_step);
+	transpose4x32SSE4(&r0, &r1, &r2, &r3);
+	storeRGBSSE4(dst, r0);
+	storeRGBSSE4(dst + dst_step, r1);
+	storeRGBSSE4(dst + 2 * dst_step, r2);
+	storeRGBSSE4(dst + 3 * dst_step, r3);
+}
+
+__attribute__((target("sse4.1")))
+static void reverseGraySSE4(const unsigned char* src, unsigned char* dst, uint32_t width) {
+	const __m128i reverse = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+	uint32_t x = 0;
+	for (; x + 16 <= width; x += 16) {
+		__m128i pixels = _mm_loadu_si128((const __m128i*) (src + width - x - 16));
+		_mm_storeu_si128((__m128i*) (dst + x), _mm_shuffle_epi8(pixels, reverse));
+	}
+	reverseRowC<1>(src, dst + x, width - x);
+}
+
+__attribute__((target("sse4.1")))
+static void reverseRGBSSE4(const unsigned char* src, unsigned char* dst, uint32_t width) {
+	uint32_t x = 0;
+	for (; x + 4 <= width; x += 4) {
+		__m128i pixels = loadRGBSSE4(src + (size_t) (width - x - 4) * 3);
+		storeRGBSSE4(dst + (size_t) x * 3, _mm_shuffle_epi32(pixels, 0x1B));
+	}
+	reverseRowC<3>(src, dst + (size_t) x * 3, width - x);
+}
+
+__attribute__((target("sse4.1")))
+static void reverseRGBASSE4(const unsigned char* src, unsigned char* dst, uint32_t width) {
+	uint32_t x = 0;
+	for (; x + 4 <= width; x += 4) {
+		__m128i pixels = _mm_loadu_si128((const __m128i*) (src + (size_t) (width - x - 4) * 4));
+		_mm_storeu_si128((__m128i*) (dst + (size_t) x * 4), _mm_shuffle_epi32(pixels, 0x1B));
+	}
+	reverseRowC<4>(src, dst + (size_t) x * 4, width - x);
+}
+
+// avx2 kernels: lanes make the 8 x 8 rgba transpose two 4 x 4 ones
+// whose halves are then swapped across lanes
+
+__attribute__((target("avx2")))
+static void transposeRGBAAVX2(const unsigned char* src, ptrdiff_t src_step, unsigned char* dst, ptrdiff_t dst_step) {
+	__m256i r[8], t[8];
+	for (int i = 0; i < 8; i++) {
+		r[i] = _mm256_loadu_si256((const __m256i*) (src + i * src_step));
+	}
+	for (int i = 0; i < 8; i += 2) {
+		t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+		t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+	}
+	for (int i = 0; i < 8; i += 4) {
+		r[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+		r[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+		r[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+		r[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+	}
+	for (int j = 0; j < 4; j++) {
+		_mm256_storeu_si256((__m256i*) (dst + j * dst_step), _mm256_permute2x128_si256(r[j], r[j + 4], 0x20));
+		_mm256_storeu_si256((__m256i*) (dst + (j + 4) * dst_step), _mm256_permute2x128_si256(r[j], r[j + 4], 0x31));
+	}
+}
+
+__attribute__((target("avx2")))
+static void reverseRGBAAVX2(const unsigned char* src, unsigned char* dst, uint32_t width) {
+	const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+	uint32_t x = 0;
+	for (; x + 8 <= width; x += 8) {
+		__m256i pixels = _mm256_loadu_si256((const __m256i*) (src + (size_t) (width - x - 8) * 4));
+		_mm256_storeu_si256((__m256i*) (dst + (size_t) x * 4), _mm256_permutevar8x32_epi32(pixels, reverse));
+	}
+	reverseRGBASSE4(src, dst + (size_t) x * 4, width - x);
+}
+
+static bool supportsSSE4(void) {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse4.1");
+}
+
+static bool supportsAVX2(void) {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+#ifdef PIXEL_TRANSFORM_NEON
+
+// neon kernels: the same interleaving rounds as sse4.1 with zips
+
+static void transposeGrayNEON(const unsigned char* src, ptrdiff_t src_step, unsigned char* dst, ptrdiff_t dst_step) {
+	uint8x16_t x[16], y[16];
+	for (int i = 0; i < 16; i++) {
+		x[i] = vld1q_u8(src + i * src_step);
+	}
+	for (int round = 0; round < 4; round++) {
+		for (int i = 0; i < 8; i++) {
+			uint8x16x2_t zipped = vzipq_u8(x[i], x[i + 8]);
+			y[2 * i] = zipped.val[0];
+			y[2 * i + 1] = zipped.val[1];
+		}
+		for (int i = 0; i < 16; i++) {
+			x[i] = y[i];
+		}
+	}
+	for (int j = 0; j < 16; j++) {
+		vst1q_u8(dst + j * dst_step, x[j]);
+	}
+}
+
+static void transposeRGBANEON(const unsigned char* src, ptrdiff_t src_step, unsigned char* dst, ptrdiff_t dst_step) {
+	uint32x4_t r0 = vreinterpretq_u32_u8(vld1q_u8(src));
+	uint32x4_t r1 = vreinterpretq_u32_u8(vld1q_u8(src + src_step));
+	uint32x4_t r2 = vreinterpretq_u32_u8(vld1q_u8(src + 2 * src_step));
+	uint32x4_t r3 = vreinterpretq_u32_u8(vld1q_u8(src + 3 * src_step));
+	uint32x4x2_t t0 = vzipq_u32(r0, r2);
+	uint32x4x2_t t1 = vzipq_u32(r1, r3);
+	uint32x4x2_t c0 = vzipq_u32(t0.val[0], t1.val[0]);
+	uint32x4x2_t c1 = vzipq_u32(t0.val[1], t1.val[1]);
+	vst1q_u8(dst, vreinterpretq_u8_u32(c0.val[0]));
+	vst1q_u8(dst + dst_step, vreinterpretq_u8_u32(c0.val[1]));
+	vst1q_u8(dst + 2 * dst_step, vreinterpretq_u8_u32(c1.val[0]));
+	vst1q_u8(dst + 3 * dst_step, vreinterpretq_u8_u32(c1.val[1]));
+}
+
+static inline uint8x16_t reverseBytesNEON(uint8x16_t bytes) {
+	bytes = vrev64q_u8(bytes);
+	return vcombine_u8(vget_high_u8(bytes), vget_low_u8(bytes));
+}
+
+static void reverseGrayNEON(const unsigned char* src, unsigned char* dst, uint32_t width) {
+	uint32_t x = 0;
+	for (; x + 16 <= width; x += 16) {
+		vst1q_u8(dst + x, reverseBytesNEON(vld1q_u8(src + width - x - 16)));
+	}
+	reverseRowC<1>(src, dst + x, width - x);
+}
+
+// 16 pixels deinterleaved in planes
+static void reverseRGBNEON(const unsigned char* src, unsigned char* dst, uint32_t width) {
+	uint32_t x = 0;
+	for (; x + 16 <= width; x += 16) {
+		uint8x16x3_t pixels = vld3q_u8(src + (size_t) (width - x - 16) * 3);
+		pixels.val[0] = reverseBytesNEON(pixels.val[0]);
+		pixels.val[1] = reverseBytesNEON(pixels.val[1]);
+		pixels.val[2] = reverseBytesNEON(pixels.val[2]);
+		vst3q_u8(dst + (size_t) x * 3, pixels);
+	}
+	reverseRowC<3>(src, dst + (size_t) x * 3, width - x);
+}
+
+static void reverseRGBANEON(const unsigned char* src, unsigned char* dst, uint32_t width) {
+	uint32_t x = 0;
+	for (; x + 4 <= width; x += 4) {
+		uint32x4_t pixels = vrev64q_u32(vreinterpretq_u32_u8(vld1q_u8(src + (size_t) (width - x - 4) * 4)));
+		pixels = vcombine_u32(vget_high_u32(pixels), vget_low_u32(pixels));
+		vst1q_u8(dst + (size_t) x * 4, vreinterpretq_u8_u32(pixels));
+	}
+	reverseRowC<4>(src, dst + (size_t) x * 4, width - x);
+}
+
+#endif
+
+// dispatch
+
+static bool supportsC(void) {
+	return true;
+}
+
+typedef struct {
+	const char* name;
+	bool (*supported)(void);
+	PixelKernels gray;
+	PixelKernels rgb;
+	PixelKernels rgba;
+} TransformKernels;
+
+// best first
+static const TransformKernels transformKernels[] = {
+#ifdef PIXEL_TRANSFORM_X86
+	{ "avx2", supportsAVX2,
+		{ transposeGraySSE4, 16, reverseGraySSE4 },
+		{ transposeRGBSSE4, 4, reverseRGBSSE4 },
+		{ transposeRGBAAVX2, 8, reverseRGBAAVX2 } },
+	{ "sse4.1", supportsSSE4,
+		{ transposeGraySSE4, 16, reverseGraySSE4 },
+		{ transposeRGBSSE4, 4, reverseRGBSSE4 },
+		{ transposeRGBASSE4, 4, reverseRGBASSE4 } },
+#endif
+#ifdef PIXEL_TRANSFORM_NEON
+	{ "neon", supportsC,
+		{ transposeGrayNEON, 16, reverseGrayNEON },
+		{ transposeBlockC<3>, 8, reverseRGBNEON },
+		{ transposeRGBANEON, 4, reverseRGBANEON } },
+#endif
+	{ "c", supportsC,
+		{ transposeBlockC<1>, 8, reverseRowC<1> },
+		{ transposeBlockC<3>, 8, reverseRowC<3> },
+		{ transposeBlockC<4>, 8, reverseRowC<4> } },
+};
+
+static std::atomic<const TransformKernels*> selectedKernels(NULL);
+
+static const TransformKernels* currentKernels(void) {
+	const TransformKernels* kernels = selectedKernels.load(std::memory_order_acquire);
+	if (kernels == NULL) {
+		for (size_t i = 0; i < sizeof(transformKernels) / sizeof(transformKernels[0]); i++) {
+			if (transformKernels[i].supported()) {
+				kernels = &transformKernels[i];
+				break;
+			}
+		}
+		selectedKernels.store(kernels, std::memory_order_release);
+	}
+	return kernels;
+}
+
+static const PixelKernels* pixelKernels(int bytes_per_pixel) {
+	const TransformKernels* kernels = currentKernels();
+	switch (bytes_per_pixel) {
+		case 1: return &kernels->gray;
+		case 3: return &kernels->rgb;
+		case 4: return &kernels->rgba;
+		default: return NULL;
+	}
+}
+
+const char* pixelTransformKernels(void) {
+	return currentKernels()->name;
+}
+
+bool pixelTransformUseKernels(const char* name) {
+	if (name == NULL) {
+		return false;
+	}
+	for (size_t i = 0; i < sizeof(transformKernels) / sizeof(transformKernels[0]); i++) {
+		if (strcmp(transformKernels[i].name, name) == 0 && transformKernels[i].supported()) {
+			selectedKernels.store(&transformKernels[i], std::memory_order_release);
+			return true;
+		}
+	}
+	return false;
+}
+
+// transforms
+
+// dst (x, y) is src row x and column y, each counted from the
+// other end when flipped; tiles are done in full blocks then pixels
+static void transposeTiled(const unsigned char* src, uint32_t width, uint32_t height, size_t src_stride,
+													 unsigned char* dst, size_t dst_stride, int bpp, bool flip_rows, bool flip_columns,
+													 const PixelKernels* kernels) {
+
+	uint32_t dst_width = height;
+	uint32_t dst_height = width;
+	uint32_t n = kernels != NULL ? kernels->block : 0;
+	ptrdiff_t src_step = flip_rows ? -(ptrdiff_t) src_stride : (ptrdiff_t) src_stride;
+	ptrdiff_t dst_step = flip_columns ? -(ptrdiff_t) dst_stride : (ptrdiff_t) dst_stride;
+
+	for (uint32_t ty = 0; ty < dst_height; ty += TRANSFORM_TILE) {
+		uint32_t ty_end = min(ty + TRANSFORM_TILE, dst_height);
+		for (uint32_t tx = 0; tx < dst_width; tx += TRANSFORM_TILE) {
+			uint32_t tx_end = min(tx + TRANSFORM_TILE, dst_width);
+
+			// blocks: their lowest source column lands on their last row when flipped
+			uint32_t bx_end = tx;
+			uint32_t by_end = ty;
+			if (n != 0) {
+				bx_end = tx + (tx_end - tx) / n * n;
+				by_end = ty + (ty_end - ty) / n * n;
+			}
+			for (uint32_t y = ty; y < by_end; y += n) {
+				uint32_t column = flip_columns ? width - y - n : y;
+				uint32_t first_row = flip_columns ? y + n - 1 : y;
+				for (uint32_t x = tx; x < bx_end; x += n) {
+					uint32_t row = flip_rows ? height - 1 - x : x;
+					kernels->transpose(src + row * src_stride + (size_t) column * bpp, src_step,
+														 dst + first_row * dst_stride + (size_t) x * bpp, dst_step);
+				}
+			}
+
+			// what blocks do not cover
+			for (uint32_t y = ty; y < ty_end; y++) {
+				uint32_t column = flip_columns ? width - 1 - y : y;
+				unsigned char* out = dst + y * dst_stride;
+				for (uint32_t x = (y < by_end ? bx_end : tx); x < tx_end; x++) {
+					uint32_t row = flip_rows ? height - 1 - x : x;
+					memcpy(out + (size_t) x * bpp, src + row * src_stride + (size_t) column * bpp, bpp);
+				}
+			}
+		}
+	}
+}
+
+bool pixelTransformSwapsSize(PixelTransform transform) {
+	return transform == PIXEL_TRANSFORM_TRANSPOSE || transform == PIXEL_TRANSFORM_TRANSVERSE ||
+		transform == PIXEL_TRANSFORM_ROT_90 || transform == PIXEL_TRANSFORM_ROT_270;
+}
+
+bool pixelTransform(const unsigned char* src, uint32_t width, uint32_t height, size_t src_stride,
+										unsigned char* dst, size_t dst_stride, int bytes_per_pixel, PixelTransform transform) {
+
+	if (src == NULL || dst == NULL || width == 0 || height == 0 || bytes_per_pixel < 1 || bytes_per_pixel > 16) {
+		return false;
+	}
+	if (transform < PIXEL_TRANSFORM_NONE || transform > PIXEL_TRANSFORM_ROT_270) {
+		return false;
+	}
+	uint32_t dst_width = pixelTransformSwapsSize(transform) ? height : width;
+	if (src_stride < (size_t) width * bytes_per_pixel || dst_stride < (size_t) dst_width * bytes_per_pixel) {
+		return false;
+	}
+
+	const PixelKernels* kernels = pixelKernels(bytes_per_pixel);
+	size_t row_bytes = (size_t) width * bytes_per_pixel;
+	switch (transform) {
+
+		case PIXEL_TRANSFORM_NONE:
+		case PIXEL_TRANSFORM_FLIP_V:
+			for (uint32_t y = 0; y < height; y++) {
+				uint32_t row = transform == PIXEL_TRANSFORM_FLIP_V ? height - 1 - y : y;
+				memcpy(dst + y * dst_stride, src + row * src_stride, row_bytes);
+			}
+			break;
+
+		case PIXEL_TRANSFORM_FLIP_H:
+		case PIXEL_TRANSFORM_ROT_180:
+			for (uint32_t y = 0; y < height; y++) {
+				uint32_t row = transform == PIXEL_TRANSFORM_ROT_180 ? height - 1 - y : y;
+				if (kernels != NULL) {
+					kernels->reverse(src + row * src_stride, dst + y * dst_stride, width);
+				} else {
+					reverseRowGeneric(src + row * src_stride, dst + y * dst_stride, width, bytes_per_pixel);
+				}
+			}
+			break;
+
+		case PIXEL_TRANSFORM_TRANSPOSE:
+			transposeTiled(src, width, height, src_stride, dst, dst_stride, bytes_per_pixel, false, false, kernels);
+			break;
+
+		case PIXEL_TRANSFORM_TRANSVERSE:
+			transposeTiled(src, width, height, src_stride, dst, dst_stride, bytes_per_pixel, true, true, kernels);
+			break;
+
+		case PIXEL_TRANSFORM_ROT_90:
+			transposeTiled(src, width, height, src_stride, dst, dst_stride, bytes_per_pixel, true, false, kernels);
+			break;
+
+		case PIXEL_TRANSFORM_ROT_270:
+			transposeTiled(src, width, height, src_stride, dst, dst_stride, bytes_per_pixel, false, true, kernels);
+			break;
+
+	}
+
+	// done
+	return true;
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// lossless rotations and flips of pixel buffers: rotations and transposes
+	// go through tiles small enough to stay in cache, each tile being
+	// transposed in registers (AVX2, SSE4.1, NEON or plain C)
+
+	// same order as JXFORM_CODE
+	typedef enum {
+		PIXEL_TRANSFORM_NONE = 0,
+		PIXEL_TRANSFORM_FLIP_H,       // left-right mirror
+		PIXEL_TRANSFORM_FLIP_V,       // top-bottom mirror
+		PIXEL_TRANSFORM_TRANSPOSE,    // across the top-left to bottom-right diagonal
+		PIXEL_TRANSFORM_TRANSVERSE,   // across the other diagonal
+		PIXEL_TRANSFORM_ROT_90,       // clockwise
+		PIXEL_TRANSFORM_ROT_180,
+		PIXEL_TRANSFORM_ROT_270,
+	} PixelTransform;
+
+	// true if width and height swap
+	bool pixelTransformSwapsSize(PixelTransform transform);
+
+	// pixels are rows of stride bytes of bytes_per_pixel bytes (1 to 16)
+	// gray8, rgb8 and rgba8 (1, 3 and 4) get the simd kernels
+	// dst must not overlap src and be sized for the transformed image
+	// returns false on invalid arguments
+	bool pixelTransform(const unsigned char* src, uint32_t width, uint32_t height, size_t src_stride,
+											unsigned char* dst, size_t dst_stride, int bytes_per_pixel, PixelTransform transform);
+
+	// kernels used by pixelTransform: "avx2", "sse4.1", "neon" or "c"
+	const char* pixelTransformKernels(void);
+
+	// forces kernels by name, to compare or benchmark them
+	// returns false (and changes nothing) if the cpu lacks them
+	bool pixelTransformUseKernels(const char* name);
+
+#ifdef __cplusplus
+}
+#endif
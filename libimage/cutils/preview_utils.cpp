@@ -0,0 +1,247 @@
+#include "cutils.h"
+#include "preview_utils.h"
+#include "jpeg_index.h"
+#include "mapped_file.h"
+#include "tiff_utils.h"
+
+// CIPA DC-007 multi-picture format
+#define TAG_MPF_ENTRY          0xB002
+#define MPF_ENTRY_SIZE         16
+
+// tiff-based raw files (CR2, NEF, ARW, DNG...)
+#define TAG_COMPRESSION        0x0103
+#define TAG_STRIP_OFFSETS      0x0111
+#define TAG_STRIP_BYTE_COUNTS  0x0117
+#define TAG_SUB_IFDS           0x014A
+#define COMPRESSION_OLD_JPEG   6
+#define COMPRESSION_JPEG       7
+
+// directories visited in a raw file
+#define PREVIEW_MAX_IFDS       32
+
+static void addPreview(const unsigned char* data, size_t size, uint64_t offset, uint64_t length,
+											 uint32_t kind, uint32_t attribute,
+											 EmbeddedPreview* previews, size_t* count, size_t max_count) {
+
+	// must be a jpeg within file
+	if (*count >= max_count || length < 4 || offset > size || length > size - offset) {
+		return;
+	}
+	const unsigned char* jpeg = data + offset;
+	if (jpeg[0] != 0xFF || jpeg[1] != 0xD8) {
+		return;
+	}
+	for (size_t i = 0; i < *count; i++) {
+		if (previews[i].offset == offset) {
+			return;
+		}
+	}
+
+	// only the first segments of the preview are touched
+	// raw image data may be lossless jpeg: not a preview
+	JpegIndex index;
+	if (jpegIndexBuild(jpeg, (size_t) length, &index) && index.sof_marker == 0xC3) {
+		return;
+	}
+
+	EmbeddedPreview* preview = &previews[(*count)++];
+	memset(preview, 0, sizeof(EmbeddedPreview));
+	preview->kind = kind;
+	preview->attribute = attribute;
+	preview->offset = offset;
+	preview->length = length;
+	preview->width = index.width;
+	preview->height = index.height;
+}
+
+static void findExifThumbnail(const unsigned char* data, size_t size, const JpegIndex* index,
+															EmbeddedPreview* previews, size_t* count, size_t max_count) {
+
+	const JpegSegment* segment = jpegIndexFind(index, 0xE1, "Exif");
+	if (segment == NULL || segment->length < 2 + 6 + 8) {
+		return;
+	}
+
+	size_t tiff_offset = segment->offset + 4 + 6;
+	TiffData tiff;
+	if (tiff.open(data + tiff_offset, segment->length - 2 - 6) == false) {
+		return;
+	}
+
+	TiffIfd ifd0(tiff, tiff.ifd0());
+	TiffIfd ifd1(tiff, ifd0.next());
+	TiffEntry entry;
+	uint32_t offset, length;
+	if (ifd1.find(TIFF_TAG_JPEG_OFFSET, &entry) && tiff.value(entry, &offset) &&
+			ifd1.find(TIFF_TAG_JPEG_LENGTH, &entry) && tiff.value(entry, &length)) {
+		addPreview(data, size, tiff_offset + offset, length, PREVIEW_EXIF_THUMBNAIL, 0, previews, count, max_count);
+	}
+}
+
+static void findMpfImages(const unsigned char* data, size_t size, const JpegIndex* index,
+													EmbeddedPreview* previews, size_t* count, size_t max_count) {
+
+	const JpegSegment* segment = jpegIndexFind(index, 0xE2, "MPF");
+	if (segment == NULL || segment->length < 2 + 4 + 8) {
+		return;
+	}
+
+	// image offsets are relative to the MPF tiff header
+	size_t tiff_offset = segment->offset + 4 + 4;
+	TiffData tiff;
+	if (tiff.open(data + tiff_offset, segment->length - 2 - 4) == false) {
+		return;
+	}
+
+	TiffIfd mp_index(tiff, tiff.ifd0());
+	TiffEntry entry;
+	if (mp_index.find(TAG_MPF_ENTRY, &entry) == false || tiff.contains(entry.value_offset, entry.count) == false) {
+		return;
+	}
+
+	// first entry is the primary image (offset 0)
+	for (uint32_t i = 0; i < entry.count / MPF_ENTRY_SIZE; i++) {
+		uint32_t mp_entry = entry.value_offset + i * MPF_ENTRY_SIZE;
+		uint32_t attribute = tiff.get32(mp_entry);
+		uint32_t length = tiff.get32(mp_entry + 4);
+		uint32_t offset = tiff.get32(mp_entry + 8);
+		if (offset != 0) {
+			addPreview(data, size, tiff_offset + offset, length, PREVIEW_MPF, attribute, previews, count, max_count);
+		}
+	}
+}
+
+// jpeg previews of one directory: JPEGInterchangeFormat or a single jpeg strip
+static void findIfdPreview(const unsigned char* data, size_t size, const TiffData& tiff, const TiffIfd& ifd,
+													 EmbeddedPreview* previews, size_t* count, size_t max_count) {
+
+	TiffEntry entry;
+	uint32_t offset, length, compression;
+	if (ifd.find(TIFF_TAG_JPEG_OFFSET, &entry) && tiff.value(entry, &offset) &&
+			ifd.find(TIFF_TAG_JPEG_LENGTH, &entry) && tiff.value(entry, &length)) {
+		addPreview(data, size, offset, length, PREVIEW_RAW, 0, previews, count, max_count);
+	}
+
+	if (ifd.find(TAG_COMPRESSION, &entry) && tiff.value(entry, &compression) &&
+			(compression == COMPRESSION_OLD_JPEG || compression == COMPRESSION_JPEG) &&
+			ifd.find(TAG_STRIP_OFFSETS, &entry) && entry.count == 1 && tiff.value(entry, &offset) &&
+			ifd.find(TAG_STRIP_BYTE_COUNTS, &entry) && entry.count == 1 && tiff.value(entry, &length)) {
+		addPreview(data, size, offset, length, PREVIEW_RAW, 0, previews, count, max_count);
+	}
+}
+
+// walks the IFD chain and the SubIFDs of each directory
+static void findTiffPreviews(const unsigned char* data, size_t size,
+														 EmbeddedPreview* previews, size_t* count, size_t max_count) {
+
+	TiffData tiff;
+	if (tiff.open(data, size) == false) {
+		return;
+	}
+
+	uint32_t pending[PREVIEW_MAX_IFDS];
+	uint32_t visited[PREVIEW_MAX_IFDS];
+	size_t pending_count = 0;
+	size_t visited_count = 0;
+	pending[pending_count++] = tiff.ifd0();
+
+	while (pending_count > 0 && visited_count < PREVIEW_MAX_IFDS) {
+
+		// skip missing and looping directories
+		uint32_t offset = pending[--pending_count];
+		bool seen = (offset == 0);
+		for (size_t i = 0; i < visited_count && !seen; i++) {
+			seen = (visited[i] == offset);
+		}
+		TiffIfd ifd(tiff, offset);
+		if (seen || ifd.valid() == false) {
+			continue;
+		}
+		visited[visited_count++] = offset;
+
+		findIfdPreview(data, size, tiff, ifd, previews, count, max_count);
+
+		// next in chain then sub directories
+		if (pending_count < PREVIEW_MAX_IFDS) {
+			pending[pending_count++] = ifd.next();
+		}
+		TiffEntry entry;
+		if (ifd.find(TAG_SUB_IFDS, &entry) && tiff.contains(entry.value_offset, entry.count * 4)) {
+			for (uint32_t i = 0; i < entry.count && pending_count < PREVIEW_MAX_IFDS; i++) {
+				pending[pending_count++] = tiff.get32(entry.value_offset + i * 4);
+			}
+		}
+	}
+}
+
+size_t findEmbeddedPreviews(const unsigned char* data, size_t size,
+														EmbeddedPreview* previews, size_t max_count) {
+
+	if (data == NULL || previews == NULL || size < 8) {
+		return 0;
+	}
+
+	// raw files are tiff containers
+	size_t count = 0;
+	if ((data[0] == 0x49 && data[1] == 0x49) || (data[0] == 0x4D && data[1] == 0x4D)) {
+		findTiffPreviews(data, size, previews, &count, max_count);
+		return count;
+	}
+
+	JpegIndex index;
+	if (jpegIndexBuild(data, size, &index) == false) {
+		return 0;
+	}
+
+	findExifThumbnail(data, size, &index, previews, &count, max_count);
+	findMpfImages(data, size, &index, previews, &count, max_count);
+	return count;
+}
+
+bool openEmbeddedPreviews(const char* file, EmbeddedPreviews* previews) {
+
+	if (previews == NULL) {
+		return false;
+	}
+	memset(previews, 0, sizeof(EmbeddedPreviews));
+
+	MappedFile* mapping = new MappedFile();
+	if (file == NULL || mapping->open(file) == false) {
+		delete mapping;
+		return false;
+	}
+
+	previews->mapping = mapping;
+	previews->data = mapping->data();
+	previews->size = mapping->size();
+	previews->count = findEmbeddedPreviews(previews->data, previews->size, previews->previews, PREVIEW_MAX_COUNT);
+	if (previews->count == 0) {
+		closeEmbeddedPreviews(previews);
+		return false;
+	}
+	return true;
+}
+
+void closeEmbeddedPreviews(EmbeddedPreviews* previews) {
+	if (previews != NULL) {
+		delete (MappedFile*) previews->mapping;
+		memset(previews, 0, sizeof(EmbeddedPreviews));
+	}
+}
+
+const EmbeddedPreview* pickEmbeddedPreview(const EmbeddedPreview* previews, size_t count, unsigned int min_size) {
+
+	const EmbeddedPreview* smallest = NULL;
+	const EmbeddedPreview* largest = NULL;
+	for (size_t i = 0; i < count; i++) {
+		const EmbeddedPreview* preview = &previews[i];
+		uint32_t side = max(preview->width, preview->height);
+		if (side >= min_size && (smallest == NULL || side < max(smallest->width, smallest->height))) {
+			smallest = preview;
+		}
+		if (largest == NULL || side > max(largest->width, largest->height)) {
+			largest = preview;
+		}
+	}
+	return smallest != NULL ? smallest : largest;
+}
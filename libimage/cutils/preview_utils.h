@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	#define PREVIEW_EXIF_THUMBNAIL   1   // jpeg described by exif IFD1
+	#define PREVIEW_MPF              2   // secondary image of an APP2 MPF index
+	#define PREVIEW_RAW              3   // jpeg found in a directory of a tiff-based raw
+
+	#define PREVIEW_MAX_COUNT        8
+
+	typedef struct {
+		uint32_t kind;               // PREVIEW_*
+		uint32_t attribute;          // MPF individual image attribute (0 if not MPF)
+		uint64_t offset;             // of the jpeg SOI in file
+		uint64_t length;
+		uint32_t width;              // from the preview SOF (0 if not found)
+		uint32_t height;
+	} EmbeddedPreview;
+
+	// a mapped file and the previews found in it
+	// views (data + offset) stay valid until closeEmbeddedPreviews
+	typedef struct {
+		void* mapping;
+		const unsigned char* data;
+		size_t size;
+		size_t count;
+		EmbeddedPreview previews[PREVIEW_MAX_COUNT];
+	} EmbeddedPreviews;
+
+	// finds embedded jpeg previews in an in-memory jpeg, or in a
+	// tiff-based raw (CR2, NEF, ARW, DNG...) by following the IFD chain
+	// and SubIFDs (JPEGInterchangeFormat or single jpeg strip)
+	// returns the number of previews written (at most max_count)
+	size_t findEmbeddedPreviews(const unsigned char* data, size_t size,
+															EmbeddedPreview* previews, size_t max_count);
+
+	// maps file and finds its previews: nothing is copied
+	// returns false if the file cannot be mapped or has no preview
+	bool openEmbeddedPreviews(const char* file, EmbeddedPreviews* previews);
+	void closeEmbeddedPreviews(EmbeddedPreviews* previews);
+
+	// smallest preview whose larger side is at least min_size
+	// or the largest one if none is big enough (NULL if none)
+	const EmbeddedPreview* pickEmbeddedPreview(const EmbeddedPreview* previews, size_t count, unsigned int min_size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,148 @@
+#include "cutils.h"
+#include "raw_thumbnail.h"
+#include "pixel_codec.h"
+
+#define RAW_THUMBNAIL_MAGIC       0x31485452 // "RTH1"
+#define RAW_THUMBNAIL_MAX_SIDE    16384
+
+// payload is stored as is when compression does not pay
+#define RAW_THUMBNAIL_STORED      1
+
+typedef struct {
+	uint32_t magic;
+	uint32_t width;
+	uint32_t height;
+	uint32_t flags;
+	uint64_t payload_size;
+} RawThumbnailHeader;
+
+static bool readHeader(const unsigned char* data, size_t size, RawThumbnailHeader* header) {
+
+	if (data == NULL || size < sizeof(RawThumbnailHeader)) {
+		return false;
+	}
+	memcpy(header, data, sizeof(RawThumbnailHeader));
+	if (header->magic != RAW_THUMBNAIL_MAGIC) {
+		return false;
+	}
+	if (header->width == 0 || header->height == 0 ||
+			header->width > RAW_THUMBNAIL_MAX_SIDE || header->height > RAW_THUMBNAIL_MAX_SIDE) {
+		return false;
+	}
+	return header->payload_size == size - sizeof(RawThumbnailHeader);
+}
+
+void premultiplyRGBA(unsigned char* pixels, uint32_t width, uint32_t height, size_t stride) {
+
+	if (pixels == NULL) {
+		return;
+	}
+
+	for (uint32_t y = 0; y < height; y++) {
+		unsigned char* p = pixels + y * stride;
+		for (uint32_t x = 0; x < width; x++, p += 4) {
+			unsigned int alpha = p[3];
+			if (alpha == 255) {
+				continue;
+			}
+			// exact rounding of c * a / 255
+			for (int c = 0; c < 3; c++) {
+				unsigned int value = p[c] * alpha + 128;
+				p[c] = (unsigned char) ((value + (value >> 8)) >> 8);
+			}
+		}
+	}
+}
+
+bool rawThumbnailEncode(const unsigned char* pixels, uint32_t width, uint32_t height, size_t stride,
+												bool premultiplied, unsigned char** data, size_t* size) {
+
+	if (pixels == NULL || data == NULL || size == NULL || width == 0 || height == 0 ||
+			width > RAW_THUMBNAIL_MAX_SIDE || height > RAW_THUMBNAIL_MAX_SIDE || stride < width * 4) {
+		return false;
+	}
+
+	// tightly packed premultiplied copy
+	size_t row_size = (size_t) width * 4;
+	size_t raw_size = row_size * height;
+	unsigned char* packed = (unsigned char*) malloc(raw_size);
+	if (packed == NULL) {
+		return false;
+	}
+	for (uint32_t y = 0; y < height; y++) {
+		memcpy(packed + y * row_size, pixels + y * stride, row_size);
+	}
+	if (premultiplied == false) {
+		premultiplyRGBA(packed, width, height, row_size);
+	}
+
+	// header then payload
+	unsigned char* output = (unsigned char*) malloc(sizeof(RawThumbnailHeader) + pixelCodecBound(raw_size));
+	if (output == NULL) {
+		free(packed);
+		return false;
+	}
+	RawThumbnailHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = RAW_THUMBNAIL_MAGIC;
+	header.width = width;
+	header.height = height;
+	unsigned char* payload = output + sizeof(RawThumbnailHeader);
+	header.payload_size = pixelCodecCompress(packed, raw_size, payload, pixelCodecBound(raw_size));
+	if (header.payload_size == 0 || header.payload_size >= raw_size) {
+		memcpy(payload, packed, raw_size);
+		header.payload_size = raw_size;
+		header.flags |= RAW_THUMBNAIL_STORED;
+	}
+	memcpy(output, &header, sizeof(header));
+	free(packed);
+
+	*data = output;
+	*size = sizeof(RawThumbnailHeader) + header.payload_size;
+	return true;
+}
+
+bool rawThumbnailInfo(const unsigned char* data, size_t size, RawThumbnailInfo* info) {
+
+	RawThumbnailHeader header;
+	if (info == NULL || readHeader(data, size, &header) == false) {
+		return false;
+	}
+	info->width = header.width;
+	info->height = header.height;
+	return true;
+}
+
+bool rawThumbnailDecode(const unsigned char* data, size_t size, RawThumbnailInfo* info, unsigned char** pixels) {
+
+	RawThumbnailHeader header;
+	if (info == NULL || pixels == NULL || readHeader(data, size, &header) == false) {
+		return false;
+	}
+
+	size_t raw_size = (size_t) header.width * header.height * 4;
+	unsigned char* output = (unsigned char*) malloc(raw_size);
+	if (output == NULL) {
+		return false;
+	}
+
+	const unsigned char* payload = data + sizeof(RawThumbnailHeader);
+	bool success;
+	if (header.flags & RAW_THUMBNAIL_STORED) {
+		success = (header.payload_size == raw_size);
+		if (success) {
+			memcpy(output, payload, raw_size);
+		}
+	} else {
+		success = pixelCodecDecompress(payload, header.payload_size, output, raw_size);
+	}
+	if (success == false) {
+		free(output);
+		return false;
+	}
+
+	info->width = header.width;
+	info->height = header.height;
+	*pixels = output;
+	return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// decoded thumbnail ready to be uploaded as a texture:
+	// premultiplied rgba8, tightly packed, compressed with pixel_codec
+
+	typedef struct {
+		uint32_t width;
+		uint32_t height;
+	} RawThumbnailInfo;
+
+	// pixels are rgba8 rows of stride bytes
+	// straight alpha is premultiplied while encoding
+	// on success caller is responsible for freeing *data
+	bool rawThumbnailEncode(const unsigned char* pixels, uint32_t width, uint32_t height, size_t stride,
+													bool premultiplied, unsigned char** data, size_t* size);
+
+	// reads the header only
+	bool rawThumbnailInfo(const unsigned char* data, size_t size, RawThumbnailInfo* info);
+
+	// *pixels is width * height * 4 bytes of premultiplied rgba
+	// on success caller is responsible for freeing *pixels
+	bool rawThumbnailDecode(const unsigned char* data, size_t size, RawThumbnailInfo* info, unsigned char** pixels);
+
+	// in place, rows of stride bytes
+	void premultiplyRGBA(unsigned char* pixels, uint32_t width, uint32_t height, size_t stride);
+
+#ifdef __cplusplus
+}
+#endif
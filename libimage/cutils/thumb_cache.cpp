@@ -0,0 +1,976 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cutils.h"
+#include "thumb_cache.h"
+
+#define THUMB_CACHE_MAGIC        0x31434854 // "THC1"
+#define THUMB_CACHE_MIN_SLOTS    (64 * 1024)
+#define THUMB_CACHE_PACK_SIZE    (64 * 1024 * 1024)
+
+#define THUMB_CACHE_MAX_SLOTS    0x80000000ULL
+#define THUMB_CACHE_ACCESS_BATCH 1024      // hits recorded before writing access times
+
+// slot hash values that are not keys
+#define THUMB_CACHE_EMPTY        0
+#define THUMB_CACHE_TOMBSTONE    1
+
+// end of the recency list
+#define THUMB_CACHE_NONE         0xFFFFFFFFU
+
+// index file: header then slot_count slots, mapped read-write
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t slot_count;
+	uint64_t used;
+	uint64_t tombstones;
+	uint64_t bytes;              // thumbnail bytes referenced by live slots
+	uint32_t first_pack;         // packs in use are [first_pack, last_pack]
+	uint32_t last_pack;
+	uint64_t last_pack_size;     // append position in last_pack
+	uint8_t reserved[8];
+} ThumbCacheHeader;
+
+typedef struct {
+	uint64_t hash;               // of the whole key (or EMPTY/TOMBSTONE)
+	uint64_t path_hash;          // second hash to tell keys apart
+	int64_t mtime;
+	uint64_t file_size;
+	uint32_t px;
+	uint32_t variant;
+	uint32_t pack;
+	uint32_t offset;
+	uint32_t length;
+	uint32_t access;             // seconds since 1970 of the last hit (written in batches)
+	uint32_t checksum;           // of the thumbnail bytes
+	uint32_t reserved;
+} ThumbCacheSlot;
+
+typedef struct {
+	int fd;                      // -1 if not open
+	uint64_t size;               // bytes written, evicted entries included
+	uint64_t live;               // bytes of entries still in the index
+} ThumbCachePack;
+
+struct ThumbCache {
+	std::mutex mutex;
+	std::string directory;
+	uint64_t capacity;
+	int index_fd;
+	void* mapping;
+	size_t mapping_size;
+	ThumbCacheHeader* header;
+	ThumbCacheSlot* slots;
+	std::vector<ThumbCachePack> packs;  // by pack - first_pack
+	uint64_t disk_size;
+
+	// recency by slot index, most recent first: only in memory
+	std::vector<uint32_t> lru_prev;
+	std::vector<uint32_t> lru_next;
+	uint32_t lru_head;
+	uint32_t lru_tail;
+
+	// hits not yet written to the index: time by slot index (0 if none)
+	std::vector<uint32_t> access;
+	std::vector<uint32_t> dirty;
+};
+
+struct ThumbCacheHash {
+	uint64_t hash;
+	uint64_t path_hash;
+};
+
+static uint64_t fnv64(uint64_t hash, const void* data, size_t size) {
+	const unsigned char* p = (const unsigned char*) data;
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ p[i]) * 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static ThumbCacheHash hashKey(const ThumbCacheKey* key) {
+	uint32_t version = THUMB_CACHE_VERSION;
+	uint64_t hash = fnv64(0xcbf29ce484222325ULL, &version, sizeof(version));
+	hash = fnv64(hash, key->path, strlen(key->path));
+	hash = fnv64(hash, &key->mtime, sizeof(key->mtime));
+	hash = fnv64(hash, &key->size, sizeof(key->size));
+	hash = fnv64(hash, &key->px, sizeof(key->px));
+	hash = fnv64(hash, &key->variant, sizeof(key->variant));
+	ThumbCacheHash result;
+	result.hash = hash > THUMB_CACHE_TOMBSTONE ? hash : hash + 2;
+	result.path_hash = fnv64(0x84222325cbf29ce4ULL, key->path, strlen(key->path));
+	return result;
+}
+
+// word at a time: thumbnails are read on every hit
+static uint32_t checksumData(const unsigned char* data, size_t size) {
+	uint64_t hash = 0x9E3779B97F4A7C15ULL ^ size;
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		hash = (hash ^ word) * 0xFF51AFD7ED558CCDULL;
+		hash ^= hash >> 32;
+	}
+	for (; i < size; i++) {
+		hash = (hash ^ data[i]) * 0x100000001b3ULL;
+	}
+	return (uint32_t) (hash ^ (hash >> 32));
+}
+
+static uint32_t now() {
+	return (uint32_t) time(NULL);
+}
+
+static bool slotMatches(const ThumbCacheSlot* slot, const ThumbCacheHash& hash, const ThumbCacheKey* key) {
+	return slot->hash == hash.hash && slot->path_hash == hash.path_hash &&
+		slot->mtime == key->mtime && slot->file_size == key->size &&
+		slot->px == key->px && slot->variant == key->variant;
+}
+
+static std::string indexPath(ThumbCache* cache, const char* name) {
+	return cache->directory + "/" + name;
+}
+
+static std::string packPath(ThumbCache* cache, uint32_t pack) {
+	char name[32];
+	snprintf(name, sizeof(name), "pack-%08x", pack);
+	return cache->directory + "/" + name;
+}
+
+static size_t indexSize(uint64_t slot_count) {
+	return sizeof(ThumbCacheHeader) + (size_t) slot_count * sizeof(ThumbCacheSlot);
+}
+
+//
+// index file
+//
+
+static bool mapIndex(int fd, void** mapping, size_t* mapping_size) {
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(ThumbCacheHeader)) {
+		return false;
+	}
+
+	void* map = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		return false;
+	}
+
+	// header must describe this very file
+	ThumbCacheHeader* header = (ThumbCacheHeader*) map;
+	if (header->magic != THUMB_CACHE_MAGIC || header->version != THUMB_CACHE_VERSION ||
+			header->slot_count == 0 || indexSize(header->slot_count) != (size_t) st.st_size) {
+		munmap(map, (size_t) st.st_size);
+		return false;
+	}
+
+	*mapping = map;
+	*mapping_size = (size_t) st.st_size;
+	return true;
+}
+
+// new empty index: slots are zero (EMPTY) in a sparse file
+static int createIndex(const std::string& path, uint64_t slot_count, uint32_t first_pack) {
+
+	int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1) {
+		return -1;
+	}
+
+	ThumbCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = THUMB_CACHE_MAGIC;
+	header.version = THUMB_CACHE_VERSION;
+	header.slot_count = slot_count;
+	header.first_pack = first_pack;
+	header.last_pack = first_pack;
+	if (ftruncate(fd, (off_t) indexSize(slot_count)) != 0 ||
+			pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) {
+		close(fd);
+		unlink(path.c_str());
+		return -1;
+	}
+	return fd;
+}
+
+static void unmapIndex(ThumbCache* cache) {
+	if (cache->mapping != NULL) {
+		msync(cache->mapping, cache->mapping_size, MS_ASYNC);
+		munmap(cache->mapping, cache->mapping_size);
+		cache->mapping = NULL;
+		cache->header = NULL;
+		cache->slots = NULL;
+	}
+	if (cache->index_fd != -1) {
+		close(cache->index_fd);
+		cache->index_fd = -1;
+	}
+}
+
+static void adoptIndex(ThumbCache* cache, int fd, void* mapping, size_t mapping_size) {
+	cache->index_fd = fd;
+	cache->mapping = mapping;
+	cache->mapping_size = mapping_size;
+	cache->header = (ThumbCacheHeader*) mapping;
+	cache->slots = (ThumbCacheSlot*) ((unsigned char*) mapping + sizeof(ThumbCacheHeader));
+}
+
+// opens a freshly created index file and renames it over the current one
+static bool installIndex(ThumbCache* cache, const std::string& temp_path, int fd) {
+
+	void* mapping;
+	size_t mapping_size;
+	if (mapIndex(fd, &mapping, &mapping_size) == false) {
+		close(fd);
+		unlink(temp_path.c_str());
+		return false;
+	}
+
+	// data of the new index must be on disk before it replaces the old one
+	if (msync(mapping, mapping_size, MS_SYNC) != 0 || rename(temp_path.c_str(), indexPath(cache, "index").c_str()) != 0) {
+		munmap(mapping, mapping_size);
+		close(fd);
+		unlink(temp_path.c_str());
+		return false;
+	}
+
+	unmapIndex(cache);
+	adoptIndex(cache, fd, mapping, mapping_size);
+	return true;
+}
+
+//
+// pack files
+//
+
+static void closePacks(ThumbCache* cache) {
+	for (size_t i = 0; i < cache->packs.size(); i++) {
+		if (cache->packs[i].fd != -1) {
+			close(cache->packs[i].fd);
+			cache->packs[i].fd = -1;
+		}
+	}
+}
+
+static ThumbCachePack* packInfo(ThumbCache* cache, uint32_t pack) {
+
+	if (pack < cache->header->first_pack || pack > cache->header->last_pack) {
+		return NULL;
+	}
+	size_t index = pack - cache->header->first_pack;
+	if (index >= cache->packs.size()) {
+		ThumbCachePack empty = { -1, 0, 0 };
+		cache->packs.resize(index + 1, empty);
+	}
+	return &cache->packs[index];
+}
+
+static int packFd(ThumbCache* cache, uint32_t pack) {
+	ThumbCachePack* info = packInfo(cache, pack);
+	if (info == NULL) {
+		return -1;
+	}
+	if (info->fd == -1) {
+		info->fd = open(packPath(cache, pack).c_str(), O_RDWR | O_CREAT, 0644);
+	}
+	return info->fd;
+}
+
+// sizes of the packs in use and bytes they hold for the index
+static void loadPacks(ThumbCache* cache) {
+
+	closePacks(cache);
+	cache->packs.clear();
+	cache->disk_size = 0;
+
+	ThumbCacheHeader* header = cache->header;
+	for (uint32_t pack = header->first_pack; pack <= header->last_pack; pack++) {
+		ThumbCachePack* info = packInfo(cache, pack);
+		struct stat st;
+		if (pack == header->last_pack) {
+			info->size = header->last_pack_size;
+		} else if (stat(packPath(cache, pack).c_str(), &st) == 0) {
+			info->size = (uint64_t) st.st_size;
+		}
+		cache->disk_size += info->size;
+	}
+
+	for (uint64_t i = 0; i < header->slot_count; i++) {
+		ThumbCacheSlot* slot = &cache->slots[i];
+		ThumbCachePack* info;
+		if (slot->hash > THUMB_CACHE_TOMBSTONE && (info = packInfo(cache, slot->pack)) != NULL) {
+			info->live += slot->length;
+		}
+	}
+}
+
+// the oldest packs are deleted as soon as nothing refers to them
+// others stay until compacted (or emptied) as new data is only appended
+static void releasePacks(ThumbCache* cache) {
+
+	ThumbCacheHeader* header = cache->header;
+	while (header->first_pack < header->last_pack && cache->packs.size() > 0 && cache->packs[0].live == 0) {
+		if (cache->packs[0].fd != -1) {
+			close(cache->packs[0].fd);
+		}
+		cache->disk_size -= cache->packs[0].size;
+		unlink(packPath(cache, header->first_pack).c_str());
+		cache->packs.erase(cache->packs.begin());
+		header->first_pack++;
+	}
+
+	// the pack being appended to is emptied instead
+	ThumbCachePack* last = packInfo(cache, header->last_pack);
+	if (last->live == 0 && last->size != 0) {
+		int fd = packFd(cache, header->last_pack);
+		if (fd != -1 && ftruncate(fd, 0) == 0) {
+			cache->disk_size -= last->size;
+			last->size = 0;
+			header->last_pack_size = 0;
+		}
+	}
+}
+
+// packs outside [first_pack, last_pack] are leftovers of an interrupted
+// compaction or clear: only done when opening, never to prune
+static void removeStalePacks(ThumbCache* cache) {
+
+	DIR* dir = opendir(cache->directory.c_str());
+	if (dir == NULL) {
+		return;
+	}
+
+	struct dirent* entry;
+	while ((entry = readdir(dir)) != NULL) {
+		unsigned int pack;
+		char extra;
+		if (sscanf(entry->d_name, "pack-%8x%c", &pack, &extra) == 1 &&
+				(pack < cache->header->first_pack || pack > cache->header->last_pack)) {
+			unlink(packPath(cache, pack).c_str());
+		}
+	}
+	closedir(dir);
+}
+
+static bool writeAll(int fd, const unsigned char* data, size_t size, off_t offset) {
+	while (size > 0) {
+		ssize_t count = pwrite(fd, data, size, offset);
+		if (count <= 0) {
+			return false;
+		}
+		data += count;
+		size -= (size_t) count;
+		offset += count;
+	}
+	return true;
+}
+
+static bool readAll(int fd, unsigned char* data, size_t size, off_t offset) {
+	while (size > 0) {
+		ssize_t count = pread(fd, data, size, offset);
+		if (count <= 0) {
+			return false;
+		}
+		data += count;
+		size -= (size_t) count;
+		offset += count;
+	}
+	return true;
+}
+
+//
+// recency
+//
+
+static void resetRecency(ThumbCache* cache) {
+	size_t slot_count = (size_t) cache->header->slot_count;
+	cache->lru_prev.assign(slot_count, THUMB_CACHE_NONE);
+	cache->lru_next.assign(slot_count, THUMB_CACHE_NONE);
+	cache->lru_head = THUMB_CACHE_NONE;
+	cache->lru_tail = THUMB_CACHE_NONE;
+	cache->access.assign(slot_count, 0);
+	cache->dirty.clear();
+}
+
+static void unlinkRecent(ThumbCache* cache, uint32_t index) {
+	uint32_t prev = cache->lru_prev[index];
+	uint32_t next = cache->lru_next[index];
+	if (prev != THUMB_CACHE_NONE) {
+		cache->lru_next[prev] = next;
+	} else {
+		cache->lru_head = next;
+	}
+	if (next != THUMB_CACHE_NONE) {
+		cache->lru_prev[next] = prev;
+	} else {
+		cache->lru_tail = prev;
+	}
+	cache->lru_prev[index] = THUMB_CACHE_NONE;
+	cache->lru_next[index] = THUMB_CACHE_NONE;
+}
+
+static void pushRecent(ThumbCache* cache, uint32_t index) {
+	cache->lru_prev[index] = THUMB_CACHE_NONE;
+	cache->lru_next[index] = cache->lru_head;
+	if (cache->lru_head != THUMB_CACHE_NONE) {
+		cache->lru_prev[cache->lru_head] = index;
+	} else {
+		cache->lru_tail = index;
+	}
+	cache->lru_head = index;
+}
+
+// used when rebuilding: entries come most recent first
+static void appendRecent(ThumbCache* cache, uint32_t index) {
+	cache->lru_next[index] = THUMB_CACHE_NONE;
+	cache->lru_prev[index] = cache->lru_tail;
+	if (cache->lru_tail != THUMB_CACHE_NONE) {
+		cache->lru_next[cache->lru_tail] = index;
+	} else {
+		cache->lru_head = index;
+	}
+	cache->lru_tail = index;
+}
+
+static void flushAccess(ThumbCache* cache) {
+	if (cache->dirty.empty()) {
+		return;
+	}
+	for (size_t i = 0; i < cache->dirty.size(); i++) {
+		uint32_t index = cache->dirty[i];
+		if (cache->access[index] != 0) {
+			cache->slots[index].access = cache->access[index];
+			cache->access[index] = 0;
+		}
+	}
+	cache->dirty.clear();
+	msync(cache->mapping, cache->mapping_size, MS_ASYNC);
+}
+
+static void touchSlot(ThumbCache* cache, uint32_t index) {
+	if (cache->lru_head != index) {
+		unlinkRecent(cache, index);
+		pushRecent(cache, index);
+	}
+	if (cache->access[index] == 0) {
+		cache->dirty.push_back(index);
+	}
+	cache->access[index] = now();
+	if (cache->dirty.size() >= THUMB_CACHE_ACCESS_BATCH) {
+		flushAccess(cache);
+	}
+}
+
+static bool recentFirst(const std::pair<uint32_t, uint32_t>& a, const std::pair<uint32_t, uint32_t>& b) {
+	return a.first > b.first;
+}
+
+// from the access times stored in the index: once when opening
+static void loadRecency(ThumbCache* cache) {
+
+	resetRecency(cache);
+	std::vector<std::pair<uint32_t, uint32_t> > entries;
+	entries.reserve((size_t) cache->header->used);
+	for (uint64_t i = 0; i < cache->header->slot_count; i++) {
+		if (cache->slots[i].hash > THUMB_CACHE_TOMBSTONE) {
+			entries.push_back(std::make_pair(cache->slots[i].access, (uint32_t) i));
+		}
+	}
+	std::sort(entries.begin(), entries.end(), recentFirst);
+	for (size_t i = 0; i < entries.size(); i++) {
+		appendRecent(cache, entries[i].second);
+	}
+}
+
+//
+// slots
+//
+
+// slot holding key, or where it can be inserted (found is then false)
+static uint64_t findSlot(ThumbCacheSlot* slots, uint64_t slot_count, const ThumbCacheHash& hash,
+												 const ThumbCacheKey* key, bool* found) {
+
+	uint64_t insert = slot_count;
+	uint64_t index = hash.hash % slot_count;
+	for (uint64_t probe = 0; probe < slot_count; probe++) {
+		ThumbCacheSlot* slot = &slots[index];
+		if (slot->hash == THUMB_CACHE_EMPTY) {
+			break;
+		}
+		if (slot->hash == THUMB_CACHE_TOMBSTONE) {
+			if (insert == slot_count) {
+				insert = index;
+			}
+		} else if (key != NULL && slotMatches(slot, hash, key)) {
+			*found = true;
+			return index;
+		}
+		index = (index + 1) % slot_count;
+	}
+
+	*found = false;
+	return insert != slot_count ? insert : index;
+}
+
+// copies a live slot into an index being built (no tombstones there)
+static uint32_t insertSlot(ThumbCacheSlot* slots, uint64_t slot_count, const ThumbCacheSlot* slot) {
+	uint64_t index = slot->hash % slot_count;
+	while (slots[index].hash != THUMB_CACHE_EMPTY) {
+		index = (index + 1) % slot_count;
+	}
+	slots[index] = *slot;
+	return (uint32_t) index;
+}
+
+static void removeSlot(ThumbCache* cache, uint32_t index) {
+
+	ThumbCacheSlot* slot = &cache->slots[index];
+	ThumbCachePack* info = packInfo(cache, slot->pack);
+	if (info != NULL) {
+		info->live -= slot->length;
+	}
+	unlinkRecent(cache, index);
+	cache->access[index] = 0;
+
+	cache->header->bytes -= slot->length;
+	cache->header->used--;
+	cache->header->tombstones++;
+	memset(slot, 0, sizeof(ThumbCacheSlot));
+	slot->hash = THUMB_CACHE_TOMBSTONE;
+}
+
+// least recently used first: each eviction is constant time
+static void evict(ThumbCache* cache, uint64_t target) {
+	while (cache->header->bytes > target && cache->lru_tail != THUMB_CACHE_NONE) {
+		removeSlot(cache, cache->lru_tail);
+	}
+	releasePacks(cache);
+}
+
+// rebuilds the index with slot_count slots: drops tombstones
+static bool rehash(ThumbCache* cache, uint64_t slot_count) {
+
+	std::string temp_path = indexPath(cache, "index.tmp");
+	int fd = createIndex(temp_path, slot_count, cache->header->first_pack);
+	if (fd == -1) {
+		return false;
+	}
+
+	void* mapping;
+	size_t mapping_size;
+	if (mapIndex(fd, &mapping, &mapping_size) == false) {
+		close(fd);
+		unlink(temp_path.c_str());
+		return false;
+	}
+
+	// in recency order so that it can be rebuilt as is
+	flushAccess(cache);
+	ThumbCacheHeader* header = (ThumbCacheHeader*) mapping;
+	ThumbCacheSlot* slots = (ThumbCacheSlot*) ((unsigned char*) mapping + sizeof(ThumbCacheHeader));
+	std::vector<uint32_t> order;
+	order.reserve((size_t) cache->header->used);
+	for (uint32_t index = cache->lru_head; index != THUMB_CACHE_NONE; index = cache->lru_next[index]) {
+		order.push_back(insertSlot(slots, slot_count, &cache->slots[index]));
+	}
+	header->used = cache->header->used;
+	header->bytes = cache->header->bytes;
+	header->last_pack = cache->header->last_pack;
+	header->last_pack_size = cache->header->last_pack_size;
+	munmap(mapping, mapping_size);
+
+	if (installIndex(cache, temp_path, fd) == false) {
+		return false;
+	}
+	resetRecency(cache);
+	for (size_t i = 0; i < order.size(); i++) {
+		appendRecent(cache, order[i]);
+	}
+	return true;
+}
+
+// keeps the load factor under 70%
+static bool reserveSlot(ThumbCache* cache) {
+	ThumbCacheHeader* header = cache->header;
+	if ((header->used + header->tombstones + 1) * 10 <= header->slot_count * 7) {
+		return true;
+	}
+	uint64_t slot_count = header->slot_count;
+	if ((header->used + 1) * 2 > slot_count) {
+		slot_count *= 2;
+	}
+	if (slot_count > THUMB_CACHE_MAX_SLOTS) {
+		return false;
+	}
+	return rehash(cache, slot_count);
+}
+
+//
+// public api
+//
+
+static bool resetIndex(ThumbCache* cache, uint32_t first_pack) {
+
+	std::string temp_path = indexPath(cache, "index.tmp");
+	int fd = createIndex(temp_path, THUMB_CACHE_MIN_SLOTS, first_pack);
+	if (fd == -1) {
+		return false;
+	}
+	return installIndex(cache, temp_path, fd);
+}
+
+ThumbCache* thumbCacheOpen(const char* directory, uint64_t capacity) {
+
+	if (directory == NULL) {
+		return NULL;
+	}
+	mkdir(directory, 0755);
+
+	ThumbCache* cache = new ThumbCache();
+	cache->directory = directory;
+	cache->capacity = capacity;
+	cache->index_fd = -1;
+	cache->mapping = NULL;
+	cache->mapping_size = 0;
+	cache->header = NULL;
+	cache->slots = NULL;
+	cache->disk_size = 0;
+
+	// an unreadable or outdated index means an empty cache
+	int fd = open(indexPath(cache, "index").c_str(), O_RDWR);
+	void* mapping;
+	size_t mapping_size;
+	if (fd != -1 && mapIndex(fd, &mapping, &mapping_size) && ((ThumbCacheHeader*) mapping)->slot_count <= THUMB_CACHE_MAX_SLOTS) {
+		adoptIndex(cache, fd, mapping, mapping_size);
+	} else {
+		if (fd != -1) {
+			close(fd);
+		}
+		if (resetIndex(cache, 0) == false) {
+			delete cache;
+			return NULL;
+		}
+	}
+
+	removeStalePacks(cache);
+	loadPacks(cache);
+	loadRecency(cache);
+	return cache;
+}
+
+void thumbCacheClose(ThumbCache* cache) {
+	if (cache != NULL) {
+		flushAccess(cache);
+		closePacks(cache);
+		unmapIndex(cache);
+		delete cache;
+	}
+}
+
+// slot index of key, or THUMB_CACHE_NONE
+static uint32_t lookup(ThumbCache* cache, const ThumbCacheKey* key) {
+	bool found;
+	ThumbCacheHash hash = hashKey(key);
+	uint64_t index = findSlot(cache->slots, cache->header->slot_count, hash, key, &found);
+	return found ? (uint32_t) index : THUMB_CACHE_NONE;
+}
+
+bool thumbCacheGet(ThumbCache* cache, const ThumbCacheKey* key, unsigned char** data, size_t* size) {
+
+	if (cache == NULL || key == NULL || key->path == NULL || data == NULL || size == NULL) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(cache->mutex);
+	uint32_t index = lookup(cache, key);
+	if (index == THUMB_CACHE_NONE) {
+		return false;
+	}
+
+	ThumbCacheSlot* slot = &cache->slots[index];
+	int fd = packFd(cache, slot->pack);
+	unsigned char* buffer = (unsigned char*) malloc(slot->length);
+	if (fd == -1 || buffer == NULL) {
+		free(buffer);
+		return false;
+	}
+
+	// a torn write after a crash is a miss, never a broken thumbnail
+	if (readAll(fd, buffer, slot->length, (off_t) slot->offset) == false ||
+			checksumData(buffer, slot->length) != slot->checksum) {
+		free(buffer);
+		removeSlot(cache, index);
+		return false;
+	}
+
+	touchSlot(cache, index);
+	*data = buffer;
+	*size = slot->length;
+	return true;
+}
+
+bool thumbCacheLocate(ThumbCache* cache, const ThumbCacheKey* key, ThumbCacheLocation* location) {
+
+	if (cache == NULL || key == NULL || key->path == NULL || location == NULL) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(cache->mutex);
+	uint32_t index = lookup(cache, key);
+	if (index == THUMB_CACHE_NONE) {
+		return false;
+	}
+
+	ThumbCacheSlot* slot = &cache->slots[index];
+	std::string path = packPath(cache, slot->pack);
+	if (path.size() >= sizeof(location->path)) {
+		return false;
+	}
+
+	touchSlot(cache, index);
+	memcpy(location->path, path.c_str(), path.size() + 1);
+	location->offset = slot->offset;
+	location->length = slot->length;
+	return true;
+}
+
+bool thumbCachePut(ThumbCache* cache, const ThumbCacheKey* key, const unsigned char* data, size_t size) {
+
+	if (cache == NULL || key == NULL || key->path == NULL || data == NULL || size == 0 || size > THUMB_CACHE_PACK_SIZE) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(cache->mutex);
+	if (reserveSlot(cache) == false) {
+		return false;
+	}
+
+	// make room first: this may delete packs
+	ThumbCacheHeader* header = cache->header;
+	if (header->bytes + size > cache->capacity) {
+		uint64_t target = cache->capacity / 10 * 9;
+		evict(cache, target > size ? target - size : 0);
+	}
+
+	// start a new pack when this one is full
+	if (header->last_pack_size + size > THUMB_CACHE_PACK_SIZE) {
+		header->last_pack++;
+		header->last_pack_size = 0;
+	}
+
+	// data first: the slot is only published once it is written
+	int fd = packFd(cache, header->last_pack);
+	uint64_t offset = header->last_pack_size;
+	if (fd == -1 || writeAll(fd, data, size, (off_t) offset) == false) {
+		return false;
+	}
+	header->last_pack_size += size;
+	ThumbCachePack* info = packInfo(cache, header->last_pack);
+	info->size += size;
+	info->live += size;
+	cache->disk_size += size;
+
+	bool found;
+	ThumbCacheHash hash = hashKey(key);
+	uint32_t index = (uint32_t) findSlot(cache->slots, header->slot_count, hash, key, &found);
+	ThumbCacheSlot* slot = &cache->slots[index];
+	if (found) {
+		removeSlot(cache, index);
+	}
+	if (slot->hash == THUMB_CACHE_TOMBSTONE) {
+		header->tombstones--;
+	}
+
+	ThumbCacheSlot entry;
+	memset(&entry, 0, sizeof(entry));
+	entry.hash = hash.hash;
+	entry.path_hash = hash.path_hash;
+	entry.mtime = key->mtime;
+	entry.file_size = key->size;
+	entry.px = key->px;
+	entry.variant = key->variant;
+	entry.pack = header->last_pack;
+	entry.offset = (uint32_t) offset;
+	entry.length = (uint32_t) size;
+	entry.access = now();
+	entry.checksum = checksumData(data, size);
+	*slot = entry;
+	pushRecent(cache, index);
+
+	header->used++;
+	header->bytes += size;
+	return true;
+}
+
+bool thumbCacheRemove(ThumbCache* cache, const ThumbCacheKey* key) {
+
+	if (cache == NULL || key == NULL || key->path == NULL) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(cache->mutex);
+	uint32_t index = lookup(cache, key);
+	if (index == THUMB_CACHE_NONE) {
+		return false;
+	}
+	removeSlot(cache, index);
+	releasePacks(cache);
+	return true;
+}
+
+bool thumbCacheClear(ThumbCache* cache) {
+
+	if (cache == NULL) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(cache->mutex);
+	uint32_t first_pack = cache->header->first_pack;
+	uint32_t last_pack = cache->header->last_pack;
+	closePacks(cache);
+	bool rc = resetIndex(cache, last_pack + 1);
+	if (rc) {
+		for (uint32_t pack = first_pack; pack <= last_pack; pack++) {
+			unlink(packPath(cache, pack).c_str());
+		}
+	}
+	loadPacks(cache);
+	resetRecency(cache);
+	return rc;
+}
+
+uint64_t thumbCacheSize(ThumbCache* cache) {
+	if (cache == NULL) {
+		return 0;
+	}
+	std::lock_guard<std::mutex> lock(cache->mutex);
+	return cache->header->bytes;
+}
+
+uint64_t thumbCacheDiskSize(ThumbCache* cache) {
+	if (cache == NULL) {
+		return 0;
+	}
+	std::lock_guard<std::mutex> lock(cache->mutex);
+	return cache->disk_size;
+}
+
+void thumbCachePrune(ThumbCache* cache, uint64_t target) {
+	if (cache == NULL) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(cache->mutex);
+	evict(cache, target);
+}
+
+bool thumbCacheCompact(ThumbCache* cache) {
+
+	if (cache == NULL) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(cache->mutex);
+	ThumbCacheHeader* header = cache->header;
+	if (header->bytes > cache->capacity) {
+		evict(cache, cache->capacity / 10 * 9);
+	}
+	if (cache->disk_size <= header->bytes + cache->capacity / 10) {
+		return true;
+	}
+
+	// copy live entries most recent first into new packs and a new index
+	flushAccess(cache);
+	uint32_t old_first = header->first_pack;
+	uint32_t old_last = header->last_pack;
+	uint32_t pack = old_last + 1;
+	uint64_t pack_size = 0;
+	uint64_t slot_count = THUMB_CACHE_MIN_SLOTS;
+	while (header->used * 2 > slot_count) {
+		slot_count *= 2;
+	}
+
+	std::string temp_path = indexPath(cache, "index.tmp");
+	int fd = createIndex(temp_path, slot_count, pack);
+	void* mapping;
+	size_t mapping_size;
+	if (fd == -1 || mapIndex(fd, &mapping, &mapping_size) == false) {
+		if (fd != -1) {
+			close(fd);
+			unlink(temp_path.c_str());
+		}
+		return false;
+	}
+	ThumbCacheHeader* new_header = (ThumbCacheHeader*) mapping;
+	ThumbCacheSlot* new_slots = (ThumbCacheSlot*) ((unsigned char*) mapping + sizeof(ThumbCacheHeader));
+
+	bool rc = true;
+	int out = open(packPath(cache, pack).c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	std::vector<unsigned char> buffer;
+	std::vector<uint32_t> order;
+	order.reserve((size_t) header->used);
+	for (uint32_t index = cache->lru_head; rc && index != THUMB_CACHE_NONE; index = cache->lru_next[index]) {
+
+		ThumbCacheSlot slot = cache->slots[index];
+		int in = packFd(cache, slot.pack);
+		buffer.resize(slot.length);
+		if (in == -1 || readAll(in, &buffer[0], slot.length, (off_t) slot.offset) == false ||
+				checksumData(&buffer[0], slot.length) != slot.checksum) {
+			continue;
+		}
+
+		if (pack_size + slot.length > THUMB_CACHE_PACK_SIZE) {
+			rc = (out != -1 && fsync(out) == 0);
+			if (out != -1) {
+				close(out);
+			}
+			pack++;
+			pack_size = 0;
+			out = open(packPath(cache, pack).c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		}
+		rc = rc && out != -1 && writeAll(out, &buffer[0], slot.length, (off_t) pack_size);
+
+		slot.pack = pack;
+		slot.offset = (uint32_t) pack_size;
+		order.push_back(insertSlot(new_slots, slot_count, &slot));
+		new_header->used++;
+		new_header->bytes += slot.length;
+		pack_size += slot.length;
+	}
+	rc = rc && out != -1 && fsync(out) == 0;
+	if (out != -1) {
+		close(out);
+	}
+	new_header->last_pack = pack;
+	new_header->last_pack_size = pack_size;
+	munmap(mapping, mapping_size);
+
+	// new packs are removed when next opened if this fails
+	closePacks(cache);
+	if (rc == false || installIndex(cache, temp_path, fd) == false) {
+		if (rc == false) {
+			close(fd);
+			unlink(temp_path.c_str());
+		}
+		return false;
+	}
+	for (uint32_t old = old_first; old <= old_last; old++) {
+		unlink(packPath(cache, old).c_str());
+	}
+	loadPacks(cache);
+	resetRecency(cache);
+	for (size_t i = 0; i < order.size(); i++) {
+		appendRecent(cache, order[i]);
+	}
+	return true;
+}
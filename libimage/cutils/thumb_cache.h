@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// bump when the stored format changes: older entries are then ignored
+	#define THUMB_CACHE_VERSION 2
+
+	#define THUMB_CACHE_PATH_SIZE 1024
+
+	// identity of a thumbnail (see plans/thumbnail-cache.md)
+	typedef struct {
+		const char* path;            // absolute path of the original
+		int64_t mtime;               // modification time of the original
+		uint64_t size;               // size of the original
+		uint32_t px;                 // requested pixel size
+		uint32_t variant;            // what is stored: 0 for the thumbnail, others for data derived from it
+	} ThumbCacheKey;
+
+	// where a thumbnail lies, to be read in place
+	typedef struct {
+		char path[THUMB_CACHE_PATH_SIZE];
+		uint64_t offset;
+		uint64_t length;
+	} ThumbCacheLocation;
+
+	typedef struct ThumbCache ThumbCache;
+
+	// opens (or creates) the cache stored in directory
+	// thumbnails are appended to a few large pack files and found
+	// through an mmap'd hash index: a hit is one probe and one pread
+	// recency is kept in memory and access times are written back
+	// to the index in batches, so a hit never writes to disk
+	// capacity is the size above which least recently used entries
+	// are evicted when adding new ones (down to 90% of capacity)
+	ThumbCache* thumbCacheOpen(const char* directory, uint64_t capacity);
+	void thumbCacheClose(ThumbCache* cache);
+
+	// on success caller is responsible for freeing *data
+	bool thumbCacheGet(ThumbCache* cache, const ThumbCacheKey* key, unsigned char** data, size_t* size);
+
+	// same as a get without reading the data: the checksum is not verified
+	// data stays there until evicted or moved by thumbCacheCompact
+	bool thumbCacheLocate(ThumbCache* cache, const ThumbCacheKey* key, ThumbCacheLocation* location);
+
+	// data is written to a pack before the index entry is published
+	// so a crash never exposes a partial thumbnail
+	bool thumbCachePut(ThumbCache* cache, const ThumbCacheKey* key, const unsigned char* data, size_t size);
+
+	bool thumbCacheRemove(ThumbCache* cache, const ThumbCacheKey* key);
+
+	// removes all entries and pack files
+	bool thumbCacheClear(ThumbCache* cache);
+
+	// bytes of thumbnails currently stored
+	uint64_t thumbCacheSize(ThumbCache* cache);
+
+	// bytes of the pack files, evicted entries included
+	uint64_t thumbCacheDiskSize(ThumbCache* cache);
+
+	// evicts least recently used entries until at most target bytes are stored
+	// packs left without entries are deleted
+	void thumbCachePrune(ThumbCache* cache, uint64_t target);
+
+	// if evicted entries waste more than 10% of capacity in the packs,
+	// rewrites the others into new packs, most recently used first
+	// can take a while: to be called from a background thread
+	bool thumbCacheCompact(ThumbCache* cache);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,156 @@
+#include <math.h>
+#include <vector>
+
+#include "cutils.h"
+#include "thumb_hash.h"
+
+// DC term, AC terms normalized to [0, 1] and their scale
+typedef struct {
+	double dc;
+	std::vector<double> ac;
+	double scale;
+} ThumbHashChannel;
+
+// terms with cx * ny < nx * (ny - cy), a triangle of low frequencies
+static ThumbHashChannel encodeChannel(const std::vector<double>& channel, uint32_t width, uint32_t height,
+																			int nx, int ny) {
+
+	ThumbHashChannel encoded = { 0, std::vector<double>(), 0 };
+	std::vector<double> fx(width);
+	std::vector<double> fy(height);
+
+	for (int cy = 0; cy < ny; cy++) {
+		for (uint32_t y = 0; y < height; y++) {
+			fy[y] = cos(M_PI / height * cy * (y + 0.5));
+		}
+		for (int cx = 0; cx * ny < nx * (ny - cy); cx++) {
+			for (uint32_t x = 0; x < width; x++) {
+				fx[x] = cos(M_PI / width * cx * (x + 0.5));
+			}
+			double f = 0;
+			for (uint32_t y = 0; y < height; y++) {
+				const double* row = &channel[y * width];
+				double sum = 0;
+				for (uint32_t x = 0; x < width; x++) {
+					sum += row[x] * fx[x];
+				}
+				f += sum * fy[y];
+			}
+			f /= width * height;
+			if (cx || cy) {
+				encoded.ac.push_back(f);
+				encoded.scale = max(encoded.scale, fabs(f));
+			} else {
+				encoded.dc = f;
+			}
+		}
+	}
+
+	if (encoded.scale > 0) {
+		for (size_t i = 0; i < encoded.ac.size(); i++) {
+			encoded.ac[i] = 0.5 + 0.5 / encoded.scale * encoded.ac[i];
+		}
+	}
+	return encoded;
+}
+
+static unsigned int quantize(double value, double range) {
+	return (unsigned int) lround(range * value);
+}
+
+size_t thumbHashEncode(const unsigned char* pixels, uint32_t width, uint32_t height, size_t stride,
+											 unsigned char* hash) {
+
+	if (pixels == NULL || hash == NULL || width == 0 || height == 0 ||
+			width > THUMB_HASH_MAX_SIDE || height > THUMB_HASH_MAX_SIDE || stride < width * 4) {
+		return 0;
+	}
+
+	// average colour, pixels being premultiplied
+	size_t count = width * height;
+	double avg_r = 0, avg_g = 0, avg_b = 0, avg_a = 0;
+	for (uint32_t y = 0; y < height; y++) {
+		const unsigned char* p = pixels + y * stride;
+		for (uint32_t x = 0; x < width; x++, p += 4) {
+			avg_r += p[0] / 255.0;
+			avg_g += p[1] / 255.0;
+			avg_b += p[2] / 255.0;
+			avg_a += p[3] / 255.0;
+		}
+	}
+	if (avg_a > 0) {
+		avg_r /= avg_a;
+		avg_g /= avg_a;
+		avg_b /= avg_a;
+	}
+
+	// fewer luminance terms when alpha needs some
+	bool has_alpha = avg_a < count;
+	int l_limit = has_alpha ? 5 : 7;
+	uint32_t side = max(width, height);
+	int lx = max(1, (int) lround((double) l_limit * width / side));
+	int ly = max(1, (int) lround((double) l_limit * height / side));
+
+	// luminance, yellow - blue, red - green and alpha, composited over the average colour
+	std::vector<double> l(count), p(count), q(count), a(count);
+	size_t i = 0;
+	for (uint32_t y = 0; y < height; y++) {
+		const unsigned char* px = pixels + y * stride;
+		for (uint32_t x = 0; x < width; x++, px += 4, i++) {
+			double alpha = px[3] / 255.0;
+			double r = avg_r * (1 - alpha) + px[0] / 255.0;
+			double g = avg_g * (1 - alpha) + px[1] / 255.0;
+			double b = avg_b * (1 - alpha) + px[2] / 255.0;
+			l[i] = (r + g + b) / 3;
+			p[i] = (r + g) / 2 - b;
+			q[i] = r - g;
+			a[i] = alpha;
+		}
+	}
+
+	ThumbHashChannel l_channel = encodeChannel(l, width, height, max(3, lx), max(3, ly));
+	ThumbHashChannel p_channel = encodeChannel(p, width, height, 3, 3);
+	ThumbHashChannel q_channel = encodeChannel(q, width, height, 3, 3);
+	ThumbHashChannel a_channel = { 1, std::vector<double>(), 0 };
+	if (has_alpha) {
+		a_channel = encodeChannel(a, width, height, 5, 5);
+	}
+
+	// constants
+	bool landscape = width > height;
+	uint32_t header24 = quantize(l_channel.dc, 63) |
+		(quantize(0.5 + 0.5 * p_channel.dc, 63) << 6) |
+		(quantize(0.5 + 0.5 * q_channel.dc, 63) << 12) |
+		(quantize(l_channel.scale, 31) << 18) |
+		((has_alpha ? 1 : 0) << 23);
+	uint32_t header16 = (landscape ? ly : lx) |
+		(quantize(p_channel.scale, 63) << 3) |
+		(quantize(q_channel.scale, 63) << 9) |
+		((landscape ? 1 : 0) << 15);
+
+	memset(hash, 0, THUMB_HASH_MAX_SIZE);
+	hash[0] = header24 & 0xFF;
+	hash[1] = (header24 >> 8) & 0xFF;
+	hash[2] = (header24 >> 16) & 0xFF;
+	hash[3] = header16 & 0xFF;
+	hash[4] = (header16 >> 8) & 0xFF;
+	size_t ac_start = 5;
+	if (has_alpha) {
+		hash[5] = quantize(a_channel.dc, 15) | (quantize(a_channel.scale, 15) << 4);
+		ac_start = 6;
+	}
+
+	// varying terms, two per byte
+	const ThumbHashChannel* channels[] = { &l_channel, &p_channel, &q_channel, &a_channel };
+	size_t ac_index = 0;
+	for (int c = 0; c < (has_alpha ? 4 : 3); c++) {
+		for (size_t t = 0; t < channels[c]->ac.size(); t++, ac_index++) {
+			size_t offset = ac_start + (ac_index >> 1);
+			if (offset >= THUMB_HASH_MAX_SIZE) {
+				return 0;
+			}
+			hash[offset] |= quantize(channels[c]->ac[t], 15) << ((ac_index & 1) << 2);
+		}
+	}
+	return ac_start + ((ac_index + 1) >> 1);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// placeholder of an image in a few dozen bytes (ThumbHash format):
+	// average colour, aspect ratio and the first DCT terms of luminance,
+	// chroma and alpha, enough to paint a blurred preview
+
+	#define THUMB_HASH_MAX_SIDE 100
+	#define THUMB_HASH_MAX_SIZE 32
+
+	// pixels are premultiplied rgba8 rows of stride bytes
+	// width and height must be at most THUMB_HASH_MAX_SIDE: downscale first
+	// hash must hold THUMB_HASH_MAX_SIZE bytes
+	// returns the size of the hash, 0 on error
+	size_t thumbHashEncode(const unsigned char* pixels, uint32_t width, uint32_t height, size_t stride,
+												 unsigned char* hash);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,530 @@
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "cutils.h"
+#include "thumbnail_utils.h"
+#include "preview_utils.h"
+#include "dimension_utils.h"
+#include "jpeg_index.h"
+#include "image_resample.h"
+#include "pixel_transform.h"
+#include "jpeglib.h"
+
+#define THUMBNAIL_PYRAMID_MAGIC 0x31595054 // "TPY1"
+
+// This procedure is called by the IJPEG library when an error occurs.
+static void error_exit (j_common_ptr pcinfo) {
+  throw 1;
+}
+
+struct Pixels {
+  std::vector<unsigned char> data;
+  unsigned int width;
+  unsigned int height;
+  int components;
+  J_COLOR_SPACE color_space;
+};
+
+// smallest scale_num (over 8) giving an image still covering max_size
+static unsigned int pickScaleNum(unsigned int width, unsigned int height, unsigned int max_size) {
+  unsigned int largest = max(width, height);
+  for (unsigned int num = 1; num < 8; num++) {
+    if ((largest * num + 7) / 8 >= max_size) {
+      return num;
+    }
+  }
+  return 8;
+}
+
+static void decodeScaled(j_decompress_ptr srcinfo, unsigned int max_size, Pixels* pixels) {
+
+  /* Read file header */
+  (void) jpeg_read_header(srcinfo, TRUE);
+
+  /* We can only produce gray or rgb */
+  if (srcinfo->jpeg_color_space == JCS_CMYK || srcinfo->jpeg_color_space == JCS_YCCK) {
+    throw 1;
+  }
+  srcinfo->out_color_space = (srcinfo->num_components == 1) ? JCS_GRAYSCALE : JCS_RGB;
+
+  /* Let the IDCT do most of the downscaling */
+  srcinfo->scale_num = pickScaleNum(srcinfo->image_width, srcinfo->image_height, max_size);
+  srcinfo->scale_denom = 8;
+  srcinfo->dct_method = JDCT_ISLOW;
+  jpeg_calc_output_dimensions(srcinfo);
+
+  /* Decode */
+  (void) jpeg_start_decompress(srcinfo);
+  pixels->width = srcinfo->output_width;
+  pixels->height = srcinfo->output_height;
+  pixels->components = srcinfo->output_components;
+  pixels->color_space = srcinfo->out_color_space;
+  size_t stride = (size_t) pixels->width * pixels->components;
+  pixels->data.resize(stride * pixels->height);
+  while (srcinfo->output_scanline < srcinfo->output_height) {
+    JSAMPROW rows[4];
+    int count = 0;
+    for (; count < 4 && srcinfo->output_scanline + count < srcinfo->output_height; count++) {
+      rows[count] = &pixels->data[(srcinfo->output_scanline + count) * stride];
+    }
+    (void) jpeg_read_scanlines(srcinfo, rows, count);
+  }
+  (void) jpeg_finish_decompress(srcinfo);
+}
+
+// area-averaging, same weights and rounding whatever the cpu
+static void areaDownscale(const Pixels* src, unsigned int width, unsigned int height, Pixels* dst) {
+
+  dst->width = width;
+  dst->height = height;
+  dst->components = src->components;
+  dst->color_space = src->color_space;
+  dst->data.resize((size_t) width * height * src->components);
+
+  if (!imageResample(&src->data[0], src->width, src->height, (size_t) src->width * src->components,
+                     &dst->data[0], width, height, (size_t) width * src->components,
+                     src->components, IMAGE_RESAMPLE_BOX)) {
+    throw 1;
+  }
+}
+
+static void encode(const Pixels* pixels, int quality, unsigned char** output, unsigned long* output_size) {
+
+  struct jpeg_compress_struct dstinfo;
+  struct jpeg_error_mgr jdsterr;
+  bool dstinfo_created = false;
+
+  try
+  {
+    dstinfo.err = jpeg_std_error(&jdsterr);
+    jdsterr.error_exit = error_exit;
+    jpeg_create_compress(&dstinfo);
+    dstinfo_created = true;
+
+    jpeg_mem_dest(&dstinfo, output, output_size);
+    dstinfo.image_width = pixels->width;
+    dstinfo.image_height = pixels->height;
+    dstinfo.input_components = pixels->components;
+    dstinfo.in_color_space = pixels->color_space;
+    jpeg_set_defaults(&dstinfo);
+    jpeg_set_quality(&dstinfo, quality, TRUE);
+    dstinfo.optimize_coding = TRUE;
+
+    jpeg_start_compress(&dstinfo, TRUE);
+    size_t stride = (size_t) pixels->width * pixels->components;
+    while (dstinfo.next_scanline < dstinfo.image_height) {
+      JSAMPROW row = (JSAMPROW) &pixels->data[dstinfo.next_scanline * stride];
+      (void) jpeg_write_scanlines(&dstinfo, &row, 1);
+    }
+    jpeg_finish_compress(&dstinfo);
+    jpeg_destroy_compress(&dstinfo);
+  }
+  catch (...)
+  {
+    if (dstinfo_created)
+      jpeg_destroy_compress(&dstinfo);
+    throw;
+  }
+}
+
+// exif orientation as the transform making the image upright
+static PixelTransform orientationTransform(uint16_t orientation) {
+  switch (orientation) {
+    case 2: return PIXEL_TRANSFORM_FLIP_H;
+    case 3: return PIXEL_TRANSFORM_ROT_180;
+    case 4: return PIXEL_TRANSFORM_FLIP_V;
+    case 5: return PIXEL_TRANSFORM_TRANSPOSE;
+    case 6: return PIXEL_TRANSFORM_ROT_90;
+    case 7: return PIXEL_TRANSFORM_TRANSVERSE;
+    case 8: return PIXEL_TRANSFORM_ROT_270;
+    default: return PIXEL_TRANSFORM_NONE;
+  }
+}
+
+static void orient(Pixels* pixels, PixelTransform transform) {
+
+  if (transform == PIXEL_TRANSFORM_NONE) {
+    return;
+  }
+
+  bool swaps = pixelTransformSwapsSize(transform);
+  unsigned int width = swaps ? pixels->height : pixels->width;
+  unsigned int height = swaps ? pixels->width : pixels->height;
+  std::vector<unsigned char> data(pixels->data.size());
+  if (!pixelTransform(&pixels->data[0], pixels->width, pixels->height, (size_t) pixels->width * pixels->components,
+                      &data[0], (size_t) width * pixels->components, pixels->components, transform)) {
+    throw 1;
+  }
+  pixels->data.swap(data);
+  pixels->width = width;
+  pixels->height = height;
+}
+
+// fits width x height in max_size x max_size (never upscales)
+static void fitSize(unsigned int width, unsigned int height, unsigned int max_size,
+                    unsigned int* fit_width, unsigned int* fit_height) {
+  if (width > max_size || height > max_size) {
+    if (width >= height) {
+      height = max(1U, (unsigned int) (((unsigned long long) height * max_size + width / 2) / width));
+      width = max_size;
+    } else {
+      width = max(1U, (unsigned int) (((unsigned long long) width * max_size + height / 2) / height));
+      height = max_size;
+    }
+  }
+  *fit_width = width;
+  *fit_height = height;
+}
+
+// source manager must be set up by caller
+static bool thumbnail(j_decompress_ptr srcinfo, unsigned int max_size, int quality,
+                      unsigned char** output, unsigned long* output_size) {
+
+  unsigned char* buffer = NULL;
+  unsigned long buffer_size = 0;
+
+  try
+  {
+    /* Decode at reduced size */
+    Pixels decoded;
+    decodeScaled(srcinfo, max_size, &decoded);
+
+    /* Final size */
+    unsigned int width, height;
+    fitSize(decoded.width, decoded.height, max_size, &width, &height);
+
+    /* Downscale and encode */
+    if (width != decoded.width || height != decoded.height) {
+      Pixels resized;
+      areaDownscale(&decoded, width, height, &resized);
+      encode(&resized, quality, &buffer, &buffer_size);
+    } else {
+      encode(&decoded, quality, &buffer, &buffer_size);
+    }
+
+    /* Done */
+    *output = buffer;
+    *output_size = buffer_size;
+    return true;
+  }
+  catch (...)
+  {
+    if (buffer != NULL)
+      free(buffer);
+    return false;
+  }
+}
+
+// largest level first: each one is area-averaged from the previous
+// which is much cheaper than from the decoded image and as accurate
+// the largest level is oriented, so all of them are
+static bool pyramid(j_decompress_ptr srcinfo, const unsigned int* sizes, size_t count, int quality,
+                    PixelTransform transform, unsigned char** output, unsigned long* output_size) {
+
+  std::vector<unsigned int> ordered(sizes, sizes + count);
+  std::sort(ordered.begin(), ordered.end(), std::greater<unsigned int>());
+
+  std::vector<unsigned char*> images;
+  std::vector<unsigned long> lengths;
+  bool rc = false;
+
+  try
+  {
+    /* Decode once at reduced size */
+    Pixels previous;
+    decodeScaled(srcinfo, ordered[0], &previous);
+
+    for (size_t i = 0; i < ordered.size(); i++) {
+
+      /* Small images give identical levels */
+      unsigned int width, height;
+      fitSize(previous.width, previous.height, ordered[i], &width, &height);
+      if (images.empty() == false && width == previous.width && height == previous.height) {
+        continue;
+      }
+
+      Pixels level;
+      if (width != previous.width || height != previous.height) {
+        areaDownscale(&previous, width, height, &level);
+        previous.data.swap(level.data);
+        previous.width = width;
+        previous.height = height;
+      }
+      if (i == 0) {
+        orient(&previous, transform);
+      }
+
+      /* Owned by images even if encoding fails */
+      unsigned long length = 0;
+      images.push_back(NULL);
+      encode(&previous, quality, &images.back(), &length);
+      lengths.push_back(length);
+    }
+
+    /* Pack smallest first */
+    std::reverse(images.begin(), images.end());
+    std::reverse(lengths.begin(), lengths.end());
+    rc = thumbnailPyramidPack(&images[0], &lengths[0], images.size(), output, output_size);
+  }
+  catch (...)
+  {
+    rc = false;
+  }
+
+  for (size_t i = 0; i < images.size(); i++) {
+    free(images[i]);
+  }
+  return rc;
+}
+
+// one jpeg fitting in sizes[0] or a pyramid of all sizes
+static bool thumbnailFromSource(FILE* input_file, const unsigned char* input, unsigned long input_size,
+                                const unsigned int* sizes, size_t count, bool pack, int quality,
+                                PixelTransform transform, unsigned char** output, unsigned long* output_size) {
+
+  struct jpeg_decompress_struct srcinfo;
+  struct jpeg_error_mgr jsrcerr;
+
+  if (sizes == NULL || count == 0 || count > THUMBNAIL_PYRAMID_MAX_LEVELS || output == NULL || output_size == NULL) {
+    return false;
+  }
+  for (size_t i = 0; i < count; i++) {
+    if (sizes[i] == 0) {
+      return false;
+    }
+  }
+
+  try
+  {
+    srcinfo.err = jpeg_std_error(&jsrcerr);
+    jsrcerr.error_exit = error_exit;
+    jpeg_create_decompress(&srcinfo);
+  }
+  catch (...)
+  {
+    return false;
+  }
+
+  bool rc = false;
+  try
+  {
+    if (input_file != NULL) {
+      jpeg_stdio_src(&srcinfo, input_file);
+    } else {
+      jpeg_mem_src(&srcinfo, input, input_size);
+    }
+    if (pack) {
+      rc = pyramid(&srcinfo, sizes, count, quality, transform, output, output_size);
+    } else {
+      rc = thumbnail(&srcinfo, sizes[0], quality, output, output_size);
+    }
+  }
+  catch (...)
+  {
+    rc = false;
+  }
+
+  jpeg_destroy_decompress(&srcinfo);
+  return rc;
+}
+
+static bool thumbnailFromFile(const char* file, const unsigned int* sizes, size_t count, bool pack, int quality,
+                              PixelTransform transform, unsigned char** output, unsigned long* output_size) {
+
+  FILE* input_file = fopen(file, "rb");
+  if (input_file == NULL) {
+    return false;
+  }
+
+  bool rc = thumbnailFromSource(input_file, NULL, 0, sizes, count, pack, quality, transform, output, output_size);
+  fclose(input_file);
+  return rc;
+}
+
+// an embedded preview covering max_size with the aspect of the image
+// for raw files (which cannot be decoded here) the best one always is
+static const EmbeddedPreview* usablePreview(EmbeddedPreviews* previews, unsigned int max_size) {
+
+  JpegIndex index;
+  const EmbeddedPreview* preview = pickEmbeddedPreview(previews->previews, previews->count, max_size);
+  bool is_raw = (preview != NULL && preview->kind == PREVIEW_RAW);
+  bool usable = is_raw || (preview != NULL && max(preview->width, preview->height) >= max_size &&
+                           jpegIndexBuild(previews->data, previews->size, &index) && index.width != 0 && index.height != 0);
+
+  // some cameras letterbox their previews: aspect must match the image
+  if (usable && is_raw == false) {
+    double image_ratio = (double) index.width / index.height;
+    double preview_ratio = (double) preview->width / preview->height;
+    usable = (fabs(image_ratio - preview_ratio) <= image_ratio / 100);
+  }
+
+  return usable ? preview : NULL;
+}
+
+bool jpegThumbnail(const char* file, unsigned int max_size, int quality,
+                   unsigned char** output, unsigned long* output_size) {
+  return thumbnailFromFile(file, &max_size, 1, false, quality, PIXEL_TRANSFORM_NONE, output, output_size);
+}
+
+bool jpegThumbnailBuffer(const unsigned char* input, unsigned long input_size,
+                         unsigned int max_size, int quality,
+                         unsigned char** output, unsigned long* output_size) {
+
+  if (input == NULL) {
+    return false;
+  }
+
+  return thumbnailFromSource(NULL, input, input_size, &max_size, 1, false, quality, PIXEL_TRANSFORM_NONE,
+                             output, output_size);
+}
+
+bool jpegPreviewThumbnail(const char* file, unsigned int max_size, int quality,
+                          unsigned char** output, unsigned long* output_size) {
+
+  // a large enough embedded preview is much cheaper to decode
+  EmbeddedPreviews previews;
+  if (openEmbeddedPreviews(file, &previews)) {
+    const EmbeddedPreview* preview = usablePreview(&previews, max_size);
+    bool rc = preview != NULL && jpegThumbnailBuffer(previews.data + preview->offset, (unsigned long) preview->length,
+                                                     max_size, quality, output, output_size);
+    closeEmbeddedPreviews(&previews);
+    if (rc) {
+      return true;
+    }
+  }
+
+  return jpegThumbnail(file, max_size, quality, output, output_size);
+}
+
+//
+// pyramids
+//
+
+typedef struct {
+  uint32_t magic;
+  uint32_t count;
+  ThumbnailLevel levels[THUMBNAIL_PYRAMID_MAX_LEVELS];
+} ThumbnailPyramidHeader;
+
+// embedded previews share the orientation of the image
+static PixelTransform fileOrientation(const char* file) {
+  ImageDimensions dimensions;
+  return probeDimensions(file, &dimensions) ? orientationTransform(dimensions.orientation) : PIXEL_TRANSFORM_NONE;
+}
+
+bool jpegThumbnailPyramid(const char* file, const unsigned int* sizes, size_t count, int quality,
+                          unsigned char** output, unsigned long* output_size) {
+  return thumbnailFromFile(file, sizes, count, true, quality, fileOrientation(file), output, output_size);
+}
+
+bool jpegPreviewPyramid(const char* file, const unsigned int* sizes, size_t count, int quality,
+                        unsigned char** output, unsigned long* output_size) {
+
+  if (sizes == NULL || count == 0) {
+    return false;
+  }
+
+  // the preview must cover the largest level
+  unsigned int largest = *std::max_element(sizes, sizes + count);
+  PixelTransform transform = fileOrientation(file);
+  EmbeddedPreviews previews;
+  if (openEmbeddedPreviews(file, &previews)) {
+    const EmbeddedPreview* preview = usablePreview(&previews, largest);
+    bool rc = preview != NULL && thumbnailFromSource(NULL, previews.data + preview->offset, (unsigned long) preview->length,
+                                                     sizes, count, true, quality, transform, output, output_size);
+    closeEmbeddedPreviews(&previews);
+    if (rc) {
+      return true;
+    }
+  }
+
+  return thumbnailFromFile(file, sizes, count, true, quality, transform, output, output_size);
+}
+
+bool thumbnailPyramidPack(const unsigned char* const* images, const unsigned long* lengths, size_t count,
+                          unsigned char** output, unsigned long* output_size) {
+
+  if (images == NULL || lengths == NULL || count == 0 || count > THUMBNAIL_PYRAMID_MAX_LEVELS ||
+      output == NULL || output_size == NULL) {
+    return false;
+  }
+
+  // levels describe themselves
+  ThumbnailPyramidHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = THUMBNAIL_PYRAMID_MAGIC;
+  header.count = (uint32_t) count;
+  unsigned long long offset = sizeof(header);
+  for (size_t i = 0; i < count; i++) {
+    ImageDimensions dimensions;
+    if (images[i] == NULL || probeDimensionsData(images[i], lengths[i], &dimensions) == false ||
+        dimensions.width == 0 || dimensions.height == 0) {
+      return false;
+    }
+    if (i > 0 && max(dimensions.width, dimensions.height) <= max(header.levels[i - 1].width, header.levels[i - 1].height)) {
+      return false;
+    }
+    header.levels[i].width = dimensions.width;
+    header.levels[i].height = dimensions.height;
+    header.levels[i].offset = (uint32_t) offset;
+    header.levels[i].length = (uint32_t) lengths[i];
+    offset += lengths[i];
+    if (offset > UINT32_MAX) {
+      return false;
+    }
+  }
+
+  // header then images
+  unsigned char* buffer = (unsigned char*) malloc((size_t) offset);
+  if (buffer == NULL) {
+    return false;
+  }
+  memcpy(buffer, &header, sizeof(header));
+  for (size_t i = 0; i < count; i++) {
+    memcpy(buffer + header.levels[i].offset, images[i], lengths[i]);
+  }
+
+  *output = buffer;
+  *output_size = (unsigned long) offset;
+  return true;
+}
+
+size_t thumbnailPyramidLevels(const unsigned char* data, size_t size, unsigned long long total_size,
+                              ThumbnailLevel* levels) {
+
+  ThumbnailPyramidHeader header;
+  if (data == NULL || levels == NULL || size < sizeof(header)) {
+    return 0;
+  }
+  memcpy(&header, data, sizeof(header));
+  if (header.magic != THUMBNAIL_PYRAMID_MAGIC || header.count == 0 || header.count > THUMBNAIL_PYRAMID_MAX_LEVELS) {
+    return 0;
+  }
+  for (uint32_t i = 0; i < header.count; i++) {
+    const ThumbnailLevel* level = &header.levels[i];
+    if (level->offset < sizeof(header) || (unsigned long long) level->offset + level->length > total_size) {
+      return 0;
+    }
+  }
+
+  memcpy(levels, header.levels, header.count * sizeof(ThumbnailLevel));
+  return header.count;
+}
+
+const ThumbnailLevel* pickThumbnailLevel(const ThumbnailLevel* levels, size_t count, unsigned int px) {
+
+  if (levels == NULL || count == 0) {
+    return NULL;
+  }
+
+  // levels are ascending
+  for (size_t i = 0; i < count; i++) {
+    if (max(levels[i].width, levels[i].height) >= px) {
+      return &levels[i];
+    }
+  }
+  return &levels[count - 1];
+}
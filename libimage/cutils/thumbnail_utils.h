@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// creates a jpeg thumbnail fitting in max_size x max_size
+	// the source is decoded at the smallest DCT scale (1/8 to 1)
+	// still covering max_size then area-averaged to the final size
+	// exif orientation is not applied and no metadata is written
+	// on success caller is responsible for freeing *output
+	bool jpegThumbnail(const char* file, unsigned int max_size, int quality,
+										 unsigned char** output, unsigned long* output_size);
+
+	// same as jpegThumbnail on an in-memory jpeg
+	bool jpegThumbnailBuffer(const unsigned char* input, unsigned long input_size,
+													 unsigned int max_size, int quality,
+													 unsigned char** output, unsigned long* output_size);
+
+	// same as jpegThumbnail but decodes an embedded preview (exif or MPF)
+	// instead of the image when one covers max_size with the same aspect
+	// for tiff-based raw files the best raw preview is always used
+	bool jpegPreviewThumbnail(const char* file, unsigned int max_size, int quality,
+														unsigned char** output, unsigned long* output_size);
+
+	// a pyramid is one buffer holding a few jpegs of the same image:
+	// a header of THUMBNAIL_PYRAMID_HEADER_SIZE bytes then the levels
+	#define THUMBNAIL_PYRAMID_MAX_LEVELS   4
+	#define THUMBNAIL_PYRAMID_HEADER_SIZE  72
+
+	typedef struct {
+		uint32_t width;
+		uint32_t height;
+		uint32_t offset;             // of the encoded level in the pyramid
+		uint32_t length;
+	} ThumbnailLevel;
+
+	// one level per size (fitting in size x size) from a single scaled
+	// decode covering the largest: each level is then area-averaged from
+	// the next larger one. levels that would be upscaled are merged
+	// unlike jpegThumbnail the exif orientation is applied to the levels
+	// which carry no metadata (nor icc profile)
+	// on success caller is responsible for freeing *output
+	bool jpegThumbnailPyramid(const char* file, const unsigned int* sizes, size_t count, int quality,
+														unsigned char** output, unsigned long* output_size);
+
+	// same as jpegThumbnailPyramid but decodes an embedded preview
+	// if one covers the largest size (see jpegPreviewThumbnail)
+	bool jpegPreviewPyramid(const char* file, const unsigned int* sizes, size_t count, int quality,
+													unsigned char** output, unsigned long* output_size);
+
+	// packs already encoded levels (jpeg or png) given smallest first
+	// on success caller is responsible for freeing *output
+	bool thumbnailPyramidPack(const unsigned char* const* images, const unsigned long* lengths, size_t count,
+														unsigned char** output, unsigned long* output_size);
+
+	// reads the levels (smallest first) from the first size bytes of a
+	// pyramid of total_size bytes. returns the level count (0 if invalid)
+	size_t thumbnailPyramidLevels(const unsigned char* data, size_t size, unsigned long long total_size,
+																ThumbnailLevel* levels);
+
+	// smallest level whose larger side is at least px, or the largest
+	const ThumbnailLevel* pickThumbnailLevel(const ThumbnailLevel* levels, size_t count, unsigned int px);
+
+#ifdef __cplusplus
+}
+#endif
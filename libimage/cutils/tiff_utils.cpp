@@ -0,0 +1,147 @@
+#include "tiff_utils.h"
+
+static uint32_t typeSize(uint16_t type) {
+	switch (type) {
+		case TIFF_TYPE_BYTE:
+		case TIFF_TYPE_ASCII:
+		case TIFF_TYPE_UNDEFINED:
+		case 6: // SBYTE
+			return 1;
+		case TIFF_TYPE_SHORT:
+		case 8: // SSHORT
+			return 2;
+		case TIFF_TYPE_LONG:
+		case TIFF_TYPE_SLONG:
+		case 11: // FLOAT
+		case TIFF_TYPE_IFD:
+			return 4;
+		case TIFF_TYPE_RATIONAL:
+		case TIFF_TYPE_SRATIONAL:
+		case 12: // DOUBLE
+			return 8;
+		default:
+			return 0;
+	}
+}
+
+bool TiffData::open(const unsigned char* data, size_t size) {
+
+	data_ = NULL;
+	size_ = 0;
+	if (data == NULL || size < 8) {
+		return false;
+	}
+
+	// offsets are 32 bits
+	if (size > 0xFFFFFFFFu) {
+		size = 0xFFFFFFFFu;
+	}
+
+	// discover byte order
+	if (data[0] == 0x49 && data[1] == 0x49) {
+		little_endian_ = true;
+	} else if (data[0] == 0x4D && data[1] == 0x4D) {
+		little_endian_ = false;
+	} else {
+		return false;
+	}
+
+	// check tag mark
+	data_ = data;
+	size_ = size;
+	if (get16(2) != 0x2A) {
+		data_ = NULL;
+		size_ = 0;
+		return false;
+	}
+
+	// first ifd
+	ifd0_ = get32(4);
+	return true;
+}
+
+bool TiffData::value(const TiffEntry& entry, uint32_t* value) const {
+	if (entry.count == 0 || entry.value_size == 0 || !contains(entry.value_offset, 4)) {
+		return false;
+	}
+	switch (entry.type) {
+		case TIFF_TYPE_SHORT:
+			*value = get16(entry.value_offset);
+			return true;
+		case TIFF_TYPE_LONG:
+		case TIFF_TYPE_IFD:
+			*value = get32(entry.value_offset);
+			return true;
+		default:
+			return false;
+	}
+}
+
+const unsigned char* TiffData::value_data(const TiffEntry& entry) const {
+	if (entry.value_size == 0 || !contains(entry.value_offset, entry.value_size)) {
+		return NULL;
+	}
+	return data_ + entry.value_offset;
+}
+
+TiffIfd::TiffIfd(const TiffData& tiff, uint32_t offset) : tiff_(tiff), offset_(offset), count_(0) {
+
+	// directory is after header, count and entries must fit
+	if (offset < 8 || !tiff.contains(offset, 2)) {
+		return;
+	}
+	uint16_t count = tiff.get16(offset);
+	if (!tiff.contains(offset + 2, (uint32_t) count * 12)) {
+		return;
+	}
+	count_ = count;
+}
+
+bool TiffIfd::entry(uint16_t index, TiffEntry* entry) const {
+
+	if (index >= count_) {
+		return false;
+	}
+
+	uint32_t offset = offset_ + 2 + (uint32_t) index * 12;
+	entry->tag = tiff_.get16(offset);
+	entry->type = tiff_.get16(offset + 2);
+	entry->count = tiff_.get32(offset + 4);
+	entry->offset = offset;
+
+	// values up to 4 bytes are stored inline
+	uint64_t size = (uint64_t) typeSize(entry->type) * entry->count;
+	if (size > 0xFFFFFFFFu) {
+		size = 0;
+	}
+	entry->value_size = (uint32_t) size;
+	entry->value_offset = (size <= 4) ? offset + 8 : tiff_.get32(offset + 8);
+	return true;
+}
+
+bool TiffIfd::find(uint16_t tag, TiffEntry* entry) const {
+	for (uint16_t i = 0; i < count_; i++) {
+		if (tiff_.get16(offset_ + 2 + (uint32_t) i * 12) == tag) {
+			return this->entry(i, entry);
+		}
+	}
+	return false;
+}
+
+uint32_t TiffIfd::next() const {
+	uint32_t offset = offset_ + 2 + (uint32_t) count_ * 12;
+	if (count_ == 0 || !tiff_.contains(offset, 4)) {
+		return 0;
+	}
+	uint32_t next = tiff_.get32(offset);
+	return (next == offset_) ? 0 : next;
+}
+
+uint32_t TiffIfd::sub_ifd(uint16_t tag) const {
+	TiffEntry entry;
+	uint32_t value;
+	if (find(tag, &entry) && tiff_.value(entry, &value) && value != offset_) {
+		return value;
+	}
+	return 0;
+}
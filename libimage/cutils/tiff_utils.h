@@ -0,0 +1,153 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// tags
+#define TIFF_TAG_IMAGE_WIDTH   0x0100
+#define TIFF_TAG_IMAGE_LENGTH  0x0101
+#define TIFF_TAG_ORIENTATION   0x0112
+#define TIFF_TAG_JPEG_OFFSET   0x0201
+#define TIFF_TAG_JPEG_LENGTH   0x0202
+#define TIFF_TAG_EXIF_IFD      0x8769
+#define TIFF_TAG_GPS_IFD       0x8825
+
+// field types
+#define TIFF_TYPE_BYTE         1
+#define TIFF_TYPE_ASCII        2
+#define TIFF_TYPE_SHORT        3
+#define TIFF_TYPE_LONG         4
+#define TIFF_TYPE_RATIONAL     5
+#define TIFF_TYPE_UNDEFINED    7
+#define TIFF_TYPE_SLONG        9
+#define TIFF_TYPE_SRATIONAL    10
+#define TIFF_TYPE_IFD          13
+
+template<bool LittleEndian> struct TiffEndian;
+
+template<> struct TiffEndian<true> {
+	static inline uint16_t get16(const unsigned char* p) { return (uint16_t) (p[0] | (p[1] << 8)); }
+	static inline uint32_t get32(const unsigned char* p) { return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24); }
+	static inline void put16(unsigned char* p, uint16_t v) { p[0] = (unsigned char) v; p[1] = (unsigned char) (v >> 8); }
+	static inline void put32(unsigned char* p, uint32_t v) { put16(p, (uint16_t) v); put16(p + 2, (uint16_t) (v >> 16)); }
+};
+
+template<> struct TiffEndian<false> {
+	static inline uint16_t get16(const unsigned char* p) { return (uint16_t) ((p[0] << 8) | p[1]); }
+	static inline uint32_t get32(const unsigned char* p) { return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | (uint32_t) p[3]; }
+	static inline void put16(unsigned char* p, uint16_t v) { p[0] = (unsigned char) (v >> 8); p[1] = (unsigned char) v; }
+	static inline void put32(unsigned char* p, uint32_t v) { put16(p, (uint16_t) (v >> 16)); put16(p + 2, (uint16_t) v); }
+};
+
+// one 12-byte directory entry
+// offsets are relative to the tiff header
+struct TiffEntry {
+	uint16_t tag;
+	uint16_t type;
+	uint32_t count;
+	uint32_t offset;        // of the entry itself
+	uint32_t value_offset;  // of the value (inline or pointed to)
+	uint32_t value_size;    // 0 if type is unknown
+};
+
+// view over a tiff block (tiff file or exif payload)
+// does not own nor copy data
+class TiffData {
+
+public:
+	TiffData() : data_(NULL), size_(0), little_endian_(false), ifd0_(0) {}
+
+	// checks header: fails if data is not tiff
+	bool open(const unsigned char* data, size_t size);
+
+	const unsigned char* data() const { return data_; }
+	size_t size() const { return size_; }
+	bool little_endian() const { return little_endian_; }
+	uint32_t ifd0() const { return ifd0_; }
+
+	// callers must check bounds first
+	uint16_t get16(uint32_t offset) const { return little_endian_ ? TiffEndian<true>::get16(data_ + offset) : TiffEndian<false>::get16(data_ + offset); }
+	uint32_t get32(uint32_t offset) const { return little_endian_ ? TiffEndian<true>::get32(data_ + offset) : TiffEndian<false>::get32(data_ + offset); }
+	void put16(unsigned char* p, uint16_t v) const { if (little_endian_) TiffEndian<true>::put16(p, v); else TiffEndian<false>::put16(p, v); }
+	void put32(unsigned char* p, uint32_t v) const { if (little_endian_) TiffEndian<true>::put32(p, v); else TiffEndian<false>::put32(p, v); }
+
+	bool contains(uint32_t offset, uint32_t length) const { return offset <= size_ && length <= size_ - offset; }
+
+	// first value of a SHORT or LONG entry
+	bool value(const TiffEntry& entry, uint32_t* value) const;
+
+	// pointer to value bytes if within data
+	const unsigned char* value_data(const TiffEntry& entry) const;
+
+private:
+	const unsigned char* data_;
+	size_t size_;
+	bool little_endian_;
+	uint32_t ifd0_;
+};
+
+// bounds-checked iterator over one directory
+class TiffIfd {
+
+public:
+	TiffIfd(const TiffData& tiff, uint32_t offset);
+
+	bool valid() const { return count_ != 0; }
+	uint32_t offset() const { return offset_; }
+	uint16_t count() const { return count_; }
+
+	bool entry(uint16_t index, TiffEntry* entry) const;
+	bool find(uint16_t tag, TiffEntry* entry) const;
+
+	// offset of the next directory (0 if none)
+	uint32_t next() const;
+
+	// offset of the directory referenced by tag (0 if none)
+	uint32_t sub_ifd(uint16_t tag) const;
+
+private:
+	const TiffData& tiff_;
+	uint32_t offset_;
+	uint16_t count_;
+};
+
+enum TiffIfdKind {
+	TIFF_IFD0,
+	TIFF_IFD1,
+	TIFF_IFD_EXIF,
+	TIFF_IFD_GPS
+};
+
+// calls visitor(kind, ifd, entry) for each entry of IFD0, IFD1, Exif and GPS
+// visitor returns false to stop walking. nothing is allocated
+template<typename Visitor>
+void tiffWalk(const TiffData& tiff, Visitor& visitor) {
+
+	TiffIfd ifd0(tiff, tiff.ifd0());
+	if (ifd0.valid() == false) {
+		return;
+	}
+
+	uint32_t offsets[4] = { ifd0.offset(), ifd0.next(), ifd0.sub_ifd(TIFF_TAG_EXIF_IFD), ifd0.sub_ifd(TIFF_TAG_GPS_IFD) };
+	TiffIfdKind kinds[4] = { TIFF_IFD0, TIFF_IFD1, TIFF_IFD_EXIF, TIFF_IFD_GPS };
+
+	for (int i = 0; i < 4; i++) {
+
+		// skip missing and looping directories
+		bool seen = (offsets[i] == 0);
+		for (int j = 0; j < i && !seen; j++) {
+			seen = (offsets[j] == offsets[i]);
+		}
+		if (seen) {
+			continue;
+		}
+
+		TiffIfd ifd(tiff, offsets[i]);
+		TiffEntry entry;
+		for (uint16_t e = 0; e < ifd.count(); e++) {
+			if (ifd.entry(e, &entry) && visitor(kinds[i], ifd, entry) == false) {
+				return;
+			}
+		}
+	}
+}
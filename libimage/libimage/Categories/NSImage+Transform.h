@@ -8,6 +8,7 @@
 
 #import <Cocoa/Cocoa.h>
 #import "cutils/jpeg_utils.h"
+#import "cutils/pixel_transform.h"
 
 typedef enum {
 	ImageTransformationRotate90CW,
@@ -18,6 +19,7 @@ typedef enum {
 } ImageTransformation;
 
 JXFORM_CODE imageTransformToJpegTransform(ImageTransformation transform);
+PixelTransform imageTransformToPixelTransform(ImageTransformation transform);
 
 @interface NSImage (Transform)
 
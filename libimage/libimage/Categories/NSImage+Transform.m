@@ -31,6 +31,28 @@ JXFORM_CODE imageTransformToJpegTransform(ImageTransformation transform) {
 	return JXFORM_NONE;
 }
 
+PixelTransform imageTransformToPixelTransform(ImageTransformation transform) {
+	
+	switch (transform) {
+		case ImageTransformationRotate90CW:
+			return PIXEL_TRANSFORM_ROT_90;
+			
+		case ImageTransformationRotate90CCW:
+			return PIXEL_TRANSFORM_ROT_270;
+			
+		case ImageTransformationRotate180:
+			return PIXEL_TRANSFORM_ROT_180;
+			
+		case ImageTransformationFlipHorizontal:
+			return PIXEL_TRANSFORM_FLIP_H;
+			
+		case ImageTransformationFlipVertical:
+			return PIXEL_TRANSFORM_FLIP_V;
+	}
+	
+	return PIXEL_TRANSFORM_NONE;
+}
+
 @implementation NSImage (Transform)
 
 //
@@ -8,6 +8,8 @@
 
 #import "BitmapImage.h"
 #import "ImageUtils.h"
+#import "image_resample.h"
+#import "pixel_transform.h"
 
 @implementation BitmapImage
 
@@ -104,6 +106,19 @@
 	// result
 	BitmapImage* result = [[BitmapImage alloc] initLikeBitmapImage:self width:size.width height:size.height];
 	
+	// meshed 8-bit samples (alpha premultiplied) are resampled directly
+	NSInteger samples = self.samplesPerPixel;
+	NSBitmapFormat unsupported = NSBitmapFormatFloatingPointSamples | NSBitmapFormatAlphaNonpremultiplied;
+	if (self.bitsPerSample == 8 && self.isPlanar == NO && self.bitsPerPixel == samples * 8 &&
+			(samples == 1 || samples == 3 || samples == 4) && (self.bitmapFormat & unsupported) == 0) {
+		ImageResampleFilter filter = (result.width <= self.width && result.height <= self.height) ? IMAGE_RESAMPLE_BOX : IMAGE_RESAMPLE_LANCZOS3;
+		if (imageResample(self.bitmapData, (uint32_t) self.width, (uint32_t) self.height, self.bytesPerRow,
+											result.bitmapData, (uint32_t) result.width, (uint32_t) result.height, result.bytesPerRow,
+											(int) samples, filter)) {
+			return result;
+		}
+	}
+	
 	// set offscreen context
 	NSGraphicsContext *g = [NSGraphicsContext graphicsContextWithBitmapImageRep:result];
 	[g setImageInterpolation:NSImageInterpolationHigh];
@@ -141,6 +156,14 @@
 																																width:width
 																															 height:height];
 	
+	// meshed whole-byte pixels are moved directly
+	if (self.isPlanar == NO && self.bitsPerPixel % 8 == 0 &&
+			pixelTransform(self.bitmapData, (uint32_t) self.width, (uint32_t) self.height, self.bytesPerRow,
+										 transformed.bitmapData, transformed.bytesPerRow, (int) self.bytesPerPixel,
+										 imageTransformToPixelTransform(transform))) {
+		return transformed;
+	}
+	
 	// try to build the graphics context now as it may fails
 	NSGraphicsContext* context = [NSGraphicsContext graphicsContextWithBitmapImageRep:transformed];
 	if (context != nil) {
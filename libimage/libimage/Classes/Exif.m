@@ -16,15 +16,30 @@
 #import "NSFileManager+Utils.h"
 #import "NSImage+MGCropExtensions.h"
 #import "cutils/libjpeg/jpeg-data.h"
+#import "cutils/preview_utils.h"
 
 #define EXIF_THUMBNAIL_JPEG_COMPRESSION 0.7
 
+// jpegs: only the file head is read (see jpeg-data.h)
+// other files go through the libexif loader
+static ExifData* exifDataFromFile(NSString* file) {
+	JPEGData* jdata = jpeg_data_new();
+	jpeg_data_load_file_metadata(jdata, [file UTF8String]);
+	BOOL isJpeg = (jdata != NULL && jdata->count != 0);
+	ExifData* exifData = jpeg_data_get_exif_data(jdata);
+	jpeg_data_unref(jdata);
+	if (exifData == NULL && !isJpeg) {
+		exifData = exif_data_new_from_file([file UTF8String]);
+	}
+	return exifData;
+}
+
 @implementation Exif
 
 - (id) initWithExifFile:(NSString*) file {
 	self = [super init];
 	if (self != nil) {
-		exifData = exif_data_new_from_file([file UTF8String]);
+		exifData = exifDataFromFile(file);
 	}
 	return self;
 }
@@ -84,27 +99,25 @@
 	}
 	
 	//
-	// it failed: now try with exif library
+	// it failed: now try with embedded previews (exif or MPF)
 	//
 	
 	// the thumbnail
 	NSImage* exifThumbnail = nil;
 	
-	// load exif from file
-	ExifData* exifData = exif_data_new_from_file([file UTF8String]);
-	if (exifData != nil) {
-
-		// check thumbnail
-		if (exifData->data && exifData->size) {
+	// map file: only the preview bytes are read
+	EmbeddedPreviews previews;
+	if (openEmbeddedPreviews([file UTF8String], &previews)) {
 		
-			// get it
-			NSData* data = [NSData dataWithBytes:exifData->data length:exifData->size];
+		// smallest one covering the thumbnail size
+		const EmbeddedPreview* preview = pickEmbeddedPreview(previews.previews, previews.count, 256);
+		if (preview != NULL) {
+			NSData* data = [NSData dataWithBytes:previews.data + preview->offset length:(NSUInteger) preview->length];
 			exifThumbnail = [[NSImage alloc] initWithData:data];
-			
 		}
 		
 		// free
-		exif_data_unref(exifData);
+		closeEmbeddedPreviews(&previews);
 	}
 	
 	// done
@@ -113,7 +126,7 @@
 
 + (BOOL) updateExifThumbnail:(NSString*) file {
 		
-	ExifData* exifData = exif_data_new_from_file([file UTF8String]);
+	ExifData* exifData = exifDataFromFile(file);
 	if (exifData != nil) {
 	
 		// clear previous one
@@ -13,14 +13,46 @@
 + (BOOL) looksLikeJpeg:(NSString*) path;
 + (BOOL) looksLikePng:(NSString*) path;
 
+// persistent jpeg marker index (see jpeg_index.h) stored in directory
+// without it every orientation or metadata read rescans the markers
++ (BOOL) openJpegIndexCacheIn:(NSString*) directory;
++ (void) closeJpegIndexCache;
+
 + (CGSize) getImageSize:(NSString*) path;
 
 + (NSDate*) getCreationDateForImage:(NSString*) file;
 + (NSDate*) getCreationDateForImage:(NSString*) file atDate:(NSDate*) now;
 
+// header-only probe of many files in batches (see metadata_utils.h and
+// dimension_utils.h): one dictionary per path, with "captureDate" and
+// "width" and "height" (orientation applied) when found
++ (NSArray<NSDictionary*>*) probeImages:(NSArray<NSString*>*) paths;
+
 + (NSImage*) getThumbnail:(NSString*) path;
 
+// premultiplied rgba8 thumbnails (see raw_thumbnail.h)
++ (NSData*) encodeRawThumbnail:(CGImageRef) image;
++ (NSData*) decodeRawThumbnail:(NSData*) data width:(int*) width height:(int*) height;
+
+// premultiplied rgba8 copy at width x height (see image_resample.h)
++ (CGImageRef) resampleImage:(CGImageRef) image width:(size_t) width height:(size_t) height CF_RETURNS_RETAINED;
+
+// placeholder of a few dozen bytes (see thumb_hash.h)
++ (NSData*) thumbHashForImage:(CGImageRef) image;
+
+// thumbnail pyramids (see thumbnail_utils.h): levels smallest first
++ (NSData*) packThumbnailPyramid:(NSArray<NSData*>*) levels;
+// jpegs only, from the embedded preview when it is large enough
+// nil for other images and for icc profiles the levels would lose
++ (NSData*) thumbnailPyramidOf:(NSString*) path sizes:(NSArray<NSNumber*>*) sizes quality:(int) quality;
++ (NSData*) thumbnailPyramidLevelData:(NSData*) pyramid pixelSize:(int) pixelSize;
+// pyramid stored at offset in path: range is in the file
++ (NSRange) thumbnailPyramidLevel:(NSString*) path offset:(unsigned long long) offset length:(unsigned long long) length pixelSize:(int) pixelSize;
+
 + (BOOL) transformImage:(NSString*) path withTransform:(ImageTransformation) transform jpegCompression:(float) jpegCompression;
+// jpegs are transformed losslessly in parallel (see jpeg_batch.h), other
+// images and failed jpegs one by one. returns a boolean per path
++ (NSArray<NSNumber*>*) transformImages:(NSArray<NSString*>*) paths withTransform:(ImageTransformation) transform jpegCompression:(float) jpegCompression;
 + (BOOL) autoLosslessRotateImage:(NSString*) path;
 
 @end
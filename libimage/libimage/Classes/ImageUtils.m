@@ -9,9 +9,19 @@
 #import "NSFileManager+Utils.h"
 #import "NSImage+Transform.h"
 #import "NSImage+Bitmap.h"
+#import "NSBitmapImageRep+Save.h"
 #import "ImageUtils.h"
 #import "FileUtils.h"
+#import "dimension_utils.h"
 #import "exif_utils.h"
+#import "image_resample.h"
+#import "jpeg_batch.h"
+#import "jpeg_index.h"
+#import "job_scheduler.h"
+#import "metadata_utils.h"
+#import "raw_thumbnail.h"
+#import "thumb_hash.h"
+#import "thumbnail_utils.h"
 #import "Exif.h"
 
 @implementation ImageUtils
@@ -55,13 +65,29 @@
 
 }
 
++ (BOOL) openJpegIndexCacheIn:(NSString*) directory {
+	[[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:nil];
+	NSString* path = [directory stringByAppendingPathComponent:@"jpeg-index"];
+	return jpegIndexCacheOpen([path fileSystemRepresentation]);
+}
+
++ (void) closeJpegIndexCache {
+	jpegIndexCacheClose();
+}
+
 + (CGSize) getImageSize:(NSString*) path {
 	
+	// header-only probe: only the first bytes are read
+	ImageDimensions dimensions;
+	if (probeDimensions([path fileSystemRepresentation], &dimensions)) {
+		return CGSizeMake(dimensions.width, dimensions.height);
+	}
+	
 	// needed
 	int width = 0;
 	int height = 0;
 	
-	// open file
+	// other formats: open file
 	NSURL *imageFileURL = [NSURL fileURLWithPath:path];
 	CGImageSourceRef imageSource = CGImageSourceCreateWithURL((__bridge CFURLRef)imageFileURL, NULL);
 	if (imageSource != NULL) {
@@ -99,12 +125,15 @@
 
 + (NSDate*) getCreationDateForImage:(NSString*) file atDate:(NSDate*) now {
 
-	// extract exif data
-	Exif* exif = [[Exif alloc] initWithExifFile:file];
-	NSDate* exifDate = [Exif parseExifDate:[exif getTagValue:EXIF_TAG_DATE_TIME_DIGITIZED]];
-	if (exifDate != nil) {
-		return exifDate;
-		
+	// probe metadata: only the file header is read
+	// the capture date is never the ifd0 modification date
+	ImageMetadata metadata;
+	if (probeMetadata([file fileSystemRepresentation], &metadata) && (metadata.flags & METADATA_HAS_CAPTURE_TIME)) {
+		NSString* captureDate = [NSString stringWithCString:metadata.capture_date encoding:NSASCIIStringEncoding];
+		NSDate* exifDate = [Exif parseExifDate:captureDate];
+		if (exifDate != nil) {
+			return exifDate;
+		}
 	}
 
 	// if no exif date, get date from file
@@ -118,6 +147,72 @@
 	
 }
 
++ (NSArray<NSDictionary*>*) probeImages:(NSArray<NSString*>*) paths {
+	
+	// all at once, on the shared scheduler
+	NSUInteger count = [paths count];
+	const char** files = (const char**) calloc(count + 1, sizeof(const char*));
+	ImageMetadata* metadata = (ImageMetadata*) calloc(count + 1, sizeof(ImageMetadata));
+	for (NSUInteger i = 0; i < count; i++) {
+		files[i] = [[paths objectAtIndex:i] fileSystemRepresentation];
+	}
+	probeMetadataBatch(files, count, metadata);
+	
+	// png, gif, webp...: sizes from the dimension probe
+	NSUInteger unsized = 0;
+	const char** unsizedFiles = (const char**) calloc(count + 1, sizeof(const char*));
+	NSUInteger* unsizedIndices = (NSUInteger*) calloc(count + 1, sizeof(NSUInteger));
+	for (NSUInteger i = 0; i < count; i++) {
+		if ((metadata[i].flags & METADATA_HAS_SIZE) == 0) {
+			unsizedFiles[unsized] = files[i];
+			unsizedIndices[unsized] = i;
+			unsized++;
+		}
+	}
+	if (unsized > 0) {
+		ImageDimensions* dimensions = (ImageDimensions*) calloc(unsized, sizeof(ImageDimensions));
+		probeDimensionsBatch(unsizedFiles, unsized, dimensions);
+		for (NSUInteger j = 0; j < unsized; j++) {
+			ImageMetadata* probed = &metadata[unsizedIndices[j]];
+			if (dimensions[j].width != 0 && dimensions[j].height != 0) {
+				probed->width = dimensions[j].width;
+				probed->height = dimensions[j].height;
+				probed->orientation = dimensions[j].orientation;
+				probed->flags |= METADATA_HAS_SIZE;
+			}
+		}
+		free(dimensions);
+	}
+	free(unsizedFiles);
+	free(unsizedIndices);
+	
+	// results
+	NSMutableArray* results = [NSMutableArray arrayWithCapacity:count];
+	for (NSUInteger i = 0; i < count; i++) {
+		NSMutableDictionary* result = [NSMutableDictionary dictionary];
+		const ImageMetadata* probed = &metadata[i];
+		if (probed->flags & METADATA_HAS_CAPTURE_TIME) {
+			NSString* captureDate = [NSString stringWithCString:probed->capture_date encoding:NSASCIIStringEncoding];
+			NSDate* exifDate = [Exif parseExifDate:captureDate];
+			if (exifDate != nil) {
+				[result setObject:exifDate forKey:@"captureDate"];
+			}
+		}
+		if (probed->flags & METADATA_HAS_SIZE) {
+			BOOL swaps = (probed->orientation >= 5 && probed->orientation <= 8);
+			[result setObject:@(swaps ? probed->height : probed->width) forKey:@"width"];
+			[result setObject:@(swaps ? probed->width : probed->height) forKey:@"height"];
+		}
+		[results addObject:result];
+	}
+	free(files);
+	free(metadata);
+	
+	// done
+	return results;
+	
+}
+
 + (NSImage*) getThumbnail:(NSString*) path {
 	
 	// depends on type
@@ -136,17 +231,240 @@
 	
 }
 
-+ (BOOL) finalizeTransformOf:(NSString*) path
-								 intoCString:(const char*) result
-								copyExifData:(BOOL) copyExif
-		andUpdateOrientationWith:(unsigned char) exifOrient {
++ (NSData*) encodeRawThumbnail:(CGImageRef) image {
 	
-	NSString* resultFile = [NSString stringWithCString:result encoding:NSUTF8StringEncoding];
-	free((void*)result);
-	return [ImageUtils finalizeTransformOf:path
-																		into:resultFile
-														copyExifData:copyExif
-								andUpdateOrientationWith:exifOrient];
+	// render as premultiplied rgba8
+	size_t width = CGImageGetWidth(image);
+	size_t height = CGImageGetHeight(image);
+	CGColorSpaceRef colorSpace = CGColorSpaceCreateWithName(kCGColorSpaceSRGB);
+	CGContextRef context = CGBitmapContextCreate(NULL, width, height, 8, width * 4, colorSpace,
+																							 kCGImageAlphaPremultipliedLast | kCGBitmapByteOrder32Big);
+	CGColorSpaceRelease(colorSpace);
+	if (context == NULL) {
+		return nil;
+	}
+	CGContextDrawImage(context, CGRectMake(0, 0, width, height), image);
+	
+	// compress
+	unsigned char* data = NULL;
+	size_t size = 0;
+	bool success = rawThumbnailEncode(CGBitmapContextGetData(context), (uint32_t) width, (uint32_t) height,
+																		CGBitmapContextGetBytesPerRow(context), true, &data, &size);
+	CGContextRelease(context);
+	if (success == false) {
+		return nil;
+	}
+	
+	// done
+	return [NSData dataWithBytesNoCopy:data length:size freeWhenDone:YES];
+	
+}
+
++ (NSData*) decodeRawThumbnail:(NSData*) data width:(int*) width height:(int*) height {
+	
+	RawThumbnailInfo info;
+	unsigned char* pixels = NULL;
+	if (rawThumbnailDecode([data bytes], [data length], &info, &pixels) == false) {
+		return nil;
+	}
+	*width = info.width;
+	*height = info.height;
+	return [NSData dataWithBytesNoCopy:pixels length:(NSUInteger) info.width * info.height * 4 freeWhenDone:YES];
+	
+}
+
++ (CGImageRef) resampleImage:(CGImageRef) image width:(size_t) width height:(size_t) height {
+	
+	// source as premultiplied rgba8
+	size_t src_width = CGImageGetWidth(image);
+	size_t src_height = CGImageGetHeight(image);
+	if (src_width == 0 || src_height == 0 || width == 0 || height == 0 ||
+			src_width > UINT32_MAX || src_height > UINT32_MAX || width > UINT32_MAX || height > UINT32_MAX) {
+		return NULL;
+	}
+	CGColorSpaceRef colorSpace = CGColorSpaceCreateWithName(kCGColorSpaceSRGB);
+	CGBitmapInfo bitmapInfo = kCGImageAlphaPremultipliedLast | kCGBitmapByteOrder32Big;
+	CGContextRef source = CGBitmapContextCreate(NULL, src_width, src_height, 8, 0, colorSpace, bitmapInfo);
+	CGContextRef target = CGBitmapContextCreate(NULL, width, height, 8, 0, colorSpace, bitmapInfo);
+	CGColorSpaceRelease(colorSpace);
+	if (source == NULL || target == NULL) {
+		CGContextRelease(source);
+		CGContextRelease(target);
+		return NULL;
+	}
+	CGContextSetBlendMode(source, kCGBlendModeCopy);
+	CGContextDrawImage(source, CGRectMake(0, 0, src_width, src_height), image);
+	
+	// area average when shrinking, lanczos otherwise
+	ImageResampleFilter filter = (width <= src_width && height <= src_height) ? IMAGE_RESAMPLE_BOX : IMAGE_RESAMPLE_LANCZOS3;
+	bool rc = imageResample(CGBitmapContextGetData(source), (uint32_t) src_width, (uint32_t) src_height,
+													CGBitmapContextGetBytesPerRow(source),
+													CGBitmapContextGetData(target), (uint32_t) width, (uint32_t) height,
+													CGBitmapContextGetBytesPerRow(target), 4, filter);
+	CGContextRelease(source);
+	
+	// done
+	CGImageRef resampled = rc ? CGBitmapContextCreateImage(target) : NULL;
+	CGContextRelease(target);
+	return resampled;
+	
+}
+
++ (NSData*) thumbHashForImage:(CGImageRef) image {
+	
+	// downscale as premultiplied rgba8
+	size_t width = CGImageGetWidth(image);
+	size_t height = CGImageGetHeight(image);
+	if (width == 0 || height == 0) {
+		return nil;
+	}
+	double ratio = MIN(1.0, (double) THUMB_HASH_MAX_SIDE / MAX(width, height));
+	width = MAX(1, (size_t) round(width * ratio));
+	height = MAX(1, (size_t) round(height * ratio));
+	CGColorSpaceRef colorSpace = CGColorSpaceCreateWithName(kCGColorSpaceSRGB);
+	CGContextRef context = CGBitmapContextCreate(NULL, width, height, 8, width * 4, colorSpace,
+																							 kCGImageAlphaPremultipliedLast | kCGBitmapByteOrder32Big);
+	CGColorSpaceRelease(colorSpace);
+	if (context == NULL) {
+		return nil;
+	}
+	CGContextSetInterpolationQuality(context, kCGInterpolationMedium);
+	CGContextDrawImage(context, CGRectMake(0, 0, width, height), image);
+	
+	// hash
+	unsigned char hash[THUMB_HASH_MAX_SIZE];
+	size_t size = thumbHashEncode(CGBitmapContextGetData(context), (uint32_t) width, (uint32_t) height,
+																CGBitmapContextGetBytesPerRow(context), hash);
+	CGContextRelease(context);
+	if (size == 0) {
+		return nil;
+	}
+	
+	// done
+	return [NSData dataWithBytes:hash length:size];
+	
+}
+
++ (NSData*) packThumbnailPyramid:(NSArray<NSData*>*) levels {
+	
+	if (levels.count == 0 || levels.count > THUMBNAIL_PYRAMID_MAX_LEVELS) {
+		return nil;
+	}
+	
+	// pack
+	const unsigned char* images[THUMBNAIL_PYRAMID_MAX_LEVELS];
+	unsigned long lengths[THUMBNAIL_PYRAMID_MAX_LEVELS];
+	for (NSUInteger i = 0; i < levels.count; i++) {
+		images[i] = [levels[i] bytes];
+		lengths[i] = [levels[i] length];
+	}
+	unsigned char* data = NULL;
+	unsigned long size = 0;
+	if (thumbnailPyramidPack(images, lengths, levels.count, &data, &size) == false) {
+		return nil;
+	}
+	
+	// done
+	return [NSData dataWithBytesNoCopy:data length:size freeWhenDone:YES];
+	
+}
+
++ (NSData*) thumbnailPyramidOf:(NSString*) path sizes:(NSArray<NSNumber*>*) sizes quality:(int) quality {
+	
+	if (sizes.count == 0 || sizes.count > THUMBNAIL_PYRAMID_MAX_LEVELS || [ImageUtils looksLikeJpeg:path] == NO) {
+		return nil;
+	}
+	
+	// levels are plain srgb
+	JpegIndex index;
+	if (jpegIndexFile([path fileSystemRepresentation], &index) == false || index.truncated || jpegIndexFind(&index, 0xE2, "ICC_") != NULL) {
+		return nil;
+	}
+	
+	// build
+	unsigned int pixelSizes[THUMBNAIL_PYRAMID_MAX_LEVELS];
+	for (NSUInteger i = 0; i < sizes.count; i++) {
+		pixelSizes[i] = [sizes[i] unsignedIntValue];
+	}
+	unsigned char* data = NULL;
+	unsigned long size = 0;
+	if (jpegPreviewPyramid([path fileSystemRepresentation], pixelSizes, sizes.count, quality, &data, &size) == false) {
+		return nil;
+	}
+	
+	// done
+	return [NSData dataWithBytesNoCopy:data length:size freeWhenDone:YES];
+	
+}
+
++ (NSData*) thumbnailPyramidLevelData:(NSData*) pyramid pixelSize:(int) pixelSize {
+	
+	// pick
+	ThumbnailLevel levels[THUMBNAIL_PYRAMID_MAX_LEVELS];
+	size_t count = thumbnailPyramidLevels([pyramid bytes], [pyramid length], [pyramid length], levels);
+	const ThumbnailLevel* level = pickThumbnailLevel(levels, count, pixelSize);
+	if (level == NULL) {
+		return nil;
+	}
+	
+	// done
+	return [pyramid subdataWithRange:NSMakeRange(level->offset, level->length)];
+	
+}
+
++ (NSRange) thumbnailPyramidLevel:(NSString*) path offset:(unsigned long long) offset length:(unsigned long long) length pixelSize:(int) pixelSize {
+	
+	// only the header is read
+	NSRange notFound = NSMakeRange(NSNotFound, 0);
+	NSFileHandle* fileH = [NSFileHandle fileHandleForReadingAtPath:path];
+	if (fileH == nil) {
+		return notFound;
+	}
+	[fileH seekToFileOffset:offset];
+	NSData* header = [fileH readDataOfLength:THUMBNAIL_PYRAMID_HEADER_SIZE];
+	[fileH closeFile];
+	
+	// pick
+	ThumbnailLevel levels[THUMBNAIL_PYRAMID_MAX_LEVELS];
+	size_t count = thumbnailPyramidLevels([header bytes], [header length], length, levels);
+	const ThumbnailLevel* level = pickThumbnailLevel(levels, count, pixelSize);
+	if (level == NULL) {
+		return notFound;
+	}
+	return NSMakeRange(offset + level->offset, level->length);
+	
+}
+
++ (BOOL) losslessTransformOf:(NSString*) path
+							withJpegTransform:(JXFORM_CODE) transform {
+	
+	// save creation date
+	NSDate* creationDate = [FileUtils getCreationDateForFile:path];
+	
+	// transform in place: result is renamed over the original
+	// exif orientation and thumbnail are updated while markers are copied
+	bool thumbnailKept = false;
+	JpegTransformOptions options;
+	memset(&options, 0, sizeof(options));
+	options.reset_orientation = true;
+	options.transform_thumbnail = true;
+	options.optimize_coding = true;
+	options.thumbnail_kept = &thumbnailKept;
+	const char* cPath = [path fileSystemRepresentation];
+	if (jpegTransformFile(cPath, transform, &options) == false) {
+		return FALSE;
+	}
+	
+	// thumbnail could not be transformed losslessly: regenerate it
+	if (thumbnailKept) {
+		[Exif updateExifThumbnail:path];
+	}
+	
+	// set creation date
+	[FileUtils setCreationDate:creationDate forFile:path];
+	
+	// done
+	return TRUE;
 	
 }
 
@@ -190,6 +508,45 @@
 	
 }
 
++ (NSBitmapImageRep*) transformBitmap:(NSBitmapImageRep*) bitmap withTransform:(ImageTransformation) transform {
+	
+	// meshed whole-byte pixels only
+	if (bitmap == nil || bitmap.isPlanar || bitmap.bitsPerPixel % 8 != 0 || bitmap.bitsPerPixel > 128) {
+		return nil;
+	}
+	
+	// target
+	PixelTransform code = imageTransformToPixelTransform(transform);
+	BOOL swaps = pixelTransformSwapsSize(code);
+	NSSize size = bitmap.size;
+	NSBitmapImageRep* transformed = [[NSBitmapImageRep alloc] initWithBitmapDataPlanes:NULL
+																																					pixelsWide:swaps ? bitmap.pixelsHigh : bitmap.pixelsWide
+																																					pixelsHigh:swaps ? bitmap.pixelsWide : bitmap.pixelsHigh
+																																			 bitsPerSample:bitmap.bitsPerSample
+																																		 samplesPerPixel:bitmap.samplesPerPixel
+																																						hasAlpha:bitmap.hasAlpha
+																																						isPlanar:NO
+																																			colorSpaceName:bitmap.colorSpaceName
+																																				bitmapFormat:bitmap.bitmapFormat
+																																				 bytesPerRow:0
+																																				bitsPerPixel:bitmap.bitsPerPixel];
+	if (transformed == nil) {
+		return nil;
+	}
+	
+	// move pixels
+	if (pixelTransform(bitmap.bitmapData, (uint32_t) bitmap.pixelsWide, (uint32_t) bitmap.pixelsHigh, bitmap.bytesPerRow,
+										 transformed.bitmapData, transformed.bytesPerRow, (int) (bitmap.bitsPerPixel / 8), code) == false) {
+		return nil;
+	}
+	
+	// keep point size and color profile
+	transformed.size = swaps ? NSMakeSize(size.height, size.width) : size;
+	NSBitmapImageRep* tagged = [transformed bitmapImageRepByRetaggingWithColorSpace:bitmap.colorSpace];
+	return tagged != nil ? tagged : transformed;
+	
+}
+
 + (BOOL) transformImage:(NSString*) path
 					withTransform:(ImageTransformation) transform
 				jpegCompression:(float) jpegCompression {
@@ -198,30 +555,114 @@
 	if ([ImageUtils looksLikeJpeg:path]) {
 		
 		// try it
-		const char* cPath = [path cStringUsingEncoding:NSUTF8StringEncoding];
 		JXFORM_CODE jTransform = imageTransformToJpegTransform(transform);
-		const char* resultFile = jpegTransform(cPath, jTransform);
-		if (resultFile != NULL) {
-			
-			return [ImageUtils finalizeTransformOf:path
-																 intoCString:resultFile
-																copyExifData:FALSE
-										andUpdateOrientationWith:1];
-			
+		if ([ImageUtils losslessTransformOf:path withJpegTransform:jTransform]) {
+			return TRUE;
 		}
 		
 	}
 	
-	// we need to perform a normal transform
-	NSImage* original = [[NSImage alloc] initWithContentsOfFile:path];
-	NSImage* transformed = [original transform:transform];
+	// re-encode
+	return [ImageUtils reencodeTransformOf:path withTransform:transform jpegCompression:jpegCompression];
+	
+}
+
+static void jpegBatchDone(void* context, size_t index, bool success, size_t completed, size_t total) {
+	bool* results = (bool*) context;
+	results[index] = success;
+}
+
++ (NSArray<NSNumber*>*) transformImages:(NSArray<NSString*>*) paths
+													withTransform:(ImageTransformation) transform
+												jpegCompression:(float) jpegCompression {
+	
+	// collect jpegs
+	NSUInteger count = [paths count];
+	JpegBatchItem* items = (JpegBatchItem*) calloc(count + 1, sizeof(JpegBatchItem));
+	NSUInteger* indices = (NSUInteger*) calloc(count + 1, sizeof(NSUInteger));
+	bool* transformed = (bool*) calloc(count + 1, sizeof(bool));
+	bool* thumbnailsKept = (bool*) calloc(count + 1, sizeof(bool));
+	NSMutableArray* creationDates = [NSMutableArray arrayWithCapacity:count];
+	JXFORM_CODE jTransform = imageTransformToJpegTransform(transform);
+	size_t jpegs = 0;
+	for (NSUInteger i = 0; i < count; i++) {
+		NSString* path = [paths objectAtIndex:i];
+		if ([ImageUtils looksLikeJpeg:path]) {
+			items[jpegs].file = [path fileSystemRepresentation];
+			items[jpegs].transform = jTransform;
+			items[jpegs].thumbnail_kept = &thumbnailsKept[jpegs];
+			indices[jpegs] = i;
+			NSDate* creationDate = [FileUtils getCreationDateForFile:path];
+			[creationDates addObject:creationDate != nil ? creationDate : [NSNull null]];
+			jpegs++;
+		}
+	}
+	
+	// all at once, on the shared scheduler
+	JobScheduler* scheduler = jobSchedulerShared();
+	jpegBatchTransform(items, jpegs, 0, jpegBatchDone, transformed,
+										 JOB_GROUP_DEFAULT, jobSchedulerGeneration(scheduler, JOB_GROUP_DEFAULT));
+	
+	// results
+	NSMutableArray* results = [NSMutableArray arrayWithCapacity:count];
+	for (NSUInteger i = 0; i < count; i++) {
+		[results addObject:@NO];
+	}
+	for (size_t j = 0; j < jpegs; j++) {
+		if (transformed[j]) {
+			NSString* path = [paths objectAtIndex:indices[j]];
+			if (thumbnailsKept[j]) {
+				[Exif updateExifThumbnail:path];
+			}
+			id creationDate = [creationDates objectAtIndex:j];
+			if (creationDate != [NSNull null]) {
+				[FileUtils setCreationDate:creationDate forFile:path];
+			}
+			[results replaceObjectAtIndex:indices[j] withObject:@YES];
+		}
+	}
+	free(items);
+	free(indices);
+	free(transformed);
+	free(thumbnailsKept);
+	
+	// the others
+	for (NSUInteger i = 0; i < count; i++) {
+		if ([[results objectAtIndex:i] boolValue] == NO) {
+			BOOL success = [ImageUtils reencodeTransformOf:[paths objectAtIndex:i] withTransform:transform jpegCompression:jpegCompression];
+			[results replaceObjectAtIndex:i withObject:@(success)];
+		}
+	}
+	
+	// done
+	return results;
 	
-	// now save it
+}
+
++ (BOOL) reencodeTransformOf:(NSString*) path
+							 withTransform:(ImageTransformation) transform
+						 jpegCompression:(float) jpegCompression {
+	
+	// we need to perform a normal transform: pixels are moved
+	// directly unless the bitmap layout is not supported
 	NSString* result = [NSFileManager temporaryFilename:path];
-	if ([transformed saveSameAs:path
-													 to:result
-							jpegCompression:jpegCompression] == FALSE) {
-		return FALSE;
+	NSData* data = [NSData dataWithContentsOfFile:path];
+	NSBitmapImageRep* bitmap = data != nil ? [NSBitmapImageRep imageRepWithData:data] : nil;
+	NSBitmapImageRep* transformedBitmap = [ImageUtils transformBitmap:bitmap withTransform:transform];
+	if (transformedBitmap != nil) {
+		if ([transformedBitmap saveSameAs:path
+																	 to:result
+											jpegCompression:jpegCompression] == FALSE) {
+			return FALSE;
+		}
+	} else {
+		NSImage* original = [[NSImage alloc] initWithContentsOfFile:path];
+		NSImage* transformed = [original transform:transform];
+		if ([transformed saveSameAs:path
+														 to:result
+								jpegCompression:jpegCompression] == FALSE) {
+			return FALSE;
+		}
 	}
 	
 	// finalize
@@ -255,18 +696,7 @@
 	}
 	
 	// now process transformation
-	const char* resultFile = jpegTransform(cPath, transform);
-	if (resultFile != NULL) {
-		
-		return [ImageUtils finalizeTransformOf:path
-															 intoCString:resultFile
-															copyExifData:FALSE
-									andUpdateOrientationWith:1];
-		
-	} else {
-		
-		return FALSE;
-	}
+	return [ImageUtils losslessTransformOf:path withJpegTransform:transform];
 	
 }
 
@@ -0,0 +1,30 @@
+//
+//  JobQueue.h
+//  libimage
+//
+//  Copyright (c) 2026 nabocorp. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "job_scheduler.h"
+
+// blocks run on the workers of the shared cutils scheduler (see
+// job_scheduler.h): app work and libimage batches share the same
+// threads, priority classes and cancellable groups
+
+@interface JobQueue : NSObject
+
++ (uint32_t) generationOfGroup:(uint32_t) group;
+
+// blocks of group submitted before this call are called as cancelled
+// returns the new generation
++ (uint32_t) cancelGroup:(uint32_t) group;
+
++ (BOOL) isCancelledGroup:(uint32_t) group generation:(uint32_t) generation;
+
+// priority is a JOB_PRIORITY_* class. block is always called once,
+// with cancelled set if group was cancelled before it started
+// returns NO (and block is not called) when the queue is full
++ (BOOL) submitWithPriority:(int) priority group:(uint32_t) group generation:(uint32_t) generation block:(void (^)(BOOL cancelled)) block;
+
+@end
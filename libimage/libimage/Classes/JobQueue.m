@@ -0,0 +1,43 @@
+//
+//  JobQueue.m
+//  libimage
+//
+//  Copyright (c) 2026 nabocorp. All rights reserved.
+//
+
+#import "JobQueue.h"
+
+@implementation JobQueue
+
+static void runBlock(void* context, bool cancelled) {
+	@autoreleasepool {
+		void (^block)(BOOL) = (__bridge_transfer void (^)(BOOL)) context;
+		block(cancelled ? YES : NO);
+	}
+}
+
++ (uint32_t) generationOfGroup:(uint32_t) group {
+	return jobSchedulerGeneration(jobSchedulerShared(), group);
+}
+
++ (uint32_t) cancelGroup:(uint32_t) group {
+	return jobSchedulerCancel(jobSchedulerShared(), group);
+}
+
++ (BOOL) isCancelledGroup:(uint32_t) group generation:(uint32_t) generation {
+	return jobSchedulerIsCancelled(jobSchedulerShared(), group, generation);
+}
+
++ (BOOL) submitWithPriority:(int) priority group:(uint32_t) group generation:(uint32_t) generation block:(void (^)(BOOL cancelled)) block {
+	
+	// the scheduler owns the block until it is called
+	void* context = (__bridge_retained void*) [block copy];
+	if (jobSchedulerSubmit(jobSchedulerShared(), priority, group, generation, runBlock, context) == false) {
+		CFRelease(context);
+		return NO;
+	}
+	return YES;
+	
+}
+
+@end
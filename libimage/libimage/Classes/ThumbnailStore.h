@@ -0,0 +1,31 @@
+//
+//  ThumbnailStore.h
+//  libimage
+//
+//  Copyright (c) 2026 nabocorp. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+// thumbnails and data derived from them kept in pack files with an
+// mmap'd index (see thumb_cache.h): hits never write to disk and
+// least recently used entries are evicted when storing new ones
+
+@interface ThumbnailStore : NSObject
+
+- (instancetype) initWithDirectory:(NSString*) directory capacity:(unsigned long long) capacity;
+
+- (NSData*) dataForPath:(NSString*) path modification:(long long) modification fileSize:(long long) fileSize pixelSize:(int) pixelSize variant:(int) variant;
+
+// returns the pack file holding the data, to be read in place
+- (NSString*) locatePath:(NSString*) path modification:(long long) modification fileSize:(long long) fileSize pixelSize:(int) pixelSize variant:(int) variant offset:(unsigned long long*) offset length:(unsigned long long*) length;
+
+- (BOOL) storeData:(NSData*) data forPath:(NSString*) path modification:(long long) modification fileSize:(long long) fileSize pixelSize:(int) pixelSize variant:(int) variant;
+
+- (BOOL) clear;
+- (unsigned long long) size;
+
+// reclaims space of evicted entries: to be called from a background thread
+- (BOOL) compact;
+
+@end
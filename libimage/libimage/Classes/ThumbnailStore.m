@@ -0,0 +1,90 @@
+//
+//  ThumbnailStore.m
+//  libimage
+//
+//  Copyright (c) 2026 nabocorp. All rights reserved.
+//
+
+#import "ThumbnailStore.h"
+#import "thumb_cache.h"
+
+@interface ThumbnailStore () {
+	ThumbCache* _cache;
+}
+@end
+
+@implementation ThumbnailStore
+
+static ThumbCacheKey cacheKey(NSString* path, long long modification, long long fileSize, int pixelSize, int variant) {
+	ThumbCacheKey key;
+	key.path = [path fileSystemRepresentation];
+	key.mtime = modification;
+	key.size = (uint64_t) fileSize;
+	key.px = (uint32_t) pixelSize;
+	key.variant = (uint32_t) variant;
+	return key;
+}
+
+- (instancetype) initWithDirectory:(NSString*) directory capacity:(unsigned long long) capacity {
+	
+	self = [super init];
+	if (self == nil) {
+		return nil;
+	}
+	
+	[[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:nil];
+	_cache = thumbCacheOpen([directory fileSystemRepresentation], capacity);
+	if (_cache == NULL) {
+		return nil;
+	}
+	return self;
+	
+}
+
+- (void) dealloc {
+	thumbCacheClose(_cache);
+}
+
+- (NSData*) dataForPath:(NSString*) path modification:(long long) modification fileSize:(long long) fileSize pixelSize:(int) pixelSize variant:(int) variant {
+	
+	ThumbCacheKey key = cacheKey(path, modification, fileSize, pixelSize, variant);
+	unsigned char* data = NULL;
+	size_t size = 0;
+	if (thumbCacheGet(_cache, &key, &data, &size) == false) {
+		return nil;
+	}
+	return [NSData dataWithBytesNoCopy:data length:size freeWhenDone:YES];
+	
+}
+
+- (NSString*) locatePath:(NSString*) path modification:(long long) modification fileSize:(long long) fileSize pixelSize:(int) pixelSize variant:(int) variant offset:(unsigned long long*) offset length:(unsigned long long*) length {
+	
+	ThumbCacheKey key = cacheKey(path, modification, fileSize, pixelSize, variant);
+	ThumbCacheLocation location;
+	if (thumbCacheLocate(_cache, &key, &location) == false) {
+		return nil;
+	}
+	*offset = location.offset;
+	*length = location.length;
+	return [[NSFileManager defaultManager] stringWithFileSystemRepresentation:location.path length:strlen(location.path)];
+	
+}
+
+- (BOOL) storeData:(NSData*) data forPath:(NSString*) path modification:(long long) modification fileSize:(long long) fileSize pixelSize:(int) pixelSize variant:(int) variant {
+	ThumbCacheKey key = cacheKey(path, modification, fileSize, pixelSize, variant);
+	return thumbCachePut(_cache, &key, [data bytes], [data length]);
+}
+
+- (BOOL) clear {
+	return thumbCacheClear(_cache);
+}
+
+- (unsigned long long) size {
+	return thumbCacheSize(_cache);
+}
+
+- (BOOL) compact {
+	return thumbCacheCompact(_cache);
+}
+
+@end
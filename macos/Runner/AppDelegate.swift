@@ -27,6 +27,7 @@ private enum ThumbnailCacheError: LocalizedError {
 	case sourceUnavailable(String)
 	case thumbnailGenerationFailed(String)
 	case thumbnailEncodingFailed(String)
+	case requestCancelled(String)
 
 	var errorDescription: String? {
 		switch self {
@@ -38,6 +39,8 @@ private enum ThumbnailCacheError: LocalizedError {
 			return "A thumbnail could not be generated for: \(path)"
 		case .thumbnailEncodingFailed(let path):
 			return "A thumbnail could not be encoded for: \(path)"
+		case .requestCancelled(let path):
+			return "The thumbnail request was cancelled: \(path)"
 		}
 	}
 }
@@ -59,33 +62,147 @@ private enum VisualFeatureCacheError: LocalizedError {
 	}
 }
 
-private final class ThumbnailDiskCache {
-	private struct CacheEntry {
-		let url: URL
-		let size: Int
-		let lastAccess: Date
+/// What is stored for a source in the native thumbnail store. Bump
+/// `visualFeatures` when the feature print revision changes.
+private enum ThumbnailVariant: Int32 {
+	case pyramid = 0
+	case pixels = 1
+	case visualFeatures = 2
+	case placeholder = 3
+}
+
+/// One encoded level inside a cached thumbnail pyramid, as a byte
+/// range of the pack file holding it.
+private struct ThumbnailLevel {
+	let url: URL
+	let offset: Int
+	let length: Int
+}
+
+/// Premultiplied RGBA8 pixels, tightly packed.
+private struct ThumbnailPixels {
+	let width: Int
+	let height: Int
+	let pixels: Data
+}
+
+/// Folders to prefetch, most likely first, with the sizes the gallery
+/// requests and the budgets of one prefetch run.
+private struct ThumbnailPrefetchRequest {
+	let folders: [String]
+	let extensions: Set<String>
+	let pixelSize: Int
+	let displaySize: Int
+	let maxSourceBytes: Int64
+	let maxCacheBytes: Int
+
+	init?(arguments: Any?) {
+		guard let values = arguments as? [String: Any],
+			  let folders = values["folders"] as? [String],
+			  let extensions = values["extensions"] as? [String],
+			  let pixelSize = values["pixelSize"] as? NSNumber,
+			  let displaySize = values["displaySize"] as? NSNumber,
+			  let maxSourceBytes = values["maxSourceBytes"] as? NSNumber,
+			  let maxCacheBytes = values["maxCacheBytes"] as? NSNumber else {
+			return nil
+		}
+		self.folders = folders
+		self.extensions = Set(extensions.map { $0.lowercased() })
+		self.pixelSize = pixelSize.intValue
+		self.displaySize = displaySize.intValue
+		self.maxSourceBytes = maxSourceBytes.int64Value
+		self.maxCacheBytes = maxCacheBytes.intValue
 	}
+}
+
+private struct ThumbnailPrefetchFile {
+	let path: String
+	let modificationMicros: Int64
+	let fileSize: Int64
+}
 
-	private let cacheVersion = "v1"
-	private let cacheLimitBytes = 1024 * 1024 * 1024
-	private let cacheTargetBytes = 900 * 1024 * 1024
-	private let fileManager = FileManager.default
-	private let workerQueue: OperationQueue = {
-		let queue = OperationQueue()
-		queue.name = "com.nabocorp.foto.thumbnail-cache.workers"
-		queue.qualityOfService = .userInitiated
-		queue.maxConcurrentOperationCount = 2
-		return queue
-	}()
+/// Progress of one prefetch run. Its jobs are chained, one file each, so
+/// a single job of the run exists at a time.
+private final class ThumbnailPrefetchRun {
+	let request: ThumbnailPrefetchRequest
+	let generation: UInt32
+	let initialStoredBytes: Int
+	var sourceBytes: Int64 = 0
+	var folderIndex = 0
+	var files: [ThumbnailPrefetchFile] = []
+
+	init(request: ThumbnailPrefetchRequest, generation: UInt32, initialStoredBytes: Int) {
+		self.request = request
+		self.generation = generation
+		self.initialStoredBytes = initialStoredBytes
+	}
+}
+
+/// Where a thumbnail request runs in the native job scheduler
+/// (`job_scheduler.h`): views are groups 0 to 31, 0 never being
+/// cancelled, and prefetch has its own group.
+private struct ThumbnailJob {
+	static let maxView: UInt32 = 31
+	static let prefetchGroup: UInt32 = 32
+
+	let priority: Int32
+	let view: UInt32
+
+	static let visible = ThumbnailJob(priority: JOB_PRIORITY_VISIBLE, view: 0)
+
+	init(priority: Int32, view: UInt32) {
+		self.priority = priority
+		self.view = view
+	}
+
+	/// Optional "priority" (a JOB_PRIORITY_* class) and "view" arguments.
+	init?(arguments: [String: Any]) {
+		let priority = (arguments["priority"] as? NSNumber)?.int32Value ?? JOB_PRIORITY_VISIBLE
+		let view = (arguments["view"] as? NSNumber)?.uint32Value ?? 0
+		guard priority == JOB_PRIORITY_VISIBLE || priority == JOB_PRIORITY_NEAR_VISIBLE,
+			  view <= ThumbnailJob.maxView else {
+			return nil
+		}
+		self.init(priority: priority, view: view)
+	}
+}
+
+/// Thumbnails live in the native store (`thumb_cache.h`): pack files and
+/// an mmap'd index keyed by source metadata. Hits only update in-memory
+/// recency and storing evicts least recently used entries, so there is no
+/// directory walk and no file touched per hit.
+///
+/// Generation runs on the libimage job scheduler (`JobQueue`), shared with
+/// native batches: visible tiles first, then the ones built ahead of the
+/// viewport, then prefetch. Closing a view cancels its pending requests.
+private final class ThumbnailDiskCache {
+	private static let cacheVersion = "v2"
+	private static let cacheLimitBytes = 1024 * 1024 * 1024
+	private let pyramidSizes = [256, 960, 2048]
+	private let store: ThumbnailStore?
 	private let maintenanceQueue = DispatchQueue(
 		label: "com.nabocorp.foto.thumbnail-cache.maintenance",
 		qos: .utility
 	)
-	private let pruneLock = NSLock()
-	private var pruneScheduled = false
+	private let prefetchIdleSeconds: CFTimeInterval = 2
+	private let storedBytesLock = NSLock()
+	private var storedBytes = 0
+	private let compactionLock = NSLock()
+	private var compactionScheduled = false
 
 	init() {
-		schedulePrune()
+		if let directory = try? ThumbnailDiskCache.cacheDirectory() {
+			store = ThumbnailStore(
+				directory: directory.path,
+				capacity: UInt64(ThumbnailDiskCache.cacheLimitBytes)
+			)
+		} else {
+			store = nil
+		}
+		maintenanceQueue.async {
+			ThumbnailDiskCache.removePreviousVersions()
+		}
+		scheduleCompaction()
 	}
 
 	func resolve(
@@ -93,9 +210,12 @@ private final class ThumbnailDiskCache {
 		modificationMicros: Int64,
 		fileSize: Int64,
 		pixelSize: Int,
-		completion: @escaping (Result<URL, Error>) -> Void
+		job: ThumbnailJob,
+		completion: @escaping (Result<ThumbnailLevel, Error>) -> Void
 	) {
 		perform(
+			job,
+			path: path,
 			{
 				try self.resolveSynchronously(
 					path: path,
@@ -108,27 +228,76 @@ private final class ThumbnailDiskCache {
 		)
 	}
 
+	/// Texture-ready tier: the encoded thumbnail decoded once at display
+	/// size and stored next to it as LZ4-compressed premultiplied RGBA, so
+	/// hits skip the image codec on both sides of the channel.
+	func resolvePixels(
+		path: String,
+		modificationMicros: Int64,
+		fileSize: Int64,
+		pixelSize: Int,
+		displaySize: Int,
+		job: ThumbnailJob,
+		completion: @escaping (Result<ThumbnailPixels, Error>) -> Void
+	) {
+		perform(
+			job,
+			path: path,
+			{
+				try self.resolvePixelsSynchronously(
+					path: path,
+					modificationMicros: modificationMicros,
+					fileSize: fileSize,
+					pixelSize: pixelSize,
+					displaySize: displaySize
+				)
+			},
+			completion: completion
+		)
+	}
+
+	/// Requests of a cancelled view complete with `requestCancelled`
+	/// without running, as do requests the scheduler has no room for.
 	fileprivate func perform<T>(
+		_ job: ThumbnailJob,
+		path: String,
 		_ work: @escaping () throws -> T,
 		completion: @escaping (Result<T, Error>) -> Void
 	) {
-		workerQueue.addOperation {
+		cancelPrefetch()
+		let submitted = JobQueue.submit(
+			withPriority: job.priority,
+			group: job.view,
+			generation: JobQueue.generation(ofGroup: job.view)
+		) { cancelled in
 			do {
+				guard !cancelled else {
+					throw ThumbnailCacheError.requestCancelled(path)
+				}
 				let value = try work()
 				DispatchQueue.main.async { completion(.success(value)) }
 			} catch {
 				DispatchQueue.main.async { completion(.failure(error)) }
 			}
 		}
+		if !submitted {
+			completion(.failure(ThumbnailCacheError.requestCancelled(path)))
+		}
+	}
+
+	/// Pending requests of view complete as cancelled.
+	func cancelRequests(view: UInt32) {
+		guard view != 0, view <= ThumbnailJob.maxView else { return }
+		JobQueue.cancelGroup(view)
 	}
 
 	func clear(completion: @escaping (Result<Void, Error>) -> Void) {
-		workerQueue.addBarrierBlock { [weak self] in
+		cancelPrefetch()
+		maintenanceQueue.async { [weak self] in
 			guard let self else { return }
 			do {
-				let directory = try self.cacheDirectory()
-				if self.fileManager.fileExists(atPath: directory.path) {
-					try self.fileManager.removeItem(at: directory)
+				guard try self.openStore().clear() else {
+					throw ThumbnailCacheError.cacheDirectoryUnavailable
 				}
 				DispatchQueue.main.async { completion(.success(())) }
 			} catch {
@@ -137,37 +306,283 @@ private final class ThumbnailDiskCache {
 		}
 	}
 
+	/// Opt-in idle work: gallery thumbnails of folders likely to be opened
+	/// next, generated within the request budgets as prefetch-priority
+	/// jobs of one file each, so visible tiles never wait for a folder.
+	/// It waits while the user is active and any foreground request
+	/// cancels it.
+	func prefetch(_ request: ThumbnailPrefetchRequest) {
+		let generation = cancelPrefetch()
+		storedBytesLock.lock()
+		let initialStoredBytes = storedBytes
+		storedBytesLock.unlock()
+		submitPrefetch(ThumbnailPrefetchRun(
+			request: request,
+			generation: generation,
+			initialStoredBytes: initialStoredBytes
+		))
+	}
+
+	@discardableResult
+	func cancelPrefetch() -> UInt32 {
+		JobQueue.cancelGroup(ThumbnailJob.prefetchGroup)
+	}
+
+	private func submitPrefetch(_ run: ThumbnailPrefetchRun) {
+		JobQueue.submit(
+			withPriority: JOB_PRIORITY_PREFETCH,
+			group: ThumbnailJob.prefetchGroup,
+			generation: run.generation
+		) { [weak self] cancelled in
+			guard !cancelled else { return }
+			self?.prefetchNext(run)
+		}
+	}
+
+	private func prefetchNext(_ run: ThumbnailPrefetchRun) {
+		guard let store else { return }
+
+		// Waiting for the user to be idle does not hold a worker.
+		guard isIdle() else {
+			DispatchQueue.global(qos: .background).asyncAfter(
+				deadline: .now() + 0.25
+			) { [weak self] in
+				guard !JobQueue.isCancelledGroup(
+					ThumbnailJob.prefetchGroup,
+					generation: run.generation
+				) else { return }
+				self?.submitPrefetch(run)
+			}
+			return
+		}
+
+		while run.files.isEmpty {
+			guard run.folderIndex < run.request.folders.count else { return }
+			run.files = prefetchCandidates(
+				run.request.folders[run.folderIndex],
+				extensions: run.request.extensions
+			).reversed()
+			run.folderIndex += 1
+		}
+		let file = run.files.removeLast()
+
+		storedBytesLock.lock()
+		let written = storedBytes - run.initialStoredBytes
+		storedBytesLock.unlock()
+		guard run.sourceBytes < run.request.maxSourceBytes,
+			  written < run.request.maxCacheBytes else {
+			return
+		}
+		if !contains(
+			store,
+			path: file.path,
+			modificationMicros: file.modificationMicros,
+			fileSize: file.fileSize,
+			pixelSize: run.request.displaySize,
+			variant: .pixels
+		) {
+			// Only a pyramid miss reads the original.
+			if !contains(
+				store,
+				path: file.path,
+				modificationMicros: file.modificationMicros,
+				fileSize: file.fileSize,
+				pixelSize: pyramidSizes[pyramidSizes.count - 1],
+				variant: .pyramid
+			) {
+				run.sourceBytes += max(0, file.fileSize)
+			}
+			_ = try? resolvePixelsSynchronously(
+				path: file.path,
+				modificationMicros: file.modificationMicros,
+				fileSize: file.fileSize,
+				pixelSize: run.request.pixelSize,
+				displaySize: run.request.displaySize
+			)
+		}
+		submitPrefetch(run)
+	}
+
+	/// Images of folder in name order, with the identity the directory scan
+	/// gives Flutter: the keys must match the ones it will request.
+	private func prefetchCandidates(
+		_ folder: String,
+		extensions: Set<String>
+	) -> [ThumbnailPrefetchFile] {
+		let resourceKeys: [URLResourceKey] = [
+			.isRegularFileKey,
+			.isSymbolicLinkKey,
+			.creationDateKey,
+			.contentModificationDateKey,
+			.fileSizeKey,
+		]
+		guard let urls = try? FileManager.default.contentsOfDirectory(
+			at: URL(fileURLWithPath: folder, isDirectory: true),
+			includingPropertiesForKeys: resourceKeys,
+			options: [.skipsHiddenFiles]
+		) else {
+			return []
+		}
+		var files: [ThumbnailPrefetchFile] = []
+		for url in urls where extensions.contains(url.pathExtension.lowercased()) {
+			guard let values = try? url.resourceValues(forKeys: Set(resourceKeys)),
+				  values.isRegularFile == true,
+				  values.isSymbolicLink != true else {
+				continue
+			}
+			let modificationDate = values.contentModificationDate
+				?? values.creationDate
+				?? Date(timeIntervalSince1970: 0)
+			files.append(ThumbnailPrefetchFile(
+				path: url.path,
+				// Same rounding as FileMetadata on the Flutter side.
+				modificationMicros: Int64(
+					(modificationDate.timeIntervalSince1970 * 1_000_000).rounded()
+				),
+				fileSize: Int64(values.fileSize ?? -1)
+			))
+		}
+		return files.sorted {
+			$0.path.lowercased() < $1.path.lowercased()
+		}
+	}
+
+	/// True when there was no keyboard or mouse input for a while.
+	private func isIdle() -> Bool {
+		let anyInput = CGEventType(rawValue: ~0)!
+		let idle = CGEventSource.secondsSinceLastEventType(
+			.combinedSessionState,
+			eventType: anyInput
+		)
+		return idle >= prefetchIdleSeconds
+	}
+
+	/// Thumbnails are stored as one pyramid per source: a few levels from
+	/// a single scaled decode. Callers get the smallest level covering their
+	/// pixel size as a byte range of the pack file holding it.
 	fileprivate func resolveSynchronously(
 		path: String,
 		modificationMicros: Int64,
 		fileSize: Int64,
 		pixelSize: Int
-	) throws -> URL {
-		let directory = try cacheDirectory()
-		try fileManager.createDirectory(
-			at: directory,
-			withIntermediateDirectories: true
-		)
-		let sourceURL = URL(fileURLWithPath: path)
-		let preservesAlpha = ["gif", "png", "tif", "tiff", "webp"]
-			.contains(sourceURL.pathExtension.lowercased())
-		let fileExtension = preservesAlpha ? "png" : "jpg"
-		let identity = cacheIdentity(
+	) throws -> ThumbnailLevel {
+		let store = try openStore()
+		let pyramidSize = pyramidSizes[pyramidSizes.count - 1]
+		if let level = pickLevel(
+			store,
 			path: path,
 			modificationMicros: modificationMicros,
 			fileSize: fileSize,
+			pyramidSize: pyramidSize,
 			pixelSize: pixelSize
-		)
-		let hash = Data(identity.utf8).sha256
-		let cachedURL = directory
-			.appendingPathComponent(hash)
-			.appendingPathExtension(fileExtension)
+		) {
+			return level
+		}
 
-		if fileManager.fileExists(atPath: cachedURL.path) {
-			touch(cachedURL)
-			return cachedURL
+		let (pyramid, placeholder) = try generatePyramid(path: path)
+		guard put(
+			pyramid,
+			path: path,
+			modificationMicros: modificationMicros,
+			fileSize: fileSize,
+			pixelSize: pyramidSize,
+			variant: .pyramid
+		) else {
+			throw ThumbnailCacheError.thumbnailEncodingFailed(path)
 		}
+		if let placeholder {
+			put(
+				placeholder,
+				path: path,
+				modificationMicros: modificationMicros,
+				fileSize: fileSize,
+				pixelSize: 0,
+				variant: .placeholder
+			)
+		}
+		guard let level = pickLevel(
+			store,
+			path: path,
+			modificationMicros: modificationMicros,
+			fileSize: fileSize,
+			pyramidSize: pyramidSize,
+			pixelSize: pixelSize
+		) else {
+			throw ThumbnailCacheError.thumbnailEncodingFailed(path)
+		}
+		return level
+	}
+
+	fileprivate func readLevel(_ level: ThumbnailLevel) throws -> Data {
+		let handle = try FileHandle(forReadingFrom: level.url)
+		defer { try? handle.close() }
+		try handle.seek(toOffset: UInt64(level.offset))
+		guard let data = try handle.read(upToCount: level.length),
+			  data.count == level.length else {
+			throw ThumbnailCacheError.thumbnailGenerationFailed(level.url.path)
+		}
+		return data
+	}
+
+	private func pickLevel(
+		_ store: ThumbnailStore,
+		path: String,
+		modificationMicros: Int64,
+		fileSize: Int64,
+		pyramidSize: Int,
+		pixelSize: Int
+	) -> ThumbnailLevel? {
+		var offset: UInt64 = 0
+		var length: UInt64 = 0
+		guard let packPath = store.locatePath(
+			path,
+			modification: modificationMicros,
+			fileSize: fileSize,
+			pixelSize: Int32(pyramidSize),
+			variant: ThumbnailVariant.pyramid.rawValue,
+			offset: &offset,
+			length: &length
+		) else {
+			return nil
+		}
+		let range = ImageUtils.thumbnailPyramidLevel(
+			packPath,
+			offset: offset,
+			length: length,
+			pixelSize: Int32(max(1, pixelSize))
+		)
+		guard range.location != NSNotFound else { return nil }
+		return ThumbnailLevel(
+			url: URL(fileURLWithPath: packPath),
+			offset: range.location,
+			length: range.length
+		)
+	}
 
+	/// Placeholder hash stored with the thumbnail of a source, if any:
+	/// a lookup in the mapped index, cheap enough for every scanned file.
+	fileprivate func placeholder(
+		path: String,
+		modificationMicros: Int64,
+		fileSize: Int64
+	) -> Data? {
+		store?.data(
+			forPath: path,
+			modification: modificationMicros,
+			fileSize: fileSize,
+			pixelSize: 0,
+			variant: ThumbnailVariant.placeholder.rawValue
+		)
+	}
+
+	/// The pyramid and the placeholder hash of its smallest level.
+	private func generatePyramid(path: String) throws -> (Data, Data?) {
+		if let generated = generateJpegPyramid(path: path) {
+			return generated
+		}
+		let sourceURL = URL(fileURLWithPath: path)
+		let preservesAlpha = ["gif", "png", "tif", "tiff", "webp"]
+			.contains(sourceURL.pathExtension.lowercased())
 		guard let source = CGImageSourceCreateWithURL(sourceURL as CFURL, [
 			kCGImageSourceShouldCache: false,
 		] as CFDictionary) else {
@@ -176,10 +591,10 @@ private final class ThumbnailDiskCache {
 		let options: [CFString: Any] = [
 			kCGImageSourceCreateThumbnailFromImageAlways: true,
 			kCGImageSourceCreateThumbnailWithTransform: true,
-			kCGImageSourceThumbnailMaxPixelSize: max(1, pixelSize),
+			kCGImageSourceThumbnailMaxPixelSize: pyramidSizes[pyramidSizes.count - 1],
 			kCGImageSourceShouldCacheImmediately: true,
 		]
-		guard let thumbnail = CGImageSourceCreateThumbnailAtIndex(
+		guard var image = CGImageSourceCreateThumbnailAtIndex(
 			source,
 			0,
 			options as CFDictionary
@@ -187,12 +602,66 @@ private final class ThumbnailDiskCache {
 			throw ThumbnailCacheError.thumbnailGenerationFailed(path)
 		}
 
-		let temporaryURL = directory
-			.appendingPathComponent(UUID().uuidString)
-			.appendingPathExtension("\(fileExtension).tmp")
+		// Largest first: each level is drawn from the previous one.
+		var levels: [Data] = []
+		for size in pyramidSizes.reversed() {
+			if max(image.width, image.height) > size {
+				guard let scaled = scale(image, to: size) else {
+					throw ThumbnailCacheError.thumbnailGenerationFailed(path)
+				}
+				image = scaled
+			} else if !levels.isEmpty {
+				// Small sources would only repeat the previous level.
+				continue
+			}
+			levels.insert(
+				try encode(image, preservesAlpha: preservesAlpha, path: path),
+				at: 0
+			)
+		}
+		guard let pyramid = ImageUtils.packThumbnailPyramid(levels) else {
+			throw ThumbnailCacheError.thumbnailEncodingFailed(path)
+		}
+		return (pyramid, ImageUtils.thumbHash(for: image))
+	}
+
+	/// Built by libimage from a single scaled decode (or the embedded
+	/// preview), nil when ImageIO has to do it (icc profiles included).
+	private func generateJpegPyramid(path: String) -> (Data, Data?)? {
+		guard ["jpg", "jpeg"].contains(URL(fileURLWithPath: path).pathExtension.lowercased()),
+			  let pyramid = ImageUtils.thumbnailPyramid(
+				of: path,
+				sizes: pyramidSizes.map { NSNumber(value: $0) },
+				quality: 82
+			  ) else {
+			return nil
+		}
+		var hash: Data?
+		if let smallest = ImageUtils.thumbnailPyramidLevelData(pyramid, pixelSize: 1),
+		   let source = CGImageSourceCreateWithData(smallest as CFData, nil),
+		   let image = CGImageSourceCreateImageAtIndex(source, 0, nil) {
+			hash = ImageUtils.thumbHash(for: image)
+		}
+		return (pyramid, hash)
+	}
+
+	/// Area-averaged by libimage, to the same pixels on every cpu.
+	private func scale(_ image: CGImage, to size: Int) -> CGImage? {
+		let ratio = Double(size) / Double(max(image.width, image.height))
+		let width = max(1, Int((Double(image.width) * ratio).rounded()))
+		let height = max(1, Int((Double(image.height) * ratio).rounded()))
+		return ImageUtils.resample(image, width: width, height: height)
+	}
+
+	private func encode(
+		_ image: CGImage,
+		preservesAlpha: Bool,
+		path: String
+	) throws -> Data {
+		let data = NSMutableData()
 		let outputType = preservesAlpha ? UTType.png.identifier : UTType.jpeg.identifier
-		guard let destination = CGImageDestinationCreateWithURL(
-			temporaryURL as CFURL,
+		guard let destination = CGImageDestinationCreateWithData(
+			data as CFMutableData,
 			outputType as CFString,
 			1,
 			nil
@@ -202,44 +671,141 @@ private final class ThumbnailDiskCache {
 		let properties: [CFString: Any] = preservesAlpha
 			? [:]
 			: [kCGImageDestinationLossyCompressionQuality: 0.82]
-		CGImageDestinationAddImage(destination, thumbnail, properties as CFDictionary)
+		CGImageDestinationAddImage(destination, image, properties as CFDictionary)
 		guard CGImageDestinationFinalize(destination) else {
-			try? fileManager.removeItem(at: temporaryURL)
 			throw ThumbnailCacheError.thumbnailEncodingFailed(path)
 		}
+		return data as Data
+	}
 
-		do {
-			if fileManager.fileExists(atPath: cachedURL.path) {
-				try fileManager.removeItem(at: temporaryURL)
-			} else {
-				try fileManager.moveItem(at: temporaryURL, to: cachedURL)
-			}
-		} catch {
-			try? fileManager.removeItem(at: temporaryURL)
-			throw error
+	private func resolvePixelsSynchronously(
+		path: String,
+		modificationMicros: Int64,
+		fileSize: Int64,
+		pixelSize: Int,
+		displaySize: Int
+	) throws -> ThumbnailPixels {
+		let store = try openStore()
+		if let data = store.data(
+			forPath: path,
+			modification: modificationMicros,
+			fileSize: fileSize,
+			pixelSize: Int32(displaySize),
+			variant: ThumbnailVariant.pixels.rawValue
+		), let pixels = decodePixels(data) {
+			return pixels
 		}
-		touch(cachedURL)
-		schedulePrune()
-		return cachedURL
+
+		// derive from the encoded tier (generated if needed)
+		let level = try resolveSynchronously(
+			path: path,
+			modificationMicros: modificationMicros,
+			fileSize: fileSize,
+			pixelSize: displaySize
+		)
+		let encoded = try readLevel(level)
+		let options: [CFString: Any] = [
+			kCGImageSourceCreateThumbnailFromImageAlways: true,
+			kCGImageSourceThumbnailMaxPixelSize: max(1, displaySize),
+			kCGImageSourceShouldCacheImmediately: true,
+		]
+		guard let source = CGImageSourceCreateWithData(encoded as CFData, nil),
+			  let image = CGImageSourceCreateThumbnailAtIndex(
+				source,
+				0,
+				options as CFDictionary
+			  ) else {
+			throw ThumbnailCacheError.thumbnailGenerationFailed(path)
+		}
+		guard let data = ImageUtils.encodeRawThumbnail(image),
+			  let pixels = decodePixels(data) else {
+			throw ThumbnailCacheError.thumbnailEncodingFailed(path)
+		}
+		// A failed store only costs a decode next time.
+		put(
+			data,
+			path: path,
+			modificationMicros: modificationMicros,
+			fileSize: fileSize,
+			pixelSize: displaySize,
+			variant: .pixels
+		)
+		return pixels
 	}
 
-	fileprivate func cacheIdentity(
+	private func decodePixels(_ data: Data) -> ThumbnailPixels? {
+		var width: Int32 = 0
+		var height: Int32 = 0
+		guard let pixels = ImageUtils.decodeRawThumbnail(
+			data,
+			width: &width,
+			height: &height
+		) else {
+			return nil
+		}
+		return ThumbnailPixels(
+			width: Int(width),
+			height: Int(height),
+			pixels: pixels
+		)
+	}
+
+	@discardableResult
+	fileprivate func put(
+		_ data: Data,
 		path: String,
 		modificationMicros: Int64,
 		fileSize: Int64,
-		pixelSize: Int
-	) -> String {
-		[
-			cacheVersion,
+		pixelSize: Int,
+		variant: ThumbnailVariant
+	) -> Bool {
+		guard let store, store.storeData(
+			data,
+			forPath: path,
+			modification: modificationMicros,
+			fileSize: fileSize,
+			pixelSize: Int32(pixelSize),
+			variant: variant.rawValue
+		) else {
+			return false
+		}
+		storedBytesLock.lock()
+		storedBytes += data.count
+		storedBytesLock.unlock()
+		scheduleCompaction()
+		return true
+	}
+
+	private func contains(
+		_ store: ThumbnailStore,
+		path: String,
+		modificationMicros: Int64,
+		fileSize: Int64,
+		pixelSize: Int,
+		variant: ThumbnailVariant
+	) -> Bool {
+		var offset: UInt64 = 0
+		var length: UInt64 = 0
+		return store.locatePath(
 			path,
-			String(modificationMicros),
-			String(fileSize),
-			String(pixelSize),
-		].joined(separator: "\u{0}")
+			modification: modificationMicros,
+			fileSize: fileSize,
+			pixelSize: Int32(pixelSize),
+			variant: variant.rawValue,
+			offset: &offset,
+			length: &length
+		) != nil
+	}
+
+	fileprivate func openStore() throws -> ThumbnailStore {
+		guard let store else {
+			throw ThumbnailCacheError.cacheDirectoryUnavailable
+		}
+		return store
 	}
 
-	fileprivate func cacheDirectory() throws -> URL {
-		guard let root = fileManager.urls(
+	private static func cacheRoot() throws -> URL {
+		guard let root = FileManager.default.urls(
 			for: .cachesDirectory,
 			in: .userDomainMask
 		).first else {
@@ -249,79 +815,50 @@ private final class ThumbnailDiskCache {
 		return root
 			.appendingPathComponent(bundleIdentifier, isDirectory: true)
 			.appendingPathComponent("thumbnails", isDirectory: true)
-			.appendingPathComponent(cacheVersion, isDirectory: true)
 	}
 
-	fileprivate func touch(_ url: URL) {
-		try? fileManager.setAttributes(
-			[.modificationDate: Date()],
-			ofItemAtPath: url.path
-		)
+	private static func cacheDirectory() throws -> URL {
+		try cacheRoot().appendingPathComponent(cacheVersion, isDirectory: true)
 	}
 
-	fileprivate func schedulePrune() {
-		pruneLock.lock()
-		guard !pruneScheduled else {
-			pruneLock.unlock()
+	/// Earlier versions stored one file per thumbnail: they are never read
+	/// again once the version changes.
+	private static func removePreviousVersions() {
+		guard let root = try? cacheRoot(),
+			  let versions = try? FileManager.default.contentsOfDirectory(
+				at: root,
+				includingPropertiesForKeys: nil
+			  ) else {
 			return
 		}
-		pruneScheduled = true
-		pruneLock.unlock()
-		maintenanceQueue.async { [weak self] in
-			guard let self else { return }
-			defer {
-				self.pruneLock.lock()
-				self.pruneScheduled = false
-				self.pruneLock.unlock()
-			}
-			self.pruneIfNeeded()
+		for version in versions where version.lastPathComponent != cacheVersion {
+			try? FileManager.default.removeItem(at: version)
 		}
 	}
 
-	private func pruneIfNeeded() {
-		guard let directory = try? cacheDirectory(),
-			  let enumerator = fileManager.enumerator(
-				at: directory,
-				includingPropertiesForKeys: [
-					.fileSizeKey,
-					.contentModificationDateKey,
-					.isRegularFileKey,
-				],
-				options: [.skipsHiddenFiles]
-			  ) else {
+	/// Evictions leave holes in the pack files: they are rewritten in the
+	/// background once the holes are worth it.
+	fileprivate func scheduleCompaction() {
+		compactionLock.lock()
+		guard !compactionScheduled else {
+			compactionLock.unlock()
 			return
 		}
-		var entries: [CacheEntry] = []
-		var totalSize = 0
-		for case let url as URL in enumerator {
-			if url.pathExtension == "tmp" { continue }
-			guard let values = try? url.resourceValues(forKeys: [
-				.fileSizeKey,
-				.contentModificationDateKey,
-				.isRegularFileKey,
-			]), values.isRegularFile == true else {
-				continue
+		compactionScheduled = true
+		compactionLock.unlock()
+		maintenanceQueue.async { [weak self] in
+			guard let self else { return }
+			defer {
+				self.compactionLock.lock()
+				self.compactionScheduled = false
+				self.compactionLock.unlock()
 			}
-			let size = values.fileSize ?? 0
-			totalSize += size
-			entries.append(CacheEntry(
-				url: url,
-				size: size,
-				lastAccess: values.contentModificationDate ?? .distantPast
-			))
-		}
-		guard totalSize > cacheLimitBytes else { return }
-		for entry in entries.sorted(by: { $0.lastAccess < $1.lastAccess }) {
-			try? fileManager.removeItem(at: entry.url)
-			totalSize -= entry.size
-			if totalSize <= cacheTargetBytes { break }
+			self.store?.compact()
 		}
 	}
 }
 
 private final class VisualFeatureDiskCache {
-	private let featureVersion = "vision-v1-revision1"
-	private let fileManager = FileManager.default
 	private let thumbnailCache: ThumbnailDiskCache
 
 	init(thumbnailCache: ThumbnailDiskCache) {
@@ -333,7 +870,7 @@ private final class VisualFeatureDiskCache {
 		candidate: VisualFeatureSource,
 		completion: @escaping (Result<Double, Error>) -> Void
 	) {
-		thumbnailCache.perform({
+		thumbnailCache.perform(.visible, path: source.path, {
 			let sourceFeature = try self.resolveSynchronously(source)
 			let candidateFeature = try self.resolveSynchronously(candidate)
 			var distance: Float = 0
@@ -351,29 +888,17 @@ private final class VisualFeatureDiskCache {
 	private func resolveSynchronously(
 		_ source: VisualFeatureSource
 	) throws -> VNFeaturePrintObservation {
-		let directory = try thumbnailCache.cacheDirectory()
-		try fileManager.createDirectory(
-			at: directory,
-			withIntermediateDirectories: true
-		)
-		let thumbnailIdentity = thumbnailCache.cacheIdentity(
-			path: source.path,
-			modificationMicros: source.modificationMicros,
+		if let data = try thumbnailCache.openStore().data(
+			forPath: source.path,
+			modification: source.modificationMicros,
 			fileSize: source.fileSize,
-			pixelSize: source.pixelSize
-		)
-		let featureIdentity = [featureVersion, thumbnailIdentity]
-			.joined(separator: "\u{0}")
-		let featureURL = directory
-			.appendingPathComponent(Data(featureIdentity.utf8).sha256)
-			.appendingPathExtension("vision")
-
-		if let cached = load(featureURL) {
-			thumbnailCache.touch(featureURL)
+			pixelSize: Int32(source.pixelSize),
+			variant: ThumbnailVariant.visualFeatures.rawValue
+		), let cached = load(data) {
 			return cached
 		}
 
-		let thumbnailURL = try thumbnailCache.resolveSynchronously(
+		let level = try thumbnailCache.resolveSynchronously(
 			path: source.path,
 			modificationMicros: source.modificationMicros,
 			fileSize: source.fileSize,
@@ -381,29 +906,33 @@ private final class VisualFeatureDiskCache {
 		)
 		let request = VNGenerateImageFeaturePrintRequest()
 		request.revision = VNGenerateImageFeaturePrintRequestRevision1
-		let handler = VNImageRequestHandler(url: thumbnailURL, options: [:])
+		let handler = VNImageRequestHandler(
+			data: try thumbnailCache.readLevel(level),
+			options: [:]
+		)
 		try handler.perform([request])
 		guard let observation = request.results?.first else {
 			throw VisualFeatureCacheError.featureGenerationFailed(source.path)
 		}
 
-		do {
-			let archive = try NSKeyedArchiver.archivedData(
-				withRootObject: observation,
-				requiringSecureCoding: true
-			)
-			try archive.write(to: featureURL, options: .atomic)
-		} catch {
+		guard let archive = try? NSKeyedArchiver.archivedData(
+			withRootObject: observation,
+			requiringSecureCoding: true
+		), thumbnailCache.put(
+			archive,
+			path: source.path,
+			modificationMicros: source.modificationMicros,
+			fileSize: source.fileSize,
+			pixelSize: source.pixelSize,
+			variant: .visualFeatures
+		) else {
 			throw VisualFeatureCacheError.featureArchiveFailed(source.path)
 		}
-		thumbnailCache.touch(featureURL)
-		thumbnailCache.schedulePrune()
 		return observation
 	}
 
-	private func load(_ url: URL) -> VNFeaturePrintObservation? {
-		guard let data = try? Data(contentsOf: url),
-			  let observation = try? NSKeyedUnarchiver.unarchivedObject(
+	private func load(_ data: Data) -> VNFeaturePrintObservation? {
+		guard let observation = try? NSKeyedUnarchiver.unarchivedObject(
 				ofClass: VNFeaturePrintObservation.self,
 				from: data
 			  ) else {
@@ -446,8 +975,18 @@ class AppDelegate: FlutterAppDelegate, FlutterStreamHandler {
 	private lazy var _visualFeatureCache = VisualFeatureDiskCache(
 		thumbnailCache: _thumbnailCache
 	)
+	// Same as MediaUtils.imageExtensions on the Dart side.
+	private static let scanProbeExtensions: Set<String> = [
+		"jpg", "jpeg", "heic", "png", "gif", "tif", "tiff", "webp",
+	]
 	
 	override func applicationDidFinishLaunching(_ notification: Notification) {
+		// Marker index shared by the cutils jpeg readers: cached per file.
+		if let caches = FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask).first {
+			let bundleIdentifier = Bundle.main.bundleIdentifier ?? "com.nabocorp.foto"
+			ImageUtils.openJpegIndexCache(in: caches.appendingPathComponent(bundleIdentifier, isDirectory: true).path)
+		}
+
 		guard let rootController = mainFlutterWindow?.contentViewController else {
 			return
 		}
@@ -490,6 +1029,7 @@ class AppDelegate: FlutterAppDelegate, FlutterStreamHandler {
 
 	override func applicationWillTerminate(_ notification: Notification) {
 		(mainFlutterWindow as? MainFlutterWindow)?.exitInstantFullScreen()
+		ImageUtils.closeJpegIndexCache()
 	}
 	
 	public func onListen(withArguments arguments: Any?, eventSink events: @escaping FlutterEventSink) -> FlutterError? {
@@ -572,7 +1112,8 @@ class AppDelegate: FlutterAppDelegate, FlutterStreamHandler {
 				  let path = arguments["path"] as? String,
 				  let modificationMicros = arguments["modificationMicros"] as? NSNumber,
 				  let fileSize = arguments["fileSize"] as? NSNumber,
-				  let pixelSize = arguments["pixelSize"] as? NSNumber else {
+				  let pixelSize = arguments["pixelSize"] as? NSNumber,
+				  let job = ThumbnailJob(arguments: arguments) else {
 				result(FlutterError(
 					code: "invalid_thumbnail_request",
 					message: "Thumbnail source metadata is required.",
@@ -584,11 +1125,66 @@ class AppDelegate: FlutterAppDelegate, FlutterStreamHandler {
 				path: path,
 				modificationMicros: modificationMicros.int64Value,
 				fileSize: fileSize.int64Value,
-				pixelSize: pixelSize.intValue
+				pixelSize: pixelSize.intValue,
+				job: job
 			) { outcome in
 				switch outcome {
-				case .success(let url):
-					result(url.path)
+				case .success(let level):
+					result([
+						"path": level.url.path,
+						"offset": level.offset,
+						"length": level.length,
+					])
+				case .failure(ThumbnailCacheError.requestCancelled):
+					result(FlutterError(
+						code: "thumbnail_cancelled",
+						message: "The thumbnail request was cancelled.",
+						details: path
+					))
+				case .failure(let error):
+					result(FlutterError(
+						code: "thumbnail_cache_failed",
+						message: error.localizedDescription,
+						details: path
+					))
+				}
+			}
+		} else if ("loadCachedThumbnailPixels" == call.method) {
+			guard let arguments = call.arguments as? [String: Any],
+				  let path = arguments["path"] as? String,
+				  let modificationMicros = arguments["modificationMicros"] as? NSNumber,
+				  let fileSize = arguments["fileSize"] as? NSNumber,
+				  let pixelSize = arguments["pixelSize"] as? NSNumber,
+				  let displaySize = arguments["displaySize"] as? NSNumber,
+				  let job = ThumbnailJob(arguments: arguments) else {
+				result(FlutterError(
+					code: "invalid_thumbnail_request",
+					message: "Thumbnail source metadata is required.",
+					details: call.arguments
+				))
+				return
+			}
+			_thumbnailCache.resolvePixels(
+				path: path,
+				modificationMicros: modificationMicros.int64Value,
+				fileSize: fileSize.int64Value,
+				pixelSize: pixelSize.intValue,
+				displaySize: displaySize.intValue,
+				job: job
+			) { outcome in
+				switch outcome {
+				case .success(let thumbnail):
+					result([
+						"width": thumbnail.width,
+						"height": thumbnail.height,
+						"pixels": FlutterStandardTypedData(bytes: thumbnail.pixels),
+					])
+				case .failure(ThumbnailCacheError.requestCancelled):
+					result(FlutterError(
+						code: "thumbnail_cancelled",
+						message: "The thumbnail request was cancelled.",
+						details: path
+					))
 				case .failure(let error):
 					result(FlutterError(
 						code: "thumbnail_cache_failed",
@@ -623,6 +1219,31 @@ class AppDelegate: FlutterAppDelegate, FlutterStreamHandler {
 					))
 				}
 			}
+		} else if ("prefetchThumbnails" == call.method) {
+			guard let request = ThumbnailPrefetchRequest(arguments: call.arguments) else {
+				result(FlutterError(
+					code: "invalid_thumbnail_prefetch",
+					message: "Folders, extensions, sizes and budgets are required.",
+					details: call.arguments
+				))
+				return
+			}
+			_thumbnailCache.prefetch(request)
+			result(true)
+		} else if ("cancelThumbnailPrefetch" == call.method) {
+			_thumbnailCache.cancelPrefetch()
+			result(true)
+		} else if ("cancelThumbnailRequests" == call.method) {
+			guard let view = call.arguments as? NSNumber else {
+				result(FlutterError(
+					code: "invalid_thumbnail_request",
+					message: "A thumbnail view is required.",
+					details: call.arguments
+				))
+				return
+			}
+			_thumbnailCache.cancelRequests(view: view.uint32Value)
+			result(true)
 		} else if ("clearThumbnailCache" == call.method) {
 			_thumbnailCache.clear { outcome in
 				switch outcome {
@@ -807,12 +1428,14 @@ class AppDelegate: FlutterAppDelegate, FlutterStreamHandler {
 			return
 		}
 
+		let thumbnailCache = _thumbnailCache
 		DispatchQueue.global(qos: .userInitiated).async {
 			do {
 				let directoryURL = URL(fileURLWithPath: filepath, isDirectory: true)
 				let directoryValues = try directoryURL.resourceValues(forKeys: [
 					.isDirectoryKey,
 					.isSymbolicLinkKey,
+					.volumeIsLocalKey,
 				])
 				guard directoryValues.isDirectory == true,
 					  directoryValues.isSymbolicLink != true else {
@@ -841,6 +1464,7 @@ class AppDelegate: FlutterAppDelegate, FlutterStreamHandler {
 				)
 
 				var entries: [[String: Any]] = []
+				var probed: [Int] = []
 				entries.reserveCapacity(urls.count)
 				for url in urls {
 					let values: URLResourceValues
@@ -873,9 +1497,38 @@ class AppDelegate: FlutterAppDelegate, FlutterStreamHandler {
 					if type == "file", let fileSize = values.fileSize {
 						entry["size"] = fileSize
 					}
+					// Same identity as the gallery thumbnail request.
+					if type == "file", let placeholder = thumbnailCache.placeholder(
+						path: url.path,
+						modificationMicros: Int64(
+							(modificationDate.timeIntervalSince1970 * 1_000_000).rounded()
+						),
+						fileSize: Int64(values.fileSize ?? -1)
+					) {
+						entry["placeholder"] = FlutterStandardTypedData(bytes: placeholder)
+					}
+					if type == "file", AppDelegate.scanProbeExtensions.contains(url.pathExtension.lowercased()) {
+						probed.append(entries.count)
+					}
 					entries.append(entry)
 				}
 
+				// Capture dates and sizes come from batched header reads, which
+				// the justified layout uses. Remote listings must not read files.
+				if directoryValues.volumeIsLocal == true, !probed.isEmpty {
+					let paths = probed.map { entries[$0]["path"] as! String }
+					let results = ImageUtils.probeImages(paths)
+					for (index, probe) in zip(probed, results) {
+						if let captureDate = probe["captureDate"] as? Date {
+							entries[index]["captureDate"] = captureDate.timeIntervalSince1970
+						}
+						if let width = probe["width"] as? Int, let height = probe["height"] as? Int {
+							entries[index]["width"] = width
+							entries[index]["height"] = height
+						}
+					}
+				}
+
 				DispatchQueue.main.async {
 					result(entries)
 				}
@@ -938,6 +1591,25 @@ class AppDelegate: FlutterAppDelegate, FlutterStreamHandler {
 			let transformation = ImageTransformation(rawValue: transformationNumber.uint32Value)
 			let rc = ImageUtils.transformImage(filepath, withTransform: transformation, jpegCompression: compressionNumber.floatValue);
 			result(rc);
+		} else if ("transformImages" == call.method) {
+			guard let args = call.arguments as? [String:Any],
+				  let filepaths = args["filepaths"] as? [String],
+				  let transformationNumber = args["transformation"] as? NSNumber,
+				  let compressionNumber = args["jpegCompression"] as? NSNumber else {
+				result(FlutterError(code: "invalid_arguments", message: "Paths, a transformation, and JPEG compression are required.", details: call.arguments))
+				return
+			}
+			guard transformationNumber.uint32Value <= 4 else {
+				result(FlutterError(code: "invalid_transformation", message: "The requested image transformation is invalid.", details: transformationNumber))
+				return
+			}
+			let transformation = ImageTransformation(rawValue: transformationNumber.uint32Value)
+			DispatchQueue.global(qos: .userInitiated).async {
+				let rc = ImageUtils.transformImages(filepaths, withTransform: transformation, jpegCompression: compressionNumber.floatValue)
+				DispatchQueue.main.async {
+					result(rc.map { $0.boolValue })
+				}
+			}
 		} else if ("losslessRotate" == call.method) {
 			guard let filepath = call.arguments as? String else {
 				result(FlutterError(code: "invalid_path", message: "A valid filesystem path is required.", details: nil))
@@ -10,6 +10,8 @@
 
 #include "FileUtils.h"
 #include "ImageUtils.h"
+#include "JobQueue.h"
 #include "SystemUtils.h"
+#include "ThumbnailStore.h"
 
 #endif /* Runner_Bridging_Header_h */
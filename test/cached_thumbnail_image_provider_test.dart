@@ -1,9 +1,12 @@
 import 'dart:async';
 import 'dart:io';
+import 'dart:typed_data';
 
 import 'package:flutter/material.dart';
+import 'package:flutter/services.dart';
 import 'package:flutter_test/flutter_test.dart';
 import 'package:foto/utils/cached_thumbnail_image_provider.dart';
+import 'package:foto/utils/platform_utils.dart';
 
 void main() {
   TestWidgetsFlutterBinding.ensureInitialized();
@@ -16,14 +19,18 @@ void main() {
     DateTime? modificationDate,
     int? fileSize = 42,
     int pixelSize = 960,
-    ThumbnailPathResolver? resolver,
+    int? displaySize,
+    CachedThumbnailResolver? resolver,
+    ThumbnailPixelsLoader? pixelsLoader,
   }) {
     return CachedThumbnailImageProvider(
       path: original.path,
       modificationDate: modificationDate ?? DateTime(2026, 7, 13),
       fileSize: fileSize,
       pixelSize: pixelSize,
+      displaySize: displaySize,
       resolver: resolver,
+      pixelsLoader: pixelsLoader,
     );
   }
 
@@ -76,6 +83,14 @@ void main() {
     );
     expect(provider(fileSize: 43), isNot(originalProvider));
     expect(provider(pixelSize: 1200), isNot(originalProvider));
+    expect(provider(displaySize: 720), isNot(originalProvider));
+    expect(
+      provider().scheduled(
+        priority: ThumbnailPriority.nearVisible,
+        view: ThumbnailView(),
+      ),
+      originalProvider,
+    );
   });
 
   testWidgets('loads the native cached thumbnail path', (tester) async {
@@ -86,12 +101,14 @@ void main() {
         required modificationDate,
         required fileSize,
         required pixelSize,
+        required priority,
+        required view,
       }) async {
         resolveCount += 1;
         expect(path, original.path);
         expect(fileSize, 42);
         expect(pixelSize, 960);
-        return cached.path;
+        return CachedThumbnail(path: cached.path);
       },
     );
 
@@ -110,6 +127,8 @@ void main() {
         required modificationDate,
         required fileSize,
         required pixelSize,
+        required priority,
+        required view,
       }) {
         throw StateError('cache unavailable');
       },
@@ -129,8 +148,169 @@ void main() {
         required modificationDate,
         required fileSize,
         required pixelSize,
+        required priority,
+        required view,
+      }) async {
+        return CachedThumbnail(
+          path: '${temporaryDirectory.path}/missing.png',
+        );
+      },
+    );
+
+    final info = (await tester.runAsync(() => load(imageProvider)))!;
+
+    expect(info.image.width, greaterThan(0));
+    expect(info.image.height, greaterThan(0));
+  });
+
+  testWidgets('wraps texture-ready pixels without resolving a path',
+      (tester) async {
+    var resolveCount = 0;
+    final imageProvider = provider(
+      displaySize: 720,
+      resolver: ({
+        required path,
+        required modificationDate,
+        required fileSize,
+        required pixelSize,
+        required priority,
+        required view,
+      }) async {
+        resolveCount += 1;
+        return CachedThumbnail(path: cached.path);
+      },
+      pixelsLoader: ({
+        required path,
+        required modificationDate,
+        required fileSize,
+        required pixelSize,
+        required displaySize,
+        required priority,
+        required view,
+      }) async {
+        expect(displaySize, 720);
+        return ThumbnailPixels(
+          width: 3,
+          height: 2,
+          pixels: Uint8List(3 * 2 * 4),
+        );
+      },
+    );
+
+    final info = (await tester.runAsync(() => load(imageProvider)))!;
+
+    expect(resolveCount, 0);
+    expect(info.image.width, 3);
+    expect(info.image.height, 2);
+  });
+
+  testWidgets('falls back to the encoded thumbnail without pixels',
+      (tester) async {
+    var resolveCount = 0;
+    final imageProvider = provider(
+      displaySize: 720,
+      resolver: ({
+        required path,
+        required modificationDate,
+        required fileSize,
+        required pixelSize,
+        required priority,
+        required view,
+      }) async {
+        resolveCount += 1;
+        return CachedThumbnail(path: cached.path);
+      },
+      pixelsLoader: ({
+        required path,
+        required modificationDate,
+        required fileSize,
+        required pixelSize,
+        required displaySize,
+        required priority,
+        required view,
+      }) {
+        throw StateError('raw tier unavailable');
+      },
+    );
+
+    final info = (await tester.runAsync(() => load(imageProvider)))!;
+
+    expect(resolveCount, 1);
+    expect(info.image.width, greaterThan(3));
+  });
+
+  testWidgets('cancelled requests fail without decoding the source',
+      (tester) async {
+    final galleryView = ThumbnailView();
+    final requests = <(ThumbnailPriority, int)>[];
+    final imageProvider = provider(
+      displaySize: 720,
+      resolver: ({
+        required path,
+        required modificationDate,
+        required fileSize,
+        required pixelSize,
+        required priority,
+        required view,
+      }) {
+        fail('a cancelled request must not fall back');
+      },
+      pixelsLoader: ({
+        required path,
+        required modificationDate,
+        required fileSize,
+        required pixelSize,
+        required displaySize,
+        required priority,
+        required view,
+      }) async {
+        requests.add((priority, view.id));
+        throw PlatformException(code: PlatformUtils.thumbnailCancelled);
+      },
+    ).scheduled(priority: ThumbnailPriority.nearVisible, view: galleryView);
+
+    final error = await tester.runAsync(() async {
+      try {
+        await load(imageProvider);
+        return null;
+      } catch (error) {
+        return error;
+      }
+    });
+
+    expect(
+      error,
+      isA<PlatformException>().having(
+        (error) => error.code,
+        'code',
+        PlatformUtils.thumbnailCancelled,
+      ),
+    );
+    expect(requests, [(ThumbnailPriority.nearVisible, galleryView.id)]);
+    expect(
+      PaintingBinding.instance.imageCache.containsKey(imageProvider),
+      isFalse,
+    );
+  });
+
+  testWidgets('reads only the resolved pyramid level', (tester) async {
+    final bytes = await cached.readAsBytes();
+    final pyramid = await File('${temporaryDirectory.path}/cached.pyramid')
+        .writeAsBytes([...List<int>.filled(72, 0), ...bytes, 0, 0, 0]);
+    final imageProvider = provider(
+      resolver: ({
+        required path,
+        required modificationDate,
+        required fileSize,
+        required pixelSize,
+        required priority,
+        required view,
       }) async {
-        return '${temporaryDirectory.path}/missing.png';
+        return CachedThumbnail(
+          path: pyramid.path,
+          offset: 72,
+          length: bytes.length,
+        );
       },
     );
 
@@ -37,6 +37,7 @@ void main() {
           'creationDate': 1.25,
           'modificationDate': 2.5,
           'size': 42,
+          'placeholder': Uint8List.fromList([1, 2, 3, 4, 5]),
         },
         <Object?, Object?>{
           'path': '/network/photos/folder',
@@ -53,12 +54,58 @@ void main() {
     expect(entries, hasLength(2));
     expect(entries.first.entityType, FileSystemEntityType.file);
     expect(entries.first.size, 42);
+    expect(entries.first.placeholder, [1, 2, 3, 4, 5]);
     expect(entries.first.creationDate.microsecondsSinceEpoch, 1250000);
     expect(entries.last.entityType, FileSystemEntityType.directory);
     expect(entries.last.size, isNull);
+    expect(entries.last.placeholder, isNull);
     expect(entries.last.modificationDate.microsecondsSinceEpoch, 4000000);
   });
 
+  test('local scans sort by the capture dates probed natively', () async {
+    TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+        .setMockMethodCallHandler(fileChannel, (_) async {
+      return <Object?>[
+        <Object?, Object?>{
+          'path': '/photos/copied-first.jpg',
+          'type': 'file',
+          'creationDate': 10.0,
+          'modificationDate': 10.0,
+          'size': 100,
+          'captureDate': 30.0,
+          'width': 4000,
+          'height': 6000,
+        },
+        <Object?, Object?>{
+          'path': '/photos/copied-last.png',
+          'type': 'file',
+          'creationDate': 20.0,
+          'modificationDate': 20.0,
+          'size': 100,
+        },
+      ];
+    });
+
+    final items = await MediaUtils.getMediaFiles(
+      MediaDb(),
+      '/photos',
+      includeDirs: false,
+      sortCriteria: SortCriteria.chronological,
+    );
+
+    expect(items.map((item) => item.path), [
+      '/photos/copied-last.png',
+      '/photos/copied-first.jpg',
+    ]);
+    expect(items.last.captureDateParsed, isTrue);
+    expect(items.last.creationDate.microsecondsSinceEpoch, 30000000);
+    expect(items.last.imageSize?.width, 4000);
+    expect(items.last.imageSize?.height, 6000);
+    expect(items.last.mediaInfoParsed, isTrue);
+    expect(items.first.captureDateParsed, isFalse);
+    expect(items.first.imageSize, isNull);
+  });
+
   test('gallery listing returns before capture-date extraction', () async {
     var imageCalls = 0;
     final messenger =
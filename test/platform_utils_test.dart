@@ -138,10 +138,14 @@ void main() {
     TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
         .setMockMethodCallHandler(channel, (call) async {
       received = call;
-      return '/Users/test/Library/Caches/com.nabocorp.foto/thumb.jpg';
+      return {
+        'path': '/Users/test/Library/Caches/com.nabocorp.foto/thumbnails/v2/pack-00000003',
+        'offset': 12006,
+        'length': 153690,
+      };
     });
 
-    final cachedPath = await PlatformUtils.resolveCachedThumbnail(
+    final thumbnail = await PlatformUtils.resolveCachedThumbnail(
       path: '/Volumes/Photos/image.jpg',
       modificationDate: DateTime.fromMicrosecondsSinceEpoch(1234567),
       fileSize: 987654,
@@ -153,8 +157,55 @@ void main() {
       'modificationMicros': 1234567,
       'fileSize': 987654,
       'pixelSize': 960,
+      'priority': 0,
+      'view': 0,
     });
-    expect(cachedPath, endsWith('thumb.jpg'));
+    expect(thumbnail.path, endsWith('pack-00000003'));
+    expect(thumbnail.offset, 12006);
+    expect(thumbnail.length, 153690);
+  });
+
+  test('thumbnail requests carry their priority and view', () async {
+    final calls = <MethodCall>[];
+    TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+        .setMockMethodCallHandler(channel, (call) async {
+      calls.add(call);
+      if (call.method == 'loadCachedThumbnailPixels') {
+        return {
+          'width': 1,
+          'height': 1,
+          'pixels': Uint8List(4),
+        };
+      }
+      return true;
+    });
+
+    final view = ThumbnailView();
+    await PlatformUtils.loadCachedThumbnailPixels(
+      path: '/Volumes/Photos/image.jpg',
+      modificationDate: DateTime.fromMicrosecondsSinceEpoch(1234567),
+      fileSize: 987654,
+      pixelSize: 960,
+      displaySize: 720,
+      priority: ThumbnailPriority.nearVisible,
+      view: view,
+    );
+    await PlatformUtils.cancelThumbnailRequests(view);
+    await PlatformUtils.cancelThumbnailRequests(ThumbnailView.shared);
+
+    expect(calls.map((call) => call.method),
+        ['loadCachedThumbnailPixels', 'cancelThumbnailRequests']);
+    expect(calls.first.arguments, {
+      'path': '/Volumes/Photos/image.jpg',
+      'modificationMicros': 1234567,
+      'fileSize': 987654,
+      'pixelSize': 960,
+      'displaySize': 720,
+      'priority': 1,
+      'view': view.id,
+    });
+    expect(view.id, inInclusiveRange(1, ThumbnailView.maxViews));
+    expect(calls.last.arguments, view.id);
   });
 
   test('thumbnail cache clear requires native confirmation', () async {
@@ -170,6 +221,36 @@ void main() {
     expect(methods, ['clearThumbnailCache']);
   });
 
+  test('thumbnail prefetch forwards folders and budgets', () async {
+    final calls = <MethodCall>[];
+    TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+        .setMockMethodCallHandler(channel, (call) async {
+      calls.add(call);
+      return true;
+    });
+
+    await PlatformUtils.prefetchThumbnails(
+      folders: ['/photos/2026-02', '/photos/2025-12'],
+      extensions: {'jpg', 'heic'},
+      pixelSize: 960,
+      displaySize: 720,
+      maxSourceBytes: 4096,
+      maxCacheBytes: 1024,
+    );
+    await PlatformUtils.cancelThumbnailPrefetch();
+
+    expect(calls.map((call) => call.method),
+        ['prefetchThumbnails', 'cancelThumbnailPrefetch']);
+    expect(calls.first.arguments, {
+      'folders': ['/photos/2026-02', '/photos/2025-12'],
+      'extensions': ['jpg', 'heic'],
+      'pixelSize': 960,
+      'displaySize': 720,
+      'maxSourceBytes': 4096,
+      'maxCacheBytes': 1024,
+    });
+  });
+
   test('visual similarity forwards both metadata identities', () async {
     TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
         .setMockMethodCallHandler(channel, (call) async {
@@ -76,6 +76,15 @@ void main() {
     expect(notifications, 1);
   });
 
+  test('thumbnail prefetch is opt-in and persists', () async {
+    final preferences = await preferencesWith({});
+    expect(preferences.prefetchThumbnails, isFalse);
+
+    preferences.prefetchThumbnails = true;
+    final stored = await SharedPreferences.getInstance();
+    expect(stored.getBool('browser.prefetch_thumbnails'), isTrue);
+  });
+
   test('invalid saved window bounds fall back to a usable window', () async {
     for (final bounds in <String>[
       'not,bounds',
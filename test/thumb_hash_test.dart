@@ -0,0 +1,62 @@
+import 'dart:typed_data';
+
+import 'package:flutter_test/flutter_test.dart';
+import 'package:foto/utils/thumb_hash.dart';
+
+// Hashes of 100x75 and 100x100 gradients from thumb_hash.cpp: red grows
+// left to right, green top to bottom; the second one fades out to the right.
+final _opaque = Uint8List.fromList([
+  223, 7, 10, 53, 154, 128, 135, 135, 128, 136, 119, //
+  135, 136, 120, 135, 135, 128, 128, 7, 248, 135,
+]);
+final _translucent = Uint8List.fromList([
+  92, 167, 133, 29, 12, 56, 66, 119, 64, 120, 119, 119, 135, //
+  67, 64, 39, 244, 139, 127, 136, 120, 136, 136, 120, 136,
+]);
+
+List<int> _pixel(ThumbHashPixels decoded, int x, int y) {
+  final i = (y * decoded.width + x) * 4;
+  return decoded.pixels.sublist(i, i + 4);
+}
+
+Matcher _closeTo(List<int> expected) {
+  return pairwiseCompare<int, int>(
+    expected,
+    (expected, actual) => (actual - expected).abs() <= 2,
+    'within 2 of',
+  );
+}
+
+void main() {
+  test('placeholders keep the aspect ratio of the source', () {
+    expect(ThumbHash.aspectRatio(_opaque), closeTo(7 / 5, 1e-9));
+
+    final decoded = ThumbHash.decode(_opaque)!;
+    expect(decoded.width, 32);
+    expect(decoded.height, 23);
+    expect(decoded.pixels, hasLength(32 * 23 * 4));
+  });
+
+  test('placeholders decode to a blurred version of the source', () {
+    final decoded = ThumbHash.decode(_opaque)!;
+
+    expect(_pixel(decoded, 0, 0), _closeTo([34, 22, 149, 255]));
+    expect(_pixel(decoded, 31, 22), _closeTo([242, 230, 115, 255]));
+  });
+
+  test('translucent placeholders are premultiplied', () {
+    final decoded = ThumbHash.decode(_translucent)!;
+    expect(decoded.width, 32);
+    expect(decoded.height, 32);
+
+    expect(_pixel(decoded, 0, 0), _closeTo([18, 42, 129, 255]));
+    // 95, 152, 126 at alpha 41
+    expect(_pixel(decoded, 31, 31), _closeTo([15, 24, 20, 41]));
+  });
+
+  test('truncated placeholders are rejected', () {
+    expect(ThumbHash.decode(Uint8List(0)), isNull);
+    expect(ThumbHash.decode(_opaque.sublist(0, 12)), isNull);
+    expect(ThumbHash.decode(Uint8List.fromList([0, 0, 0, 0, 0])), isNull);
+  });
+}
@@ -6,11 +6,81 @@ void main() {
   test('native thumbnail cache stays bounded and off the main thread', () {
     final source = File('macos/Runner/AppDelegate.swift').readAsStringSync();
 
-    expect(source, contains('maxConcurrentOperationCount = 2'));
+    expect(source, contains('JobQueue.submit('));
+    expect(source, isNot(contains('OperationQueue()')));
     expect(source, contains('CGImageSourceCreateThumbnailAtIndex'));
     expect(source, contains('cacheLimitBytes = 1024 * 1024 * 1024'));
-    expect(source, contains('cacheTargetBytes = 900 * 1024 * 1024'));
-    expect(source, contains('addBarrierBlock'));
     expect(source, contains('.cachesDirectory'));
+    expect(source, contains('ImageUtils.encodeRawThumbnail'));
+    expect(source, contains('variant: ThumbnailVariant.pixels.rawValue'));
+    expect(source, contains('pyramidSizes = [256, 960, 2048]'));
+    expect(source, contains('ImageUtils.packThumbnailPyramid'));
+  });
+
+  test('native thumbnail cache hits never walk or touch cache files', () {
+    final source = File('macos/Runner/AppDelegate.swift').readAsStringSync();
+
+    expect(source, contains('ThumbnailStore('));
+    expect(source, contains('store.locatePath('));
+    expect(source, isNot(contains('.enumerator(')));
+    expect(source, isNot(contains('.modificationDate: Date()')));
+  });
+
+  test('placeholders are stored with thumbnails and returned by scans', () {
+    final source = File('macos/Runner/AppDelegate.swift').readAsStringSync();
+
+    expect(source, contains('ImageUtils.thumbHash(for: image)'));
+    expect(source, contains('variant: .placeholder'));
+    expect(
+      source,
+      contains('entry["placeholder"] = FlutterStandardTypedData'),
+    );
+  });
+
+  test('thumbnail prefetch runs idle and yields to foreground requests', () {
+    final source = File('macos/Runner/AppDelegate.swift')
+        .readAsStringSync()
+        .replaceAll(RegExp(r'\s+'), '');
+    final perform = source.substring(
+      source.indexOf('funcperform<T>('),
+      source.indexOf('funccancelRequests('),
+    );
+
+    expect(source, contains('withPriority:JOB_PRIORITY_PREFETCH'));
+    expect(source, contains('CGEventSource.secondsSinceLastEventType'));
+    expect(perform.indexOf('cancelPrefetch()'), isNonNegative);
+    expect(
+      perform.indexOf('cancelPrefetch()'),
+      lessThan(perform.indexOf('JobQueue.submit(')),
+    );
+  });
+
+  test('thumbnail requests are scheduled by priority and view', () {
+    final source = File('macos/Runner/AppDelegate.swift').readAsStringSync();
+
+    expect(source, contains('JOB_PRIORITY_VISIBLE'));
+    expect(source, contains('JOB_PRIORITY_NEAR_VISIBLE'));
+    expect(source, contains('JobQueue.cancelGroup(view)'));
+    expect(source, contains('code: "thumbnail_cancelled"'));
+  });
+
+  test('pyramid levels are resampled by libimage, not CoreGraphics', () {
+    final source = File('macos/Runner/AppDelegate.swift').readAsStringSync();
+
+    expect(
+      source,
+      contains('ImageUtils.resample(image, width: width, height: height)'),
+    );
+    expect(source, isNot(contains('interpolationQuality')));
+  });
+
+  test('jpeg pyramids are built by libimage before falling back', () {
+    final source = File('macos/Runner/AppDelegate.swift').readAsStringSync();
+
+    expect(source, contains('ImageUtils.thumbnailPyramid('));
+    expect(
+      source.indexOf('generateJpegPyramid(path: path)'),
+      lessThan(source.indexOf('CGImageSourceCreateThumbnailAtIndex')),
+    );
   });
 }
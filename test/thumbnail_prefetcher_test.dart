@@ -0,0 +1,68 @@
+import 'dart:io';
+
+import 'package:flutter_test/flutter_test.dart';
+import 'package:foto/utils/thumbnail_prefetcher.dart';
+import 'package:path/path.dart' as p;
+
+void main() {
+  late Directory root;
+
+  String folder(String name) {
+    final path = p.join(root.path, name);
+    Directory(path).createSync(recursive: true);
+    return path;
+  }
+
+  setUp(() {
+    root = Directory.systemTemp.createTempSync('foto_prefetch_');
+  });
+
+  tearDown(() {
+    root.deleteSync(recursive: true);
+  });
+
+  test('siblings come first in sidebar order, then recent and favorites',
+      () async {
+    final january = folder('2026-01');
+    final february = folder('2026-02');
+    final march = folder('2026-03');
+    folder('.hidden');
+    final trip = folder('trips/iceland');
+    final portfolio = folder('portfolio');
+
+    final candidates = await ThumbnailPrefetcher.candidateFolders(
+      february,
+      recent: [february, trip, march],
+      favorites: [portfolio, january],
+    );
+
+    expect(candidates, [march, january, trip, portfolio]);
+  });
+
+  test('edges and missing folders are skipped', () async {
+    final first = folder('a');
+    final second = folder('B');
+
+    final candidates = await ThumbnailPrefetcher.candidateFolders(
+      first,
+      recent: [p.join(root.path, 'deleted')],
+    );
+
+    expect(candidates, [second]);
+  });
+
+  test('only the most recent folders are prefetched', () async {
+    final current = folder('current/only');
+    final recent = [
+      for (var i = 0; i < ThumbnailPrefetcher.maxRecentFolders + 2; i++)
+        folder('recent-$i'),
+    ];
+
+    final candidates = await ThumbnailPrefetcher.candidateFolders(
+      current,
+      recent: recent,
+    );
+
+    expect(candidates, recent.take(ThumbnailPrefetcher.maxRecentFolders));
+  });
+}